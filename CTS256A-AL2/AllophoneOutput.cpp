@@ -0,0 +1,75 @@
+/*
+    CTS256A-AL2 - Allophone Output Stage.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "AllophoneOutput.h"
+
+void AllophoneOutput::put( uchar allophone, const char *label )
+{
+	if ( block_.empty() )
+		since_ = now();
+
+	if ( label )
+	{
+		block_ += ' ';
+		block_ += label;
+	}
+	else
+	{
+		block_ += char( allophone | 0x40 );
+	}
+
+	bool boundary;
+
+	switch ( policy_ )
+	{
+	case FLUSH_WORD:
+		boundary = allophone <= ALLOPHONE_PA5;
+		break;
+	case FLUSH_SENTENCE:
+		boundary = allophone == ALLOPHONE_PA5;
+		break;
+	case FLUSH_BULK:
+		boundary = false;
+		break;
+	default:
+		boundary = true;
+	}
+
+	if ( boundary || block_.size() >= blockSize_ )
+		flush();
+	else
+		poll();
+}
+
+void AllophoneOutput::flush()
+{
+	if ( !block_.empty() )
+	{
+		ostr_.write( block_.data(), std::streamsize( block_.size() ) );
+		block_.clear();
+		++writes_;
+	}
+	ostr_.flush();
+}
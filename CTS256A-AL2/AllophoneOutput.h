@@ -0,0 +1,137 @@
+/*
+    CTS256A-AL2 - Allophone Output Stage.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "runtime.h"
+
+#include <windows.h>
+
+#include <iostream>
+#include <string>
+
+// Output flush policies
+#define FLUSH_ALLOPHONE		'A'		// flush each allophone
+#define FLUSH_WORD			'W'		// flush at each pause (word boundary)
+#define FLUSH_SENTENCE		'S'		// flush at each end of sentence (PA5)
+#define FLUSH_BULK			'B'		// flush only when the block is full
+
+// Default output block size in bytes
+#define OUTPUT_BLOCK_SIZE	4096
+
+// Default latency deadline in ms for the word and sentence policies (0=none)
+#define OUTPUT_DEADLINE		5
+
+// Last pause allophone (PA1..PA5 are 00..04), spoken at the end of sentences
+#define ALLOPHONE_PA5		0x04
+
+// Coalesces the allophones into blocks, written to the output stream when
+// the block is full, at the boundary selected by the policy, when the
+// oldest pending allophone is older than the deadline, or when the input
+// is starved.
+
+class AllophoneOutput
+{
+public:
+	AllophoneOutput( std::ostream &ostr )
+		: ostr_( ostr ), policy_( FLUSH_ALLOPHONE ), blockSize_( OUTPUT_BLOCK_SIZE )
+		, deadline_( OUTPUT_DEADLINE ), since_( 0 ), writes_( 0 )
+	{
+		// performance counter: GetTickCount() only ticks every 10-16 ms
+		LARGE_INTEGER freq;
+		QueryPerformanceFrequency( &freq );
+		ticksPerMs_ = freq.QuadPart / 1000;
+		block_.reserve( blockSize_ );
+	}
+
+	~AllophoneOutput()
+	{
+		flush();
+	}
+
+	// queue an allophone, as label if given, else as binary code
+	void put( uchar allophone, const char *label );
+
+	// input starved: write the pending allophones before blocking
+	void starved()
+	{
+		if ( !block_.empty() && policy_ != FLUSH_BULK )
+			flush();
+	}
+
+	// check the latency deadline
+	void poll()
+	{
+		if ( !block_.empty() && deadline_ && policy_ != FLUSH_BULK
+			&& now() - since_ >= deadline_ * ticksPerMs_ )
+			flush();
+	}
+
+	// write the pending allophones
+	void flush();
+
+	void setPolicy( char policy )
+	{
+		policy_ = policy;
+	}
+
+	char getPolicy() const
+	{
+		return policy_;
+	}
+
+	void setDeadline( uint deadline )
+	{
+		deadline_ = deadline;
+	}
+
+	uint getDeadline() const
+	{
+		return deadline_;
+	}
+
+	// number of block writes
+	uint getWrites() const
+	{
+		return writes_;
+	}
+
+private:
+	static LONGLONG now()
+	{
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter( &counter );
+		return counter.QuadPart;
+	}
+
+	std::ostream		&ostr_;
+	std::string			block_;
+	char				policy_;
+	uint				blockSize_;
+	uint				deadline_;
+	LONGLONG			since_;			// performance counter of the oldest pending allophone
+	LONGLONG			ticksPerMs_;
+	uint				writes_;
+};
@@ -30,10 +30,9 @@
 
 #include <stdio.h>
 #include <ctype.h>
+#include <sstream>
 
-extern const uchar CTS256A_AL2_ROM[];
-
-static const char * SP0256_labels[] = 
+const char * SP0256_labels[SP0256_NLABELS] = 
 {
 	"PA1",	"PA2",	"PA3",	"PA4",	"PA5",	"OY",	"AY",	"EH",
 	"KK3",	"PP",	"JH",	"NN1",	"IH",	"TT2",	"RR1",	"AX",
@@ -84,14 +83,15 @@ uchar CTS256A_AL2_Data_InOut::read( ushort addr )
 		if ( !initctr_ && ( bport_ & 0x01 ) ) {
 			//if ( !irq3ctr_-- ) {
 			if ( addr == 0xF105 || addr == 0xF10C || addr == 0xF11C || addr == 0xF12F ) { 
+				output_.poll();
 				// POLL/ENDPOL and output buffer empty
 				if ( cpu_.getdata(7) == cpu_.getdata(9) ) {
 					cpu_.trigIRQ( 0x08 ); // trig INT3 - input interrupt
-					if ( verbose_ )
-						cpu_.printf( " %04x 7:%d 9:%d TRIG\n", addr, cpu_.getdata(7), cpu_.getdata(9) );
+					if ( verbose_ || traceRing_ )
+						trace( TraceRing::EV_TRIG, addr, cpu_.getdata(7), cpu_.getdata(9) );
 				} else {
-					if ( verbose_ )
-						cpu_.printf( " %04x 7:%d 9:%d NOTRIG\n", addr, cpu_.getdata(7), cpu_.getdata(9) );
+					if ( verbose_ || traceRing_ )
+						trace( TraceRing::EV_NOTRIG, addr, cpu_.getdata(7), cpu_.getdata(9) );
 				}
 			}
 		}
@@ -114,19 +114,30 @@ uchar CTS256A_AL2_Data_InOut::read( ushort addr )
 		// to force output of each allophone
 		return 0;
 
-	if ( debug_rules_ )
+	if ( debug_rules_ || ruleCounters_ )
 	{
 		if ( addr == 0xF406 )
 		{
 			// after CALL @SELRUL
 			// got the initial in the accumulator
 			initial_ = cpu_.read( 0 );
+			if ( ruleCounters_ )
+				ruleCounters_->select( initial_ );
+		}
+		else if ( addr == 0xF420 )
+		{
+			// CALL @>F4C2: try the rule in R20:R21
+			if ( ruleCounters_ )
+				ruleCounters_->attempt();
 		}
 		else if ( addr == 0xF441 )
 		{
 			// after BTJO %>10,R10,LF47A 
 			// found matching rule in R20:R21
-			debug_rule();
+			if ( debug_rules_ )
+				debug_rule();
+			if ( ruleCounters_ )
+				ruleCounters_->match( ( cpu_.getdata( 20 ) << 8 ) + cpu_.getdata( 21 ) );
 		}
 	}		
 
@@ -136,20 +147,32 @@ uchar CTS256A_AL2_Data_InOut::read( ushort addr )
 	// 0x0200-0x0FFF: Parallel data (in)
 	if ( addr < 0x1000 )
 	{
-		if ( verbose_ )
-			cpu_.printf( " - avail %d:", istr_.rdbuf()->in_avail() );
-		uchar c = uchar( toupper( istr_.get() ) );
-		if ( eof_ || istr_.eof() )
+		// read through the stream buffer cursor, without the istream overhead
+		std::streamsize avail = input_.in_avail();
+		if ( verbose_ || traceRing_ )
+			trace( TraceRing::EV_AVAIL, 0, uint( avail ) );
+		// don't hold the output while waiting for input
+		if ( avail <= 0 )
+			output_.starved();
+		int in = input_.sbumpc();
+		// CR LF is a single line end, as with a text mode stream
+		if ( in == '\r' && input_.in_avail() > 0 && input_.sgetc() == '\n' )
+			in = input_.sbumpc();
+		uchar c = uchar( toupper( in ) );
+		if ( eof_ || in == EOF )
 		{
 			eof_ = true;
 			eofctr_ = EOF_CTR_RELOAD;
-			if ( verbose_ )
-				cpu_.printf( " in: EOF\n" );
+			if ( verbose_ || traceRing_ )
+				trace( TraceRing::EV_IN_EOF );
 			return 0x0D;
 		}
 
-		if ( verbose_ )
-			cpu_.printf( " in: %c\n", c );
+		++inputs_;
+		if ( charsMetric_ )
+			charsMetric_->add();
+		if ( verbose_ || traceRing_ )
+			trace( TraceRing::EV_IN, c );
 
 		if ( echo_ )
 			cpu_.putch( c );
@@ -177,6 +200,24 @@ uchar CTS256A_AL2_Data_InOut::read( ushort addr )
 	return 0xFF;
 }
 
+void CTS256A_AL2_Data_InOut::trace( ushort event, ushort a, uint b, uint c )
+{
+	TraceRing::record_t record = { event, a, b, c, inputs_ };
+
+	if ( traceRing_ )
+	{
+		traceRing_->setStamp( inputs_ );
+		traceRing_->write( event, a, b, c );
+	}
+
+	if ( verbose_ )
+	{
+		char text[TraceRing::TEXT_SIZE];
+		TraceRing::format( record, text );
+		cpu_.printf( "%s", text );
+	}
+}
+
 uchar CTS256A_AL2_Data_InOut::write( ushort addr, uchar data )
 {
 	// 0xF000-0xFFFF: CTS256A-AL2 ROM (in)
@@ -196,21 +237,20 @@ uchar CTS256A_AL2_Data_InOut::write( ushort addr, uchar data )
 	{
 		if ( eof_ )
 		{
-			if ( verbose_ )
-				cpu_.printf( "%5d ", eofctr_ );
+			if ( verbose_ || traceRing_ )
+				trace( TraceRing::EV_EOFCTR, 0, eofctr_ );
 			eofctr_ = EOF_CTR_RELOAD;
 		}
 
-		if ( verbose_ )
-			cpu_.printf( " SP0256: %02X=%s\n", data, data<0x40 ? SP0256_labels[data] : "**" );
+		if ( verbose_ || traceRing_ )
+			trace( TraceRing::EV_SP0256, data );
+
+		if ( allophonesMetric_ )
+			allophonesMetric_->add();
 
 		if ( !noOK_ || !initctr_ )
 		{
-			if ( mode_ == 'T' )
-				ostr_ << " " << SP0256_labels[data];
-			else
-				ostr_.put( data | 0x40 );
-			ostr_.flush();
+			output_.put( data, mode_ == 'T' ? SP0256_labels[data] : 0 );
 		}
 
 		if ( initctr_ )
@@ -245,7 +285,7 @@ uchar CTS256A_AL2_Data_InOut::in( ushort addr )
 		// 2 (04)	m0 +	000:paral  - 001:50bd   - 010:110bd
 		// 1 (02)	m1 |==> 011:300bd  - 100:1200bd - 101:2400bd
 		// 0 (01)	m2 +    110:4800bd - 111:9600bd
-		return 0x10;
+		return aport_;
 	case 0x06:	// BPORT	(out) Port B data := xxxx xxxI (DSR/BUSY)
 		// 7 (80)	CLKOUT
 		// 6 (40)	ENABLE*
@@ -313,6 +353,18 @@ void CTS256A_AL2_Data_InOut::setOption( uchar option, uint value )
 	case 'M':
 		mode_ = (uchar)value;
 		break;
+	case 'A':
+		if ( !APORT_STRAPS_VALID( value ) )
+			cpu_.printf( "Unsupported APORT straps %02X\n", value );
+		else
+			aport_ = (uchar)value;
+		break;
+	case 'F':
+		output_.setPolicy( (char)value );
+		break;
+	case 'L':
+		output_.setDeadline( value );
+		break;
 	default:
 		cpu_.printf( "Unknown option %c=%d\n", option, value );
 	}
@@ -334,6 +386,12 @@ uint CTS256A_AL2_Data_InOut::getOption( uchar option )
 		return noOK_;
 	case 'M':
 		return mode_;
+	case 'A':
+		return aport_;
+	case 'F':
+		return output_.getPolicy();
+	case 'L':
+		return output_.getDeadline();
 	default:
 		cpu_.printf( "Unknown option %c\n", option );
 		return 0;
@@ -342,32 +400,34 @@ uint CTS256A_AL2_Data_InOut::getOption( uchar option )
 
 void CTS256A_AL2_Data_InOut::debug_rule()
 {
-
 	ushort addr = ( cpu_.read( 20 ) << 8 ) + cpu_.read( 21 );
 
-	bool first = true;
+	cpu_.printf( "%04X:\t", addr );
+	cpu_.puts( getRule( addr, initial_ ).c_str() );
+	cpu_.putch( '\n' );
+}
+
+std::string CTS256A_AL2_Data_InOut::getRule( ushort addr, uchar initial )
+{
+	std::string text;
+
 	bool allo = false;
 	bool bracket = false;
-	uchar c0 = initial_;
+	uchar c0 = initial;
 
 	while ( true )
 	{
-		if ( first ) {
-			first = 0;
-			cpu_.printf( "%04X:\t", addr );
-		}
-
-		uchar c = cpu_.read( addr++ );
+		uchar c = CTS256A_AL2_ROM[addr++ & 0x0FFF];
 
 		// Opening bracket ?
 		if ( c & 0x40 ) {
 			if ( allo ) {
-				cpu_.puts( " = " );
+				text += " = ";
 			}
-			cpu_.putch( '[' );
+			text += '[';
 			if ( !allo && c0 >= 'A' )
 			{
-				cpu_.putch( c0 );
+				text += char( c0 );
 			}
 			bracket = true;
 		}
@@ -379,32 +439,35 @@ void CTS256A_AL2_Data_InOut::debug_rule()
 			uchar s = symbols[ch]; 
 			// pattern outside brackets: use symbols table
 			if ( s  )
-				cpu_.putch( s );
+				text += char( s );
 			else
-				cpu_.printf( "{%02X}", ch );
+			{
+				char hex[8];
+				sprintf( hex, "{%02X}", ch );
+				text += hex;
+			}
 		}
 		else if ( allo )
 		{
 			// allophones inside brackets
 			if ( c != 0xFF )
 			{
-				cpu_.puts( SP0256_labels[ch] );
+				text += SP0256_labels[ch];
 				if ( !( c & 0x80 ) )
-					cpu_.putch( ' ' );
+					text += ' ';
 			}
 		}
 		else
 		{
 			// pattern inside brackets
 			if ( c != 0xFF )
-				cpu_.putch( ch + 0x20  );
+				text += char( ch + 0x20 );
 		}
 
 		// Closing bracket ?
 		if ( c & 0x80 ) {
-			cpu_.putch( ']' );
+			text += ']';
 			if ( allo ) {
-				cpu_.putch( '\n' );
 				break; // done. Exit loop
 			}
 			allo = !allo;
@@ -412,6 +475,7 @@ void CTS256A_AL2_Data_InOut::debug_rule()
 		}
 	}
 
+	return text;
 }
 
 void CTS256A_AL2::run()
@@ -425,6 +489,9 @@ void CTS256A_AL2::run()
 
 	uint lastpc = 0, pc = 0, breakPoint = 0xFFFF;
 
+	// instructions not yet added to the metrics
+	uint instructions = 0;
+
 	while ( mode_.getMode() != MODE_EXIT )
 	{
 		pc = cpu_.getPC();
@@ -434,7 +501,14 @@ void CTS256A_AL2::run()
 
 		if ( mode == MODE_STOP )
 		{
+			if ( !interactive_ )
+			{
+				// no console to debug from: give up
+				mode_.setMode( MODE_EXIT );
+				continue;
+			}
 
+			data_.flush();
 			debugger.display();
 
 				pc = cpu_.getPC();
@@ -454,6 +528,15 @@ void CTS256A_AL2::run()
 			lastpc = cpu_.getPC();
 			cpu_.sim();
 
+			if ( ++instructions == 0x10000 && instructionsMetric_ )
+			{
+				instructionsMetric_->add( instructions );
+				instructions = 0;
+			}
+
+			// poll console for F10 (stop) and Sh-F10 (exit)
+			systemConsole_.kbhit();
+
 			if ( mode == MODE_STOP && !debugger.isBreakOn() )
 			{
 				if ( helper.isBreak( lastpc ) )
@@ -497,8 +580,16 @@ void CTS256A_AL2::run()
 
 	systemConsole_.printf( "\n" );
 
+	if ( instructionsMetric_ )
+		instructionsMetric_->add( instructions );
+
+	data_.flush();
+
 	if ( data_.getOption( 'M' ) == 'T' )
-		printf( "\n" );
+	{
+		ostr_ << "\n";
+		ostr_.flush();
+	}
 }
 
 void CTS256A_AL2::stop()
@@ -533,6 +624,30 @@ void CTS256A_AL2::callstep()
 {
 }
 
+void CTS256A_AL2_Converter::convert( uint seq, const std::string &in, std::string &out )
+{
+	std::istringstream istr( in );
+	std::ostringstream ostr;
+
+	CTS256A_AL2 system( istr, ostr );
+
+	system.setOption( 'M', mode_ );
+	system.setOption( 'A', aport_ );
+	system.setOption( 'F', FLUSH_BULK );
+	// only the first sentence may say 'O.K.'
+	system.setOption( 'N', noOK_ || seq > 0 );
+	if ( metrics_ )
+		system.setMetrics( *metrics_ );
+
+	system.run();
+
+	out = ostr.str();
+
+	// the text mode line end is written once after the last sentence
+	if ( mode_ == 'T' && !out.empty() && out[out.size() - 1] == '\n' )
+		out.erase( out.size() - 1 );
+}
+
 // CTS256A_AL2 TMS7000 ROM contents (0xF000..0xFFFF)
 const uchar CTS256A_AL2_ROM[0x1000] = 
 {
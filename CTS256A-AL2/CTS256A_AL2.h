@@ -33,9 +33,16 @@
 #include "InOut_I.h"
 #include "TMS7000CPU.h"
 #include "TMS7000Disassembler.h"
-#include "ConIOConsole.h"
+#include "NullConsole.h"
+#include "SentenceScheduler.h"
+#include "AllophoneOutput.h"
+#include "Profiler.h"
+#include "RuleCounters.h"
+#include "TraceRing.h"
+#include "Metrics.h"
 
 #include <iostream>
+#include <string>
 
 // Number of READs after last input/output before entering DEBUG mode
 #define DEBUG_CTR_RELOAD 999999
@@ -43,13 +50,34 @@
 // Number of READs after eof and last output before stopping the emulation
 #define EOF_CTR_RELOAD 199999
 
+// APORT straps (input port A)
+#define APORT_ANY_DELIMITER		0x80	// 7: Delimiter: 0=CR - 1=any
+#define APORT_EXT_BUFFERS		0x10	// 4: RAM buffers: 0=internal(20in/26out) - 1=external(1792in/256out)
+#define APORT_DEFAULT			APORT_EXT_BUFFERS
+// Configurable straps: the others select the serial modes, not emulated
+#define APORT_STRAPS_MASK		( APORT_ANY_DELIMITER | APORT_EXT_BUFFERS )
+// Required straps: the input handshake only handles the external buffers
+#define APORT_STRAPS_REQUIRED	APORT_EXT_BUFFERS
+
+#define APORT_STRAPS_VALID( straps ) \
+	( !( (straps) & ~APORT_STRAPS_MASK ) && ( (straps) & APORT_STRAPS_REQUIRED ) == APORT_STRAPS_REQUIRED )
+
+// SP0256-AL2 allophone labels
+#define SP0256_NLABELS 64
+extern const char * SP0256_labels[SP0256_NLABELS];
+
+// CTS256A-AL2 ROM (0xF000-0xFFFF)
+extern const uchar CTS256A_AL2_ROM[];
+
 class CTS256A_AL2_Data_InOut
 	: public Memory_I, public InOut_I
 {
 public:
 	CTS256A_AL2_Data_InOut( TMS7000CPU &cpu, std::istream &istr, std::ostream &ostr )
-		: cpu_( cpu ), istr_( istr ), ostr_( ostr ), bport_( 0 ), initctr_( 6 ), irq3ctr_( 0 ), eof_( false )
+		: cpu_( cpu ), input_( *istr.rdbuf() ), ostr_( ostr ), bport_( 0 ), initctr_( 6 ), irq3ctr_( 0 ), eof_( false )
 		, debug_( false ), debug_rules_( false ), verbose_( false ), echo_( false ), noOK_( false ), mode_( 'T' ), debugctr_( DEBUG_CTR_RELOAD )
+		, aport_( APORT_DEFAULT ), output_( ostr ), ruleCounters_( 0 ), traceRing_( 0 ), inputs_( 0 )
+		, charsMetric_( 0 ), allophonesMetric_( 0 )
 	{
 		memset( ram_, 0, 0x800 );
 	}
@@ -85,11 +113,42 @@ public:
 
 	void debug_rule();
 
+	// text of the rule at addr in the ROM, with its initial if a letter
+	static std::string getRule( ushort addr, uchar initial );
+
+	// count the rules matches (0 to disable)
+	void setRuleCounters( RuleCounters *ruleCounters )
+	{
+		ruleCounters_ = ruleCounters;
+	}
+
+	// record the I/O events of the verbose mode (0 to disable)
+	void setTraceRing( TraceRing *traceRing )
+	{
+		traceRing_ = traceRing;
+	}
+
+	// count the input characters and the allophones
+	void setMetrics( Metrics &metrics )
+	{
+		charsMetric_ = &metrics.counter( "cts256a_input_chars_total", "Input characters read." );
+		allophonesMetric_ = &metrics.counter( "cts256a_allophones_total", "Allophones output." );
+	}
+
+	// write the pending allophones
+	void flush()
+	{
+		output_.flush();
+	}
+
 private:
+	// I/O event: to the trace ring, and to the console in verbose mode
+	void trace( ushort event, ushort a = 0, uint b = 0, uint c = 0 );
+
 	uchar					bport_;
 	TMS7000CPU				&cpu_;
 	uchar					ram_[0x800];
-	std::istream			&istr_;
+	std::streambuf			&input_;
 	std::ostream			&ostr_;
 	uchar					initctr_;
 	ushort					irq3ctr_;
@@ -104,17 +163,26 @@ private:
 	bool					noOK_;
 	char					mode_;
 	char					initial_;
+	uchar					aport_;
+	AllophoneOutput			output_;
+	RuleCounters			*ruleCounters_;
+	TraceRing				*traceRing_;
+	uint					inputs_;
+	Metrics::Counter		*charsMetric_;
+	Metrics::Counter		*allophonesMetric_;
 };
 
 
 class CTS256A_AL2 : public System_I
 {
 public:
-	CTS256A_AL2( std::istream &istr, std::ostream &ostr )
+	// console: interactive console, or 0 to run detached with a null console
+	CTS256A_AL2( std::istream &istr, std::ostream &ostr, Console_I *console = 0 )
 	: debug_( false ), istr_( istr), ostr_( ostr ), data_( cpu_, istr, ostr )
+	, console_( console ? console : &nullConsole_ ), interactive_( console != 0 ), profiler_( 0 ), instructionsMetric_( 0 )
 	{
 		systemConsole_.setSystem( this );
-		systemConsole_.setConsole( &console_ );
+		systemConsole_.setConsole( console_ );
 		cpu_.setExtMemory( &data_ );
 		cpu_.setExtInOut( &data_ );
 		cpu_.setConsole( &systemConsole_ );
@@ -141,14 +209,76 @@ public:
 			debug_ = value != 0;
 	}
 
+	// profile the firmware execution (0 to disable)
+	void setProfiler( Profiler *profiler )
+	{
+		profiler_ = profiler;
+		cpu_.setProfiler( profiler );
+	}
+
+	// count the rules matches (0 to disable)
+	void setRuleCounters( RuleCounters *ruleCounters )
+	{
+		data_.setRuleCounters( ruleCounters );
+	}
+
+	// record the I/O events of the verbose mode (0 to disable)
+	void setTraceRing( TraceRing *traceRing )
+	{
+		data_.setTraceRing( traceRing );
+	}
+
+	// count the emulated instructions, the input characters and the allophones
+	void setMetrics( Metrics &metrics )
+	{
+		instructionsMetric_ = &metrics.counter( "cts256a_instructions_total", "TMS7000 instructions emulated." );
+		data_.setMetrics( metrics );
+	}
+
+	// write the execution profile report
+	void writeProfile( FILE *out )
+	{
+		if ( profiler_ )
+			profiler_->report( cpu_, disass_, out );
+	}
+
 private:
 	TMS7000CPU				cpu_;
 	CTS256A_AL2_Data_InOut	data_;
 	Mode					mode_;
-	ConIOConsole			console_;
+	NullConsole				nullConsole_;
+	Console_I				*console_;
+	bool					interactive_;
+	Profiler				*profiler_;
+	Metrics::Counter		*instructionsMetric_;
 	SystemConsole			systemConsole_;
 	TMS7000Disassembler		disass_;
 	bool					debug_;
 	std::istream			&istr_;
 	std::ostream			&ostr_;
 };
+
+
+// Sentence converter running a detached CTS256A-AL2 system per sentence
+class CTS256A_AL2_Converter : public SentenceConverter_I
+{
+public:
+	CTS256A_AL2_Converter( char mode, bool noOK, uchar aport = APORT_DEFAULT )
+		: mode_( mode ), noOK_( noOK ), aport_( aport ), metrics_( 0 )
+	{
+	}
+
+	// metrics of the systems
+	void setMetrics( Metrics *metrics )
+	{
+		metrics_ = metrics;
+	}
+
+	void convert( uint seq, const std::string &in, std::string &out );
+
+private:
+	char					mode_;
+	bool					noOK_;
+	uchar					aport_;
+	Metrics					*metrics_;
+};
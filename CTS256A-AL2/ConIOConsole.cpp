@@ -32,6 +32,12 @@
 #	define noexcept throw()
 #endif
 
+// F10 key code, reported to the system console as a STOP request
+#define KEY_STOP	-68
+
+// Ctrl-Break flag; the signal is process-wide, like the console itself
+static volatile sig_atomic_t s_break = 0;
+
 static void siginthandler (int) noexcept
 {
     signal(SIGINT,siginthandler);   // reinstall signal handler
@@ -39,14 +45,22 @@ static void siginthandler (int) noexcept
     return;
 }
 
+static void sigbreakhandler (int) noexcept
+{
+    signal(SIGBREAK,sigbreakhandler);   // reinstall signal handler
+	s_break = 1;
+    return;
+}
+
 ConIOConsole::ConIOConsole() : autolf_( false ), backspace_( 0x08 ), ch_( 0 )
 {
 	signal( SIGINT, siginthandler );
+	signal( SIGBREAK, sigbreakhandler );
 }
 
 int ConIOConsole::kbhit()
 {
-	int ret = ch_ || _kbhit();
+	int ret = ch_ || s_break || _kbhit();
 #ifdef _DEBUG
 	if ( ret )
 		ret = ret;
@@ -57,6 +71,12 @@ int ConIOConsole::kbhit()
 
 int ConIOConsole::getch()
 {
+	if ( s_break && !ch_ )
+	{
+		s_break = 0;
+		return KEY_STOP;
+	}
+
 	int c = ch_ ? ch_ : _getch();
 
 	ch_ = 0;
@@ -72,6 +92,12 @@ int ConIOConsole::getch()
 
 int ConIOConsole::poll()
 {
+	if ( s_break )
+	{
+		s_break = 0;
+		return ch_ = KEY_STOP;
+	}
+
 	if ( !_kbhit() )
 		return 0;
 
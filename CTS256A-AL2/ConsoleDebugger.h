@@ -33,7 +33,8 @@ class ConsoleDebugger
 public:
 	ConsoleDebugger( SystemConsole &systemConsole, DebugHelper_I &helper, Mode &mode )
 		: systemConsole_( systemConsole ), helper_( helper ), mode_( mode )
-		, breakPoint_( 0xFFFF ), breakOn_( false ), lines_( 25 )
+		, breakPoint_( 0xFFFF ), breakOn_( false ), retSP_( 0 ), lines_( 25 )
+		, regLines_( 0 ), pc_( 0 ), nextpc_( 0 ), lastBreakPoint_( 0xFFFF ), hexptr_( 0 )
 	{
 		init();
 	}
@@ -83,7 +84,6 @@ public:
 		lines_ = lines;
 	}
 
-	friend void sigbreakhandler(int s);
 private:
 	SystemConsole	&systemConsole_;
 	DebugHelper_I	&helper_;
@@ -92,5 +92,10 @@ private:
 	bool			breakOn_;
 	uint			retSP_;
 	uint			lines_;
+	int				regLines_;
+	uint			pc_;
+	uint			nextpc_;
+	uint			lastBreakPoint_;
+	ushort			hexptr_;
 };
 
@@ -0,0 +1,215 @@
+/*
+    CTS256A-AL2 - Micro-Benchmarks.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MicroBenchmarks.h"
+
+#include "CTS256A_AL2.h"
+#include "TMS7000CPU.h"
+
+#include <sstream>
+#include <vector>
+
+// Address of the operands of the instructions
+#define OPERANDS_ADDR	0xF001
+
+// Flat 64K memory and I/O ports, for the instructions
+class FlatMemory : public Memory_I, public InOut_I
+{
+public:
+	FlatMemory()
+	{
+		for ( size_t i=0; i<sizeof( mem_ ); ++i )
+			mem_[i] = uchar( i * 0x35 + 0x10 );
+	}
+
+	uchar read( ushort addr )
+	{
+		return mem_[addr];
+	}
+
+	uchar write( ushort addr, uchar data )
+	{
+		return mem_[addr] = data;
+	}
+
+	reader_t getReader()
+	{
+		return 0;
+	}
+
+	writer_t getWriter()
+	{
+		return 0;
+	}
+
+	void* getObject()
+	{
+		return 0;
+	}
+
+	uchar out( ushort addr, uchar data )
+	{
+		return data;
+	}
+
+	uchar in( ushort addr )
+	{
+		return 0xFF;
+	}
+
+private:
+	uchar		mem_[0x10000];
+};
+
+// Input that never ends, for the parallel data port
+class EndlessInput : public std::streambuf
+{
+public:
+	EndlessInput()
+	{
+		static const char text[] = "HELLO WORLD. ";
+		for ( size_t i=0; i<sizeof( buffer_ ); ++i )
+			buffer_[i] = text[i % ( sizeof( text ) - 1 )];
+		setg( buffer_, buffer_, buffer_ + sizeof( buffer_ ) );
+	}
+
+protected:
+	int_type underflow()
+	{
+		setg( buffer_, buffer_, buffer_ + sizeof( buffer_ ) );
+		return traits_type::to_int_type( *buffer_ );
+	}
+
+private:
+	char		buffer_[0x1000];
+};
+
+// Instruction kernel
+struct SimopParam
+{
+	TMS7000CPU				cpu;
+	FlatMemory				memory;
+	std::vector< uchar >	opcodes;
+};
+
+static void simopKernel( void *param, unsigned iterations )
+{
+	SimopParam &p = *static_cast< SimopParam* >( param );
+	const size_t n = p.opcodes.size();
+	for ( unsigned i=0, j=0; i<iterations; ++i )
+	{
+		p.cpu.setPC( OPERANDS_ADDR );
+		p.cpu.simop( p.opcodes[j] );
+		if ( ++j == n )
+			j = 0;
+	}
+}
+
+// Results of the kernels, kept from the optimizer
+static volatile uint sink;
+
+// Memory read kernel
+struct ReadParam
+{
+	CTS256A_AL2_Data_InOut	*data;
+	ushort					first;
+	ushort					last;
+};
+
+static void readKernel( void *param, unsigned iterations )
+{
+	ReadParam &p = *static_cast< ReadParam* >( param );
+	ushort addr = p.first;
+	uint sum = 0;
+	for ( unsigned i=0; i<iterations; ++i )
+	{
+		sum += p.data->read( addr );
+		addr = addr == p.last ? p.first : addr + 1;
+	}
+	sink = sum;
+}
+
+int MicroBenchmarks::run( Benchmark &bench, FILE *con )
+{
+	// instructions
+	static const struct { const char *key; uchar first, last; } groups[] =
+	{
+		{ "simop/misc",			0x00, 0x0F },
+		{ "simop/reg_a",		0x10, 0x1F },
+		{ "simop/imm_a",		0x20, 0x2F },
+		{ "simop/reg_b",		0x30, 0x3F },
+		{ "simop/reg_reg",		0x40, 0x4F },
+		{ "simop/imm_b",		0x50, 0x5F },
+		{ "simop/b_a",			0x60, 0x6F },
+		{ "simop/imm_reg",		0x70, 0x7F },
+		{ "simop/periph_ext",	0x80, 0xAF },
+		{ "simop/single_a",		0xB0, 0xBF },
+		{ "simop/single_b",		0xC0, 0xCF },
+		{ "simop/single_reg",	0xD0, 0xDF },
+		{ "simop/jump",			0xE0, 0xE7 },
+		{ "simop/trap",			0xE8, 0xFF },
+	};
+	SimopParam *simop = new SimopParam;
+	simop->cpu.setExtMemory( &simop->memory );
+	simop->cpu.setExtInOut( &simop->memory );
+	for ( size_t i=0; i<sizeof( groups ) / sizeof( *groups ); ++i )
+	{
+		if ( !bench.isSelected( groups[i].key ) )
+			continue;
+		simop->opcodes.clear();
+		for ( uint op=groups[i].first; op<=groups[i].last; ++op )
+			if ( TMS7000CPU::isDefined( uchar( op ) ) && op != 0x01 )	// not IDLE
+				simop->opcodes.push_back( uchar( op ) );
+		simop->cpu.reset();
+		bench.measure( groups[i].key, simopKernel, simop, 100000, con );
+	}
+	delete simop;
+
+	// memory reads: the ROM, the parallel data port, the UART parameters,
+	// the SP0256, the RAM and the unmapped space
+	static const struct { const char *key; ushort first, last; } ranges[] =
+	{
+		{ "read/rom",		0xF000, 0xFFFF },
+		{ "read/input",		0x0200, 0x0200 },
+		{ "read/uart",		0x1000, 0x1FFF },
+		{ "read/sp0256",	0x2000, 0x2FFF },
+		{ "read/ram",		0x3000, 0x37FF },
+		{ "read/unmapped",	0x3800, 0xEFFF },
+	};
+	TMS7000CPU cpu;
+	EndlessInput input;
+	std::istream istr( &input );
+	std::ostringstream ostr;
+	CTS256A_AL2_Data_InOut data( cpu, istr, ostr );
+	for ( size_t i=0; i<sizeof( ranges ) / sizeof( *ranges ); ++i )
+	{
+		if ( !bench.isSelected( ranges[i].key ) )
+			continue;
+		ReadParam read = { &data, ranges[i].first, ranges[i].last };
+		bench.measure( ranges[i].key, readKernel, &read, 1000000, con );
+	}
+
+	return 0;
+}
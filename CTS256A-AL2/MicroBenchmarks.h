@@ -0,0 +1,40 @@
+/*
+    CTS256A-AL2 - Micro-Benchmarks.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Benchmark.h"
+
+// Micro-benchmarks of the emulator kernels:
+// - simop/...: TMS7000 instruction execution, per instruction, by opcode
+//   group (rows of the opcode map), with the operands in a flat memory;
+// - read/...: CTS256A-AL2 memory read, per read, by address range.
+
+class MicroBenchmarks
+{
+public:
+	// run the kernels selected by the filter; returns 0 or errno
+	static int run( Benchmark &bench, FILE *con );
+};
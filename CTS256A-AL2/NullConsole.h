@@ -0,0 +1,85 @@
+/*
+    CTS256A-AL2 - Null Console.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Console_I.h"
+
+// Console discarding all output and never providing input,
+// for systems running without an attached terminal
+
+class NullConsole :
+	public Console_I
+{
+public:
+
+	NullConsole(void)
+	{
+	}
+
+	virtual ~NullConsole(void)
+	{
+	}
+
+	int kbhit()
+	{
+		return 0;
+	}
+
+	int getch()
+	{
+		return 0;
+	}
+
+	int poll()
+	{
+		return 0;
+	}
+
+	int ungetch( int ch )
+	{
+		return ch;
+	}
+
+	int putch( int ch )
+	{
+		return ch;
+	}
+
+	int puts( const char * /*str*/ )
+	{
+		return 0;
+	}
+
+	char *gets( char * /*str*/, size_t /*size*/ )
+	{
+		return 0;
+	}
+
+	int vprintf( const char * /*format*/, va_list /*args*/ )
+	{
+		return 0;
+	}
+};
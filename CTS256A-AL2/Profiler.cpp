@@ -0,0 +1,252 @@
+/*
+    CTS256A-AL2 - Execution Profiler.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma warning(disable:4996)	// warning C4996: '%0': This function or variable may be unsafe.
+
+#include "Profiler.h"
+
+#include "CPU.h"
+#include "TMS7000Disassembler.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Number of hot instructions in the report
+#define HOT_INSTRUCTIONS	40
+
+Profiler::Profiler()
+	: total_( 0 ), root_( 0 ), started_( false )
+{
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::exec( ushort pc )
+{
+	if ( !started_ )
+	{
+		// first instruction: the reset entry; allocate the tables
+		counts_.assign( 0x10000, 0 );
+		self_.assign( 0x10000, 0 );
+		active_.assign( 0x10000, 0 );
+		entries_[pc] = 'R';
+		root_ = pc;
+		started_ = true;
+	}
+	++counts_[pc];
+	++self_[stack_.empty() ? root_ : stack_.back().entry];
+	++total_;
+}
+
+void Profiler::call( ushort /*from*/, ushort to, uchar sp, char kind )
+{
+	if ( entries_.find( to ) == entries_.end() )
+		entries_[to] = kind;
+
+	// stack pointer reloaded since the last call ?
+	unwind( uchar( sp - 1 ) );
+
+	ushort caller = stack_.empty() ? root_ : stack_.back().entry;
+	++edges_[( uint( caller ) << 16 ) | to];
+
+	frame_t frame = { to, sp, total_ };
+	stack_.push_back( frame );
+	++active_[to];
+}
+
+void Profiler::ret( ushort /*from*/, ushort /*to*/, uchar sp )
+{
+	unwind( sp );
+}
+
+void Profiler::unwind( uchar sp )
+{
+	while ( !stack_.empty() && stack_.back().sp > sp )
+	{
+		const frame_t &frame = stack_.back();
+		// recursive calls: count the outermost frame only
+		if ( !--active_[frame.entry] )
+			inclusive_[frame.entry] += total_ - frame.start;
+		stack_.pop_back();
+	}
+}
+
+void Profiler::buildSymbols()
+{
+	symbols_.clear();
+	for ( std::map< ushort, char >::const_iterator it = entries_.begin(); it != entries_.end(); ++it )
+	{
+		symbol_t symbol;
+		const char *prefix = it->second == 'R' ? "START"
+			: it->second == 'T' ? "TRAP"
+			: it->second == 'I' ? "INT"
+			: "SUB";
+		sprintf( symbol.name, "%s_%04X", prefix, it->first );
+		symbol.val = it->first;
+		symbol.seg = 'C';
+		symbol.call = 0;
+		symbols_.push_back( symbol );
+	}
+	table_.setSymbols( symbols_.empty() ? 0 : &symbols_[0], int( symbols_.size() ) );
+}
+
+ushort Profiler::getRoutine( ushort pc )
+{
+	std::map< ushort, char >::const_iterator it = entries_.upper_bound( pc );
+	if ( it == entries_.begin() )
+		return pc;
+	return ( --it )->first;
+}
+
+static const char *getName( Symbols &table, ushort addr )
+{
+	static char name[41];
+	symbol_t *symbol = table.getSymbol( 'C', addr );
+	if ( symbol )
+		return symbol->name;
+	sprintf( name, "%04X", addr );
+	return name;
+}
+
+static double percent( unsigned long long count, unsigned long long total )
+{
+	return total ? 100.0 * count / total : 0.0;
+}
+
+// sort by decreasing count
+template< class T >
+static bool byCount( const std::pair< unsigned long long, T > &a, const std::pair< unsigned long long, T > &b )
+{
+	return a.first > b.first || ( a.first == b.first && a.second < b.second );
+}
+
+static uchar getCpuData( void *object, ushort addr )
+{
+	return static_cast<CPU*>( object )->getdata( addr );
+}
+
+void Profiler::report( CPU &cpu, TMS7000Disassembler &disass, FILE *out )
+{
+	if ( !started_ )
+	{
+		fprintf( out, "Execution profile: no instructions\n" );
+		return;
+	}
+
+	buildSymbols();
+
+	// inclusive counts, with the frames still open
+	std::map< ushort, unsigned long long > inclusive( inclusive_ );
+	std::vector< uint > active( active_ );
+	for ( std::vector< frame_t >::const_reverse_iterator it = stack_.rbegin(); it != stack_.rend(); ++it )
+	{
+		if ( !--active[it->entry] )
+			inclusive[it->entry] += total_ - it->start;
+	}
+
+	uint addresses = 0;
+	for ( uint pc = 0; pc < 0x10000; ++pc )
+	{
+		if ( counts_[pc] )
+			++addresses;
+	}
+
+	// calls by routine
+	std::map< ushort, unsigned long long > calls;
+	for ( std::map< uint, unsigned long long >::const_iterator it = edges_.begin(); it != edges_.end(); ++it )
+		calls[ushort( it->first )] += it->second;
+
+	fprintf( out, "Execution profile: %llu instructions at %u addresses, %u routines, %u call edges\n",
+		total_, addresses, uint( entries_.size() ), uint( edges_.size() ) );
+
+	// routines
+	std::vector< std::pair< unsigned long long, ushort > > routines;
+	for ( std::map< ushort, char >::const_iterator it = entries_.begin(); it != entries_.end(); ++it )
+		routines.push_back( std::make_pair( self_[it->first], it->first ) );
+	std::sort( routines.begin(), routines.end(), byCount< ushort > );
+
+	fprintf( out, "\nRoutines (by self instructions):\n" );
+	fprintf( out, "%14s %6s %14s %6s %10s  %s\n", "Self", "%", "Inclusive", "%", "Calls", "Routine" );
+	for ( size_t i = 0; i < routines.size(); ++i )
+	{
+		ushort entry = routines[i].second;
+		unsigned long long incl = entry == root_ ? total_ : inclusive[entry];
+		fprintf( out, "%14llu %6.2f %14llu %6.2f %10llu  %s\n",
+			routines[i].first, percent( routines[i].first, total_ ),
+			incl, percent( incl, total_ ), calls[entry], getName( table_, entry ) );
+	}
+
+	// call graph
+	std::vector< std::pair< unsigned long long, uint > > edges;
+	for ( std::map< uint, unsigned long long >::const_iterator it = edges_.begin(); it != edges_.end(); ++it )
+		edges.push_back( std::make_pair( it->second, it->first ) );
+	std::sort( edges.begin(), edges.end(), byCount< uint > );
+
+	fprintf( out, "\nCall graph (by calls):\n" );
+	fprintf( out, "%14s  %-16s %s\n", "Calls", "Caller", "Callee" );
+	for ( size_t i = 0; i < edges.size(); ++i )
+	{
+		fprintf( out, "%14llu  %-16s ", edges[i].first, getName( table_, ushort( edges[i].second >> 16 ) ) );
+		fprintf( out, "%s\n", getName( table_, ushort( edges[i].second ) ) );
+	}
+
+	// hot instructions, disassembled with the routines as labels
+	std::vector< std::pair< unsigned long long, ushort > > hot;
+	for ( uint pc = 0; pc < 0x10000; ++pc )
+	{
+		if ( counts_[pc] )
+			hot.push_back( std::make_pair( counts_[pc], ushort( pc ) ) );
+	}
+	std::sort( hot.begin(), hot.end(), byCount< ushort > );
+	if ( hot.size() > HOT_INSTRUCTIONS )
+		hot.resize( HOT_INSTRUCTIONS );
+
+	disass.setMemIO( getCpuData, &cpu );
+	disass.setSymbolsTable( symbols_.empty() ? 0 : &symbols_[0], int( symbols_.size() ) );
+
+	fprintf( out, "\nHot instructions:\n" );
+	fprintf( out, "%14s %6s  %-4s  %-20s %s\n", "Count", "%", "PC", "Routine", "Instruction" );
+	for ( size_t i = 0; i < hot.size(); ++i )
+	{
+		ushort pc = hot[i].second;
+		char where[41];
+		ushort entry = getRoutine( pc );
+		if ( entry == pc )
+			strcpy( where, getName( table_, pc ) );
+		else
+			sprintf( where, "%s+%Xh", getName( table_, entry ), pc - entry );
+		disass.setPC( pc );
+		char source[80];
+		strcpy( source, disass.source() );
+		for ( size_t n = strlen( source ); n && source[n-1] == ' '; )
+			source[--n] = 0;
+		fprintf( out, "%14llu %6.2f  %04X  %-20s %s\n",
+			hot[i].first, percent( hot[i].first, total_ ), pc, where, source );
+	}
+
+	disass.setSymbolsTable( 0, 0 );
+}
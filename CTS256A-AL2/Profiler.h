@@ -0,0 +1,92 @@
+/*
+    CTS256A-AL2 - Execution Profiler.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Profiler_I.h"
+#include "Symbols.h"
+
+#include <stdio.h>
+#include <map>
+#include <vector>
+
+class CPU;
+class TMS7000Disassembler;
+
+// Per-PC execution profiler of the emulated firmware:
+// - counts the instructions executed at each address;
+// - records the call graph edges (CALL, TRAP, interrupts) and follows the
+//   returns (RETS, RETI) on a shadow stack for the inclusive counts;
+// - reports by routine, a routine being entered by a call target (the
+//   firmware has no symbols: they are named after the kind of call and the
+//   entry address); the self counts go to the routine on top of the shadow
+//   stack, the hot instructions are located in the nearest routine below.
+class Profiler : public Profiler_I
+{
+public:
+	Profiler();
+
+	~Profiler();
+
+	// Profiler_I interface
+	virtual void exec( ushort pc );
+
+	virtual void call( ushort from, ushort to, uchar sp, char kind );
+
+	virtual void ret( ushort from, ushort to, uchar sp );
+
+	// write the report: routines, call graph and hot instructions
+	void report( CPU &cpu, TMS7000Disassembler &disass, FILE *out );
+
+private:
+	struct frame_t
+	{
+		ushort				entry;
+		uchar				sp;
+		unsigned long long	start;
+	};
+
+	// close the frames above sp, adding their inclusive counts
+	void unwind( uchar sp );
+
+	// build the routines symbols table from the call targets
+	void buildSymbols();
+
+	// entry of the routine containing pc
+	ushort getRoutine( ushort pc );
+
+	std::vector< unsigned long long >			counts_;		// by address
+	std::vector< unsigned long long >			self_;			// by entry
+	std::map< uint, unsigned long long >		edges_;			// caller << 16 | callee
+	std::map< ushort, char >					entries_;		// call targets: kind
+	std::vector< frame_t >						stack_;			// shadow stack
+	std::vector< uint >							active_;		// frames by entry
+	std::map< ushort, unsigned long long >		inclusive_;		// by entry
+	unsigned long long							total_;
+	ushort										root_;			// reset entry
+	bool										started_;
+	std::vector< symbol_t >						symbols_;
+	Symbols										table_;
+};
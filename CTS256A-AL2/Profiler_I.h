@@ -0,0 +1,49 @@
+/*
+    CTS256A-AL2 - Profiler API.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// PROFILER API
+
+#include "runtime.h"
+
+class Profiler_I
+{
+public:
+	// instruction executed at pc
+	virtual void exec( ushort pc ) = 0;
+
+	// control transferred by CALL ('C'), TRAP ('T') or interrupt ('I');
+	// sp is the stack pointer after the return address push
+	virtual void call( ushort from, ushort to, uchar sp, char kind ) = 0;
+
+	// control returned by RETS or RETI; sp is the stack pointer after the pop
+	virtual void ret( ushort from, ushort to, uchar sp ) = 0;
+
+	// destructor
+	virtual ~Profiler_I()
+	{
+	}
+};
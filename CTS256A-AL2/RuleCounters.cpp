@@ -0,0 +1,233 @@
+/*
+    CTS256A-AL2 - Rule Counters.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "RuleCounters.h"
+
+#include "CTS256A_AL2.h"
+
+#include <errno.h>
+#include <string.h>
+
+// Rules table: pointers to the rules of the other characters, of A..Z and of
+// the digits; the digits rules end at the table
+#define RULES_TABLE		0xFFBC
+#define RULES_GROUPS	28
+
+static uchar rom( ushort addr )
+{
+	return CTS256A_AL2_ROM[addr & 0x0FFF];
+}
+
+void RuleCounters::getRules( std::map< ushort, uchar > &rules )
+{
+	for ( uint group = 0; group < RULES_GROUPS; ++group )
+	{
+		ushort addr = ( rom( RULES_TABLE + 2 * group ) << 8 ) | rom( RULES_TABLE + 2 * group + 1 );
+		ushort end = group + 1 < RULES_GROUPS
+			? ( rom( RULES_TABLE + 2 * group + 2 ) << 8 ) | rom( RULES_TABLE + 2 * group + 3 )
+			: RULES_TABLE;
+		uchar initial = !group ? 0 : group < RULES_GROUPS - 1 ? uchar( 'A' + group - 1 ) : '0';
+
+		// a rule ends with the closing bracket of its allophones
+		while ( addr < end )
+		{
+			rules[addr] = initial;
+			for ( uint brackets = 0; brackets < 2; )
+			{
+				if ( rom( addr++ ) & 0x80 )
+					++brackets;
+			}
+		}
+	}
+}
+
+const RuleCounters::counters_t &RuleCounters::getCounters( ushort rule ) const
+{
+	static const counters_t none;
+	std::map< ushort, counters_t >::const_iterator it = rules_.find( rule );
+	return it != rules_.end() ? it->second : none;
+}
+
+void RuleCounters::match( ushort rule )
+{
+	uint scanned = attempts_ ? attempts_ - 1 : 0;
+
+	counters_t &counters = rules_[rule];
+	++counters.matches;
+	counters.scanned += scanned;
+
+	counters_t &initial = initials_[initial_];
+	++initial.matches;
+	initial.scanned += scanned;
+}
+
+static double ratio( unsigned long long num, unsigned long long den )
+{
+	return den ? double( num ) / den : 0.0;
+}
+
+void RuleCounters::summary( Console_I &console )
+{
+	std::map< ushort, uchar > rules;
+	getRules( rules );
+
+	unsigned long long matches = 0, scanned = 0;
+	uint matched = 0;
+	for ( std::map< ushort, counters_t >::const_iterator it = rules_.begin(); it != rules_.end(); ++it )
+	{
+		matches += it->second.matches;
+		scanned += it->second.scanned;
+		if ( rules.find( it->first ) != rules.end() )
+			++matched;
+	}
+
+	console.printf( "Rules: %llu matches, %.2f rules scanned per match, %u of %u rules matched (%.1f %%)\n\n",
+		matches, ratio( scanned, matches ), matched, uint( rules.size() ), 100.0 * ratio( matched, rules.size() ) );
+}
+
+int RuleCounters::write( const char *name )
+{
+	FILE *out = stderr;
+	int err = *name ? fopen_s( &out, name, "w" ) : 0;
+	if ( err )
+		return err;
+
+	size_t len = strlen( name );
+	if ( len > 5 && !strcmp( name + len - 5, ".json" ) )
+		writeJson( out );
+	else
+		writeCsv( out );
+
+	err = ferror( out ) ? EIO : 0;
+	if ( out != stderr && fclose( out ) && !err )
+		err = errno;
+	return err;
+}
+
+// group of an initial
+static const char *getGroup( uchar initial )
+{
+	static char group[2];
+	if ( !initial )
+		return "other";
+	if ( initial == '0' )
+		return "digit";
+	group[0] = initial;
+	return group;
+}
+
+void RuleCounters::writeCsv( FILE *out )
+{
+	std::map< ushort, uchar > rules;
+	getRules( rules );
+
+	fprintf( out, "rule,group,matches,scanned,scanned_per_match,text\n" );
+	for ( std::map< ushort, uchar >::const_iterator it = rules.begin(); it != rules.end(); ++it )
+	{
+		const counters_t &counters = getCounters( it->first );
+		std::string text = CTS256A_AL2_Data_InOut::getRule( it->first, it->second >= 'A' ? it->second : 0 );
+
+		// quote the text, doubling its quotes
+		std::string quoted( "\"" );
+		for ( size_t i = 0; i < text.size(); ++i )
+		{
+			if ( text[i] == '"' )
+				quoted += '"';
+			quoted += text[i];
+		}
+		quoted += '"';
+
+		fprintf( out, "%04X,%s,%llu,%llu,%.2f,%s\n", it->first, getGroup( it->second ),
+			counters.matches, counters.scanned, ratio( counters.scanned, counters.matches ), quoted.c_str() );
+	}
+}
+
+// JSON string
+static std::string getJsonString( const std::string &text )
+{
+	std::string json( "\"" );
+	for ( size_t i = 0; i < text.size(); ++i )
+	{
+		uchar c = uchar( text[i] );
+		if ( c == '"' || c == '\\' )
+		{
+			json += '\\';
+			json += char( c );
+		}
+		else if ( c < 0x20 || c >= 0x7F )
+		{
+			char hex[8];
+			sprintf_s( hex, sizeof( hex ), "\\u%04x", c );
+			json += hex;
+		}
+		else
+		{
+			json += char( c );
+		}
+	}
+	return json + '"';
+}
+
+void RuleCounters::writeJson( FILE *out )
+{
+	std::map< ushort, uchar > rules;
+	getRules( rules );
+
+	unsigned long long matches = 0, scanned = 0;
+	uint matched = 0;
+
+	fprintf( out, "{\n  \"rules\": [\n" );
+	for ( std::map< ushort, uchar >::const_iterator it = rules.begin(); it != rules.end(); ++it )
+	{
+		const counters_t &counters = getCounters( it->first );
+		std::string text = CTS256A_AL2_Data_InOut::getRule( it->first, it->second >= 'A' ? it->second : 0 );
+
+		matches += counters.matches;
+		scanned += counters.scanned;
+		if ( counters.matches )
+			++matched;
+
+		fprintf( out, "    { \"rule\": \"%04X\", \"group\": \"%s\", \"matches\": %llu, \"scanned\": %llu, "
+			"\"scanned_per_match\": %.2f, \"text\": %s }%s\n",
+			it->first, getGroup( it->second ), counters.matches, counters.scanned,
+			ratio( counters.scanned, counters.matches ), getJsonString( text ).c_str(),
+			&*it == &*rules.rbegin() ? "" : "," );
+	}
+
+	fprintf( out, "  ],\n  \"initials\": [\n" );
+	for ( std::map< uchar, counters_t >::const_iterator it = initials_.begin(); it != initials_.end(); ++it )
+	{
+		const counters_t &counters = it->second;
+		fprintf( out, "    { \"initial\": %s, \"chars\": %llu, \"attempts\": %llu, \"matches\": %llu, "
+			"\"scanned\": %llu, \"attempts_per_char\": %.2f }%s\n",
+			getJsonString( std::string( 1, char( it->first ) ) ).c_str(), counters.chars, counters.attempts,
+			counters.matches, counters.scanned, ratio( counters.attempts, counters.chars ),
+			&*it == &*initials_.rbegin() ? "" : "," );
+	}
+
+	fprintf( out, "  ],\n  \"summary\": { \"rules\": %u, \"matched\": %u, \"coverage_pct\": %.1f, "
+		"\"matches\": %llu, \"scanned_per_match\": %.2f }\n}\n",
+		uint( rules.size() ), matched, 100.0 * ratio( matched, rules.size() ), matches, ratio( scanned, matches ) );
+}
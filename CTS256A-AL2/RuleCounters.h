@@ -0,0 +1,97 @@
+/*
+    CTS256A-AL2 - Rule Counters.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "runtime.h"
+#include "Console_I.h"
+
+#include <stdio.h>
+#include <map>
+
+// Rules matching counters: the firmware looks up the rules of the initial
+// (letter, digit or other character) one by one until one matches; counts,
+// per rule, the matches and the rules scanned before them, and reports them
+// with the coverage of the whole ROM rule set, in CSV or JSON.
+class RuleCounters
+{
+public:
+	RuleCounters() : initial_( 0 ), attempts_( 0 )
+	{
+	}
+
+	// rules of the initial selected
+	void select( uchar initial )
+	{
+		initial_ = initial;
+		attempts_ = 0;
+		++initials_[initial].chars;
+	}
+
+	// next rule tried
+	void attempt()
+	{
+		++attempts_;
+		++initials_[initial_].attempts;
+	}
+
+	// rule matched
+	void match( ushort rule );
+
+	// write the summary to the console
+	void summary( Console_I &console );
+
+	// write the report: JSON if the name ends with .json, else CSV; returns 0 or errno
+	int write( const char *name );
+
+	void writeCsv( FILE *out );
+
+	void writeJson( FILE *out );
+
+private:
+	struct counters_t
+	{
+		counters_t() : matches( 0 ), scanned( 0 ), chars( 0 ), attempts( 0 )
+		{
+		}
+
+		unsigned long long	matches;
+		unsigned long long	scanned;		// rules scanned before the matches
+		unsigned long long	chars;			// rules selections (initials only)
+		unsigned long long	attempts;		// rules tried (initials only)
+	};
+
+	// list the rules of the ROM rule set: address, initial of the group
+	// ('A'..'Z', '0' for the digits, 0 for the other characters)
+	static void getRules( std::map< ushort, uchar > &rules );
+
+	// counters of a rule
+	const counters_t &getCounters( ushort rule ) const;
+
+	uchar								initial_;
+	uint								attempts_;
+	std::map< ushort, counters_t >		rules_;			// by rule address
+	std::map< uchar, counters_t >		initials_;		// by initial
+};
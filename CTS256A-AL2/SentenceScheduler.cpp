@@ -0,0 +1,268 @@
+/*
+    CTS256A-AL2 - Sentence Scheduler.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "SentenceScheduler.h"
+
+SentenceScheduler::SentenceScheduler( SentenceConverter_I &converter, uint threads, uint window )
+	: converter_( converter ), window_( window ), stop_( 0 ), steals_( 0 )
+	, sentencesMetric_( 0 ), stealsMetric_( 0 ), inFlightMetric_( 0 ), waitMetric_( 0 ), convertMetric_( 0 )
+{
+	if ( !threads )
+		threads = 1;
+
+	if ( !window_ )
+		window_ = threads * SCHEDULER_WINDOW_PER_THREAD;
+
+	slots_.resize( window_, 0 );
+
+	jobs_ = CreateSemaphore( NULL, 0, 0x7FFFFFFF, NULL );
+	done_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+
+	for ( uint i = 0; i < threads; ++i )
+	{
+		Worker *worker = new Worker;
+		worker->scheduler = this;
+		worker->index = i;
+		InitializeCriticalSection( &worker->lock );
+		workers_.push_back( worker );
+	}
+
+	for ( uint i = 0; i < threads; ++i )
+		workers_[i]->thread = CreateThread( NULL, 0, workerProc, workers_[i], 0, NULL );
+}
+
+SentenceScheduler::~SentenceScheduler(void)
+{
+	InterlockedExchange( &stop_, 1 );
+	ReleaseSemaphore( jobs_, LONG( workers_.size() ), NULL );
+
+	for ( size_t i = 0; i < workers_.size(); ++i )
+	{
+		WaitForSingleObject( workers_[i]->thread, INFINITE );
+		CloseHandle( workers_[i]->thread );
+		DeleteCriticalSection( &workers_[i]->lock );
+		delete workers_[i];
+	}
+
+	for ( size_t i = 0; i < slots_.size(); ++i )
+		delete slots_[i];
+
+	CloseHandle( jobs_ );
+	CloseHandle( done_ );
+}
+
+void SentenceScheduler::setMetrics( Metrics &metrics )
+{
+	sentencesMetric_ = &metrics.counter( "cts256a_sentences_total", "Sentences converted." );
+	stealsMetric_ = &metrics.counter( "cts256a_scheduler_steals_total", "Sentences taken from other workers' queues." );
+	inFlightMetric_ = &metrics.gauge( "cts256a_scheduler_sentences_in_flight", "Sentences read and not yet written." );
+	waitMetric_ = &metrics.histogram( "cts256a_sentence_wait_seconds", "Time of the sentences queued to the workers.",
+		Metrics::latencyBounds, Metrics::nLatencyBounds );
+	convertMetric_ = &metrics.histogram( "cts256a_sentence_convert_seconds", "Conversion time of the sentences.",
+		Metrics::latencyBounds, Metrics::nLatencyBounds );
+}
+
+DWORD WINAPI SentenceScheduler::workerProc( void *param )
+{
+	Worker *worker = static_cast< Worker* >( param );
+	SentenceScheduler *scheduler = worker->scheduler;
+
+	while ( true )
+	{
+		WaitForSingleObject( scheduler->jobs_, INFINITE );
+
+		// no job only when stopping
+		Job *job = scheduler->take( worker->index );
+		if ( !job )
+			break;
+
+		if ( scheduler->sentencesMetric_ )
+		{
+			LARGE_INTEGER freq, taken, converted;
+			QueryPerformanceFrequency( &freq );
+			QueryPerformanceCounter( &taken );
+			scheduler->converter_.convert( job->seq, job->in, job->out );
+			QueryPerformanceCounter( &converted );
+
+			scheduler->sentencesMetric_->add();
+			scheduler->waitMetric_->observe( double( taken.QuadPart - job->queued.QuadPart ) / freq.QuadPart );
+			scheduler->convertMetric_->observe( double( converted.QuadPart - taken.QuadPart ) / freq.QuadPart );
+		}
+		else
+		{
+			scheduler->converter_.convert( job->seq, job->in, job->out );
+		}
+
+		InterlockedExchange( &job->done, 1 );
+		SetEvent( scheduler->done_ );
+	}
+
+	return 0;
+}
+
+// read next sentence; false on end of input
+bool SentenceScheduler::readSentence( std::istream &istr, std::string &sentence )
+{
+	// read through the stream buffer cursor, without the istream overhead
+	std::streambuf &input = *istr.rdbuf();
+	int c;
+
+	sentence.clear();
+
+	while ( ( c = input.sbumpc() ) != EOF && c != '\n' )
+		sentence += char( c );
+
+	// CR LF is a single line end, as with a text mode stream
+	if ( c == '\n' && !sentence.empty() && sentence[sentence.size() - 1] == '\r' )
+		sentence.erase( sentence.size() - 1 );
+
+	if ( c == EOF )
+		return !sentence.empty();
+
+	// empty lines belong to the preceding sentence
+	while ( input.sgetc() == '\n' || input.sgetc() == '\r' )
+	{
+		c = input.sbumpc();
+		if ( c == '\n' )
+			sentence += char( c );
+	}
+
+	// the end of input acts as a delimiter, so only the last sentence
+	// keeps its own delimiter
+	if ( input.sgetc() == EOF )
+		sentence += '\n';
+
+	return true;
+}
+
+// queue a job to a worker
+void SentenceScheduler::push( Job *job )
+{
+	Worker *worker = workers_[ job->seq % workers_.size() ];
+
+	QueryPerformanceCounter( &job->queued );
+
+	EnterCriticalSection( &worker->lock );
+	worker->queue.push_back( job );
+	LeaveCriticalSection( &worker->lock );
+
+	ReleaseSemaphore( jobs_, 1, NULL );
+}
+
+// take a job from worker's own queue, or steal one from another worker;
+// 0 only when stopping
+SentenceScheduler::Job *SentenceScheduler::take( uint index )
+{
+	size_t n = workers_.size();
+
+	// the scan is not atomic: another worker can take the job released for
+	// this one meanwhile, leaving its own job queued, so scan again
+	while ( !stop_ )
+	{
+		for ( size_t i = 0; i < n; ++i )
+		{
+			Worker *worker = workers_[ ( index + i ) % n ];
+			Job *job = 0;
+
+			EnterCriticalSection( &worker->lock );
+			if ( !worker->queue.empty() )
+			{
+				if ( !i )
+				{
+					// own queue: oldest first
+					job = worker->queue.front();
+					worker->queue.pop_front();
+				}
+				else
+				{
+					// other queue: newest first, leaving the head to its owner
+					job = worker->queue.back();
+					worker->queue.pop_back();
+				}
+			}
+			LeaveCriticalSection( &worker->lock );
+
+			if ( job )
+			{
+				if ( i )
+				{
+					InterlockedIncrement( &steals_ );
+					if ( stealsMetric_ )
+						stealsMetric_->add();
+				}
+				return job;
+			}
+		}
+
+		Sleep( 0 );
+	}
+
+	return 0;
+}
+
+// convert istr to ostr
+void SentenceScheduler::run( std::istream &istr, std::ostream &ostr )
+{
+	uint nextIn = 0, nextOut = 0;
+	std::string sentence;
+	bool more = readSentence( istr, sentence );
+
+	while ( true )
+	{
+		// write the completed sentences in input order
+		while ( nextOut != nextIn && slots_[ nextOut % window_ ]->done )
+		{
+			Job *&job = slots_[ nextOut % window_ ];
+			ostr << job->out;
+			ostr.flush();
+			delete job;
+			job = 0;
+			++nextOut;
+		}
+
+		if ( inFlightMetric_ )
+			inFlightMetric_->set( nextIn - nextOut );
+
+		if ( more && nextIn - nextOut < window_ )
+		{
+			Job *job = new Job;
+			job->seq = nextIn;
+			job->in.swap( sentence );
+			job->done = 0;
+			slots_[ nextIn % window_ ] = job;
+			++nextIn;
+			push( job );
+			more = readSentence( istr, sentence );
+		}
+		else if ( nextOut == nextIn )
+		{
+			break;
+		}
+		else
+		{
+			WaitForSingleObject( done_, INFINITE );
+		}
+	}
+}
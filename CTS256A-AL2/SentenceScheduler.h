@@ -0,0 +1,128 @@
+/*
+    CTS256A-AL2 - Sentence Scheduler.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "runtime.h"
+#include "Metrics.h"
+
+#include <windows.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+
+// Default number of sentences in flight per worker thread
+#define SCHEDULER_WINDOW_PER_THREAD 16
+
+// Sentence converter API, called concurrently from the worker threads
+
+class SentenceConverter_I
+{
+public:
+	// convert sentence number seq
+	virtual void convert( uint seq, const std::string &in, std::string &out ) = 0;
+
+	// destructor
+	virtual ~SentenceConverter_I()
+	{
+	}
+};
+
+// Splits the input at line delimiters and converts the sentences on a
+// work-stealing pool of worker threads. The results are written in input
+// order, with at most window sentences buffered between input and output.
+
+class SentenceScheduler
+{
+public:
+	SentenceScheduler( SentenceConverter_I &converter, uint threads, uint window = 0 );
+
+	~SentenceScheduler(void);
+
+	// convert istr to ostr
+	void run( std::istream &istr, std::ostream &ostr );
+
+	// count the sentences and the steals, and time the sentences stages
+	void setMetrics( Metrics &metrics );
+
+	// get number of worker threads
+	uint getThreads()
+	{
+		return uint( workers_.size() );
+	}
+
+	// get number of sentences taken from other workers' queues
+	uint getSteals()
+	{
+		return uint( steals_ );
+	}
+
+private:
+	struct Job
+	{
+		uint			seq;
+		std::string		in;
+		std::string		out;
+		volatile LONG	done;
+		LARGE_INTEGER	queued;		// time queued to a worker
+	};
+
+	struct Worker
+	{
+		SentenceScheduler	*scheduler;
+		uint				index;
+		std::deque< Job* >	queue;
+		CRITICAL_SECTION	lock;
+		HANDLE				thread;
+	};
+
+	static DWORD WINAPI workerProc( void *param );
+
+	// read next sentence; false on end of input
+	bool readSentence( std::istream &istr, std::string &sentence );
+
+	// queue a job to a worker
+	void push( Job *job );
+
+	// take a job from worker's own queue, or steal one from another worker;
+	// 0 only when stopping
+	Job *take( uint index );
+
+	SentenceConverter_I		&converter_;
+	std::vector< Worker* >	workers_;
+	std::vector< Job* >		slots_;
+	uint					window_;
+	HANDLE					jobs_;			// semaphore: number of queued jobs
+	HANDLE					done_;			// event: a job has completed
+	volatile LONG			stop_;
+	volatile LONG			steals_;
+	Metrics::Counter		*sentencesMetric_;
+	Metrics::Counter		*stealsMetric_;
+	Metrics::Gauge			*inFlightMetric_;
+	Metrics::Histogram		*waitMetric_;		// queued to taken
+	Metrics::Histogram		*convertMetric_;
+};
@@ -62,14 +62,14 @@ symbol_t* Symbols::getSymbol( char seg, uint val )
 // get label of given code address
 char* Symbols::getLabel(uint val)
 {
-    static char name[40];
+    char *name = label_;
 
 	symbol_t *sym = getSymbol( 'C', val );
     if (sym != NULL){
         strcpy (name, sym->name);
         strcat (name, ":");
     } else {
-        name[0] = 0; // static
+        name[0] = 0;
     }
 
     return name;
@@ -78,7 +78,7 @@ char* Symbols::getLabel(uint val)
 // get label and offset of given code address
 char* Symbols::getLabelOffset(uint val)
 {
-    static char name[40] ;
+    char *name = labelOffset_;
 	int i;
 
 	symbol_t symtofind;
@@ -92,7 +92,7 @@ char* Symbols::getLabelOffset(uint val)
 			break;
 	}
 
-    name[0] = 0; // static
+    name[0] = 0;
 
 	if ( i > 0 )
 	{
@@ -40,6 +40,11 @@ struct symbol_t
 class Symbols
 {
 public:
+	Symbols() : symbols_( 0 ), nSymbols_( 0 )
+	{
+		label_[0] = labelOffset_[0] = 0;
+	}
+
 	// Attach Z80 to external symbol table
 	void setSymbols( symbol_t *pSymbols, int pNSymbols )
 	{
@@ -65,4 +70,6 @@ public:
 private:
 	symbol_t	*symbols_;
 	int			nSymbols_;
+	char		label_[40];
+	char		labelOffset_[40];
 };
@@ -213,11 +213,14 @@ void TMS7000CPU::simintprocess()
 			return;
 
 		itrap = 0xFFFE - ( itrap << 1 );
+		ushort pc = pc_;
 		data[++sp] = st;
 		data[++sp] = pc_ >> 8;
 		data[++sp] = pc_ & 0xFF;
 		pSt->i = 0;
 		pc_ = ( getdata( itrap ) << 8 ) | getdata( itrap+1 );
+		if ( profiler_ )
+			profiler_->call( pc, pc_, sp, 'I' );
 	}
 	return;
 
@@ -236,6 +239,10 @@ void TMS7000CPU::sim()
 	// Execute opcode
 	this->simop( opcode );
 
+	// Profile it
+	if ( profiler_ )
+		profile( opcode );
+
 	// Update timers
 	simtimers();
 
@@ -249,6 +256,32 @@ void TMS7000CPU::sim()
 	cycles = 0;
 }
 
+bool TMS7000CPU::isDefined( uchar opcode )
+{
+	return instrTable[opcode].mnemon != DB;
+}
+
+void TMS7000CPU::profile( const uchar opcode )
+{
+	profiler_->exec( pc0_ );
+
+	switch ( instrTable[opcode].mnemon )
+	{
+	case CALL:
+		profiler_->call( pc0_, pc_, sp, 'C' );
+		break;
+	case TRAP:
+		// not emulated: stopped on the TRAP
+		if ( pc_ != pc0_ )
+			profiler_->call( pc0_, pc_, sp, 'T' );
+		break;
+	case RETS:
+	case RETI:
+		profiler_->ret( pc0_, pc_, sp );
+		break;
+	}
+}
+
 void TMS7000CPU::simop( const uchar opCode )
 {
 	const instr_t &instr = this->instrTable[opCode];
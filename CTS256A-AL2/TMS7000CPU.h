@@ -30,6 +30,7 @@
 #include "CPU.h"
 #include "ConsoleProxy.h"
 #include "InOut_I.h"
+#include "Profiler_I.h"
 
 class TMS7000CPU;
 
@@ -46,7 +47,7 @@ class TMS7000CPU :
 	public CPU, public ConsoleProxy, public Memory_I, public InOut_I
 {
 public:
-	TMS7000CPU() : CPU()
+	TMS7000CPU() : CPU(), profiler_( 0 )
 	{
 		init();
 	}
@@ -152,6 +153,12 @@ public:
 		return *pSt;
 	}
 
+	// Set Profiler (0 to disable)
+	void setProfiler( Profiler_I *profiler )
+	{
+		profiler_ = profiler;
+	}
+
 	uchar& getSp()
 	{
 		return sp;
@@ -185,6 +192,12 @@ public:
 
 	void simop( const uchar opcode );
 
+	// Profile the executed statement
+	void profile( const uchar opcode );
+
+	// Is the opcode defined ?
+	static bool isDefined( uchar opcode );
+
 	void stop();
 
 public:
@@ -202,6 +215,7 @@ private:
 	Memory_I		*pExtData_;
 	InOut_I			*pExtInOut_;
 	ushort			pc0_;
+	Profiler_I		*profiler_;
 
 	// Internal Peripherals
 	uchar			iocnt0_;				///< P0
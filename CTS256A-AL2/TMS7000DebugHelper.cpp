@@ -27,8 +27,6 @@
 
 #include "TMS7000DebugHelper.h"
 
-#include "disas7000.h"
-
 #include <cstring>
 
 void TMS7000DebugHelper::printRegNamesLine( Console_I &console )
@@ -68,20 +66,15 @@ void TMS7000DebugHelper::printTabSourceWidth( Console_I &console )
 	console.printf( "%*c", 36, ' ' );
 }
 
-static CPU *s_pCpu = 0;
-
-static uchar s_getData( ushort addr )
+static uchar getCpuData( void *object, ushort addr )
 {
-	if ( s_pCpu )
-		return s_pCpu->getdata( addr );
-	return 0xFF;
+	return static_cast<CPU*>( object )->getdata( addr );
 }
 
 const char *TMS7000DebugHelper::getSource( uint &_pc )
 {
-	static char src[80];
-	s_pCpu = &cpu_;
-	setTms7000MemIO( s_getData );
+	char *src = src_;
+	disass_.setMemIO( getCpuData, static_cast<CPU*>( &cpu_ ) );
 	disass_.setPC( _pc );
 	strcpy( src, disass_.source() );
 	_pc = disass_.getPC();
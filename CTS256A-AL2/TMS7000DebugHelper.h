@@ -91,5 +91,6 @@ private:
 	uchar					*data_;
 	st_t					&flags_;
 	uchar					&sp_;
+	char					src_[80];
 };
 
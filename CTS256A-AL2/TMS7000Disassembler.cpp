@@ -26,7 +26,6 @@
 #pragma warning(disable:4996)	// warning C4996: '%0': This function or variable may be unsafe.
 
 #include "TMS7000Disassembler.h"
-#include "disas7000.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -40,7 +39,7 @@
 //  return hex-string or label for double-byte x( dasm )
 const char *TMS7000Disassembler::getxaddr( uint x )
 {
-	return getXAddr( x );
+	return getXAddr( &ctx_, x );
 }
 
 
@@ -59,7 +58,7 @@ const char *TMS7000Disassembler::getbitaddr()
 // fetch long external address and return it as hex string or as label
 const char *TMS7000Disassembler::getladdr()
 {
-	return getLAddr();
+	return getLAddr( &ctx_ );
 }
 
 // fetch absolute segment external address and return it as hex string or as label
@@ -96,9 +95,9 @@ const char *TMS7000Disassembler::getoperand2( int /*opcode*/ )
 // get single instruction source
 const char *TMS7000Disassembler::source()
 {
-	::pc = pc_;
-	const char *s = ::source();
-	pc_ =::pc;
+	ctx_.pc = pc_;
+	const char *s = ::source( &ctx_ );
+	pc_ = ctx_.pc;
 	return s;
 }
 
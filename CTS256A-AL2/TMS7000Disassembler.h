@@ -26,6 +26,7 @@
 #pragma once
 
 #include "disassembler.h"
+#include "disas7000.h"
 
 class TMS7000Disassembler :
 	public Disassembler
@@ -33,6 +34,7 @@ class TMS7000Disassembler :
 public:
 	TMS7000Disassembler(void)
 	{
+		initTms7000( &ctx_ );
 	}
 
 	~TMS7000Disassembler(void)
@@ -68,5 +70,20 @@ public:
 
 	// get single instruction source
 	virtual const char *source();
+
+	// set memory reader
+	void setMemIO( readfptr_t getData, void *object )
+	{
+		setTms7000MemIO( &ctx_, getData, object );
+	}
+
+	// set symbols table (labels of the addresses)
+	void setSymbolsTable( symbol_t *symbols, int nSymbols )
+	{
+		setTms7000Symbols( &ctx_, symbols, nSymbols, nSymbols );
+	}
+
+private:
+	disas7000_t	ctx_;
 };
 
@@ -0,0 +1,153 @@
+/*
+    CTS256A-AL2 - Binary Trace Ring.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma warning(disable:4996)	// warning C4996: '%0': This function or variable may be unsafe.
+
+#include "TraceRing.h"
+
+#include "CTS256A_AL2.h"
+
+#include <errno.h>
+#include <string.h>
+
+// Dump file header
+struct header_t
+{
+	char	magic[4];		// "CTSR"
+	uint	version;		// 1
+	uint	size;			// record size
+	uint	count;			// records in the file
+	uint	lost;			// records lost by the wrap-around
+	uint	reserved[3];
+};
+
+static const char magic[4] = { 'C', 'T', 'S', 'R' };
+
+int TraceRing::init( uint n )
+{
+	uint size = 16;
+	while ( size < n && size < 0x80000000 )
+		size <<= 1;
+
+	delete[] records_;
+	records_ = new record_t[size];
+	memset( records_, 0, size * sizeof( record_t ) );
+	mask_ = size - 1;
+	head_ = 0;
+	return 0;
+}
+
+int TraceRing::dump( const char *name ) const
+{
+	FILE *file = fopen( name, "wb" );
+	if ( !file )
+		return errno;
+
+	const uint head = head_;
+	const uint first = head > mask_ + 1 ? head - mask_ - 1 : 0;
+
+	header_t header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, magic, sizeof( magic ) );
+	header.version = 1;
+	header.size = sizeof( record_t );
+	header.count = head - first;
+	header.lost = first;
+
+	int err = fwrite( &header, sizeof( header ), 1, file ) == 1 ? 0 : EIO;
+	for ( uint i = first; !err && i != head; ++i )
+	{
+		if ( fwrite( &records_[i & mask_], sizeof( record_t ), 1, file ) != 1 )
+			err = EIO;
+	}
+
+	if ( fclose( file ) && !err )
+		err = EIO;
+	return err;
+}
+
+int TraceRing::decode( const char *name, FILE *out )
+{
+	FILE *file = fopen( name, "rb" );
+	if ( !file )
+		return errno;
+
+	header_t header;
+	int err = 0;
+	if ( fread( &header, sizeof( header ), 1, file ) != 1
+		|| memcmp( header.magic, magic, sizeof( magic ) ) || header.size != sizeof( record_t ) )
+		err = EINVAL;
+
+	if ( !err && header.lost )
+		fprintf( out, "[%u records lost]\n", header.lost );
+
+	char text[TEXT_SIZE];
+	record_t record;
+	for ( uint i = 0; !err && i < header.count; ++i )
+	{
+		if ( fread( &record, sizeof( record ), 1, file ) != 1 )
+		{
+			err = EINVAL;
+			break;
+		}
+		format( record, text );
+		fputs( text, out );
+	}
+
+	fclose( file );
+	return err;
+}
+
+void TraceRing::format( const record_t &record, char *text )
+{
+	switch ( record.event )
+	{
+	case EV_TRIG:
+		sprintf( text, " %04x 7:%d 9:%d TRIG\n", record.a, record.b, record.c );
+		break;
+	case EV_NOTRIG:
+		sprintf( text, " %04x 7:%d 9:%d NOTRIG\n", record.a, record.b, record.c );
+		break;
+	case EV_AVAIL:
+		sprintf( text, " - avail %d:", int( record.b ) );
+		break;
+	case EV_IN_EOF:
+		strcpy( text, " in: EOF\n" );
+		break;
+	case EV_IN:
+		sprintf( text, " in: %c\n", record.a );
+		break;
+	case EV_EOFCTR:
+		sprintf( text, "%5d ", record.b );
+		break;
+	case EV_SP0256:
+		sprintf( text, " SP0256: %02X=%s\n", record.a, record.a < 0x40 ? SP0256_labels[record.a] : "**" );
+		break;
+	default:
+		sprintf( text, "[event %d]\n", record.event );
+		break;
+	}
+}
@@ -0,0 +1,119 @@
+/*
+    CTS256A-AL2 - Binary Trace Ring.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "runtime.h"
+
+#include <stdio.h>
+
+// Binary trace of the I/O events of the verbose mode: fixed-size records in
+// a ring, written by the emulation thread without lock, dumped to a file and
+// decoded offline into the text of the verbose mode. The records are stamped
+// (d) with the number of input characters read.
+class TraceRing
+{
+public:
+	enum event_t
+	{
+		EV_TRIG = 1,	// Input interrupt triggered: a=PC, b=R7, c=R9
+		EV_NOTRIG,		// Input interrupt not triggered: a=PC, b=R7, c=R9
+		EV_AVAIL,		// Input characters available: b=count
+		EV_IN_EOF,		// Input end of file
+		EV_IN,			// Input character: a=char
+		EV_EOFCTR,		// Output after the end of file: b=counter
+		EV_SP0256		// Allophone output: a=allophone
+	};
+
+	struct record_t
+	{
+		ushort	event;
+		ushort	a;
+		uint	b;
+		uint	c;
+		uint	d;
+	};
+
+	TraceRing() : records_( 0 ), mask_( 0 ), head_( 0 ), stamp_( 0 )
+	{
+	}
+
+	~TraceRing()
+	{
+		delete[] records_;
+	}
+
+	// ring of at least n records; returns 0 or errno
+	int init( uint n );
+
+	// write a record: single writer
+	void write( ushort event, ushort a = 0, uint b = 0, uint c = 0 )
+	{
+		record_t &record = records_[head_ & mask_];
+		record.event = event;
+		record.a = a;
+		record.b = b;
+		record.c = c;
+		record.d = stamp_;
+		// publish the record (volatile store: release on x86/x64)
+		head_ = head_ + 1;
+	}
+
+	// stamp of the next records
+	void setStamp( uint stamp )
+	{
+		stamp_ = stamp;
+	}
+
+	uint getRecords() const
+	{
+		return head_;
+	}
+
+	// records lost by the wrap-around
+	uint getLost() const
+	{
+		return head_ > mask_ + 1 ? head_ - mask_ - 1 : 0;
+	}
+
+	// dump the ring to a file; returns 0 or errno
+	int dump( const char *name ) const;
+
+	// decode a dumped trace to text; returns 0 or errno
+	static int decode( const char *name, FILE *out );
+
+	// text of a record, as printed by the verbose mode
+	static void format( const record_t &record, char *text );
+
+	// size of the text buffer of format()
+	enum { TEXT_SIZE = 80 };
+
+private:
+	record_t			*records_;
+	uint				mask_;			// number of records - 1 (power of 2)
+	volatile uint		head_;			// records written (wraps at 2^32)
+	uint				stamp_;
+};
@@ -93,40 +93,35 @@ enum {		// operand
 	};
 
 
-char			noNewEqu = 0;
-char			labelcolon = 0;
-
-signed char		offset;
-uint			pc;
-
-int				pcOffset = 0;
-ushort			pcOffsetBeg, pcOffsetEnd;
-char			pcOffsetSeg = 'R';
-
-// Symbols table
-symbol_t		*tms7000Symbols = NULL;
-uint			tms7000SymbolsSize = 0;
-uint			nTms7000Symbols = 0;
-uint			nNewTms7000Symbols = 0;
-
-static char *comment;
+// Data Read Routine (memory address space)
+static uchar getData_null( void* /*object*/, ushort /*addr*/ )
+{
+	return 0xFF;
+}
 
+// Initialize disassembler context
+void initTms7000( disas7000_t *ctx )
+{
+	memset( ctx, 0, sizeof( disas7000_t ) );
+	ctx->pcOffsetSeg = 'R';
+	ctx->getData = getData_null;
+}
 
-void setTms7000Symbols( symbol_t *pSymbols, int pNSymbols, int pSymbolsSize )
+void setTms7000Symbols( disas7000_t *ctx, symbol_t *pSymbols, int pNSymbols, int pSymbolsSize )
 {
-	tms7000Symbols = pSymbols;
-	nTms7000Symbols = pNSymbols;
-	nNewTms7000Symbols = nTms7000Symbols;
-	tms7000SymbolsSize = pSymbolsSize;
-	qsort(tms7000Symbols, nTms7000Symbols, sizeof(symbol_t), (compfptr_t)symSort);
+	ctx->symbols = pSymbols;
+	ctx->nSymbols = pNSymbols;
+	ctx->nNewSymbols = ctx->nSymbols;
+	ctx->symbolsSize = pSymbolsSize;
+	qsort(ctx->symbols, ctx->nSymbols, sizeof(symbol_t), (compfptr_t)symSort);
 }
 
-void updateTms7000Symbols()
+void updateTms7000Symbols( disas7000_t *ctx )
 {
-	setTms7000Symbols( tms7000Symbols, nNewTms7000Symbols, tms7000SymbolsSize );
+	setTms7000Symbols( ctx, ctx->symbols, ctx->nNewSymbols, ctx->symbolsSize );
 }
 
-void resetTms7000Symbols()
+void resetTms7000Symbols( disas7000_t * /*ctx*/ )
 {
 }
 
@@ -147,69 +142,66 @@ int  symCompName(symbol_t *a, symbol_t *b)
     return strcmp (a->name, b->name);
 }
 
-static char getCodeSeg()
+static char getCodeSeg( disas7000_t *ctx )
 {
-	return pcOffset ? pcOffsetSeg : 'C';
+	return ctx->pcOffset ? ctx->pcOffsetSeg : 'C';
 }
 
 
 // get label of given code address
-char* getLabel(uint val, char /*ds*/)
+char* getLabel( disas7000_t *ctx, uint val, char /*ds*/ )
 {
-    static char name[40] ;
+    char *name = ctx->label;
 
     symbol_t symtofind[1];
     symbol_t *sym;
 
-	comment = NULL;
+	ctx->comment = NULL;
 
 	name[0] = 0;
 
 	symtofind->val = val;
-    symtofind->seg = getCodeSeg();
+    symtofind->seg = getCodeSeg( ctx );
 
-    sym = (symbol_t*)bsearch(symtofind, tms7000Symbols, nTms7000Symbols, sizeof(symbol_t), (compfptr_t)symSort);
+    sym = (symbol_t*)bsearch(symtofind, ctx->symbols, ctx->nSymbols, sizeof(symbol_t), (compfptr_t)symSort);
     if (sym == NULL)
 	{
 		return name;
 	}
 
     strcpy (name, sym->name);
-	if ( labelcolon )
+	if ( ctx->labelcolon )
 		strcat (name, ":");
 
     return name;
 }
 
 // set label generated (DS labels)
-void setLabelGen( uint val )
+void setLabelGen( disas7000_t *ctx, uint val )
 {
     symbol_t symtofind[1];
     symbol_t *sym;
 
 	symtofind->val = val;
-    symtofind->seg = getCodeSeg();
+    symtofind->seg = getCodeSeg( ctx );
 
-    sym = (symbol_t*)bsearch(symtofind, tms7000Symbols, nTms7000Symbols, sizeof(symbol_t), (compfptr_t)symSort);
+    sym = (symbol_t*)bsearch(symtofind, ctx->symbols, ctx->nSymbols, sizeof(symbol_t), (compfptr_t)symSort);
 }
 
 // get label and offset of given code address
-char* getLabelOffset(uint val)
+char* getLabelOffset( disas7000_t *ctx, uint val )
 {
-    static char name[40] ;
+    char *name = ctx->labelOffset;
 	unsigned i;
 
     symbol_t symtofind[1];
-    symbol_t *sym;
 
     symtofind->val = val;
-    symtofind->seg = getCodeSeg();
-
-    sym = tms7000Symbols;
+    symtofind->seg = getCodeSeg( ctx );
 
-	for ( i=0; i<nTms7000Symbols; ++i )
+	for ( i=0; i<ctx->nSymbols; ++i )
 	{
-		if ( symSort( symtofind, tms7000Symbols+i ) < 0 )
+		if ( symSort( symtofind, ctx->symbols+i ) < 0 )
 			break;
 	}
 
@@ -217,44 +209,35 @@ char* getLabelOffset(uint val)
 
 	if (i>0)
 	{
-		if ( tms7000Symbols[i-1].val && val-tms7000Symbols[i-1].val < 0x0400 )
-			sprintf( name, "%s+%Xh", tms7000Symbols[i-1].name, val-tms7000Symbols[i-1].val );
+		if ( ctx->symbols[i-1].val && val-ctx->symbols[i-1].val < 0x0400 )
+			sprintf( name, "%s+%Xh", ctx->symbols[i-1].name, val-ctx->symbols[i-1].val );
     }
 
     return name;
 }
 
-// Data Read Routine (memory address space)
-uchar getData_null(ushort /*addr*/)
+void setTms7000MemIO( disas7000_t *ctx, readfptr_t getData, void *object )
 {
-	return 0xFF;
+	ctx->getData = getData ? getData : getData_null;
+	ctx->object = object;
 }
 
-readfptr_t vgetData = getData_null;
-
-void setTms7000MemIO( readfptr_t getData )
-{
-	vgetData = getData;
-}
-
-#define getData (*vgetData)
-
 //  get next instruction byte (sim)
-#define fetch() getData( ushort( pc++ ) )
+#define fetch() ctx->getData( ctx->object, ushort( ctx->pc++ ) )
 
 //  return hex-string or label for double-byte x (dasm)
-char* getXAddr( uint x )
+char* getXAddr( disas7000_t *ctx, uint x )
 {
-	static char addr[41];
+	char *addr = ctx->xaddr;
 	symbol_t symtofind;
 	symbol_t *sym;
 
-	comment = NULL;
+	ctx->comment = NULL;
 
 	symtofind.val = x;
-	symtofind.seg = getCodeSeg();
+	symtofind.seg = getCodeSeg( ctx );
 
-	sym = (symbol_t*)bsearch(&symtofind, tms7000Symbols, nTms7000Symbols, sizeof(symbol_t), (compfptr_t)symSort);
+	sym = (symbol_t*)bsearch(&symtofind, ctx->symbols, ctx->nSymbols, sizeof(symbol_t), (compfptr_t)symSort);
 
 	if ( sym )
 	{
@@ -263,8 +246,8 @@ char* getXAddr( uint x )
 	else
 	{
 		uint xorg = x;
-		if ( pcOffsetSeg != 'C' )
-			xorg -= pcOffset;
+		if ( ctx->pcOffsetSeg != 'C' )
+			xorg -= ctx->pcOffset;
 
 		sprintf( addr, ">%04X", xorg );
 	}
@@ -272,15 +255,15 @@ char* getXAddr( uint x )
 }
 
 // get comment associated to label of given code address from last getXAddr()/getLabel() call
-char* getLastComment()
+char* getLastComment( disas7000_t *ctx )
 {
-	return comment;
+	return ctx->comment;
 }
 
 //	return internal byte address as label or as hex string
-char* getDataAddr ()
+char* getDataAddr( disas7000_t *ctx )
 {
-	static char addr[41];
+	char *addr = ctx->dataAddr;
 	unsigned x;
 	symbol_t symtofind;
 	symbol_t *sym;
@@ -291,7 +274,7 @@ char* getDataAddr ()
 	symtofind.val = x;
 	symtofind.seg = 'D';
 
-	sym = (symbol_t*)bsearch( &symtofind, tms7000Symbols, nTms7000Symbols, sizeof( symbol_t ), (compfptr_t)symSort );
+	sym = (symbol_t*)bsearch( &symtofind, ctx->symbols, ctx->nSymbols, sizeof( symbol_t ), (compfptr_t)symSort );
 
 	if (sym != NULL && sym->name[0] != 0)
 	{
@@ -306,37 +289,37 @@ char* getDataAddr ()
 
 
 // fetch long external address and return it as hex string or as label
-char* getLAddr()
+char* getLAddr( disas7000_t *ctx )
 {
 	uint x;
-	char oldseg = pcOffsetSeg;
+	char oldseg = ctx->pcOffsetSeg;
 	char *ret;
 
 	x = fetch () << 8;
 	x += fetch ();
-	if ( pcOffset && x + pcOffset >= pcOffsetBeg && x + pcOffset < pcOffsetEnd )
-		x += pcOffset;
+	if ( ctx->pcOffset && x + ctx->pcOffset >= ctx->pcOffsetBeg && x + ctx->pcOffset < ctx->pcOffsetEnd )
+		x += ctx->pcOffset;
 	else
-		pcOffsetSeg = 'C';
-	ret = getXAddr( x );
-	pcOffsetSeg = oldseg;
+		ctx->pcOffsetSeg = 'C';
+	ret = getXAddr( ctx, x );
+	ctx->pcOffsetSeg = oldseg;
 	return ret;
 }
 
 // fetch short relative external address and return it as hex string or as label
-char* getSAddr()
+char* getSAddr( disas7000_t *ctx )
 {
 	uint x;
 	signed char d;
 	d = (signed char) fetch ();
-	x = pc + d;
-	return getXAddr( x );
+	x = ctx->pc + d;
+	return getXAddr( ctx, x );
 }
 
 // return operand name or value
-char* getOperand(int opcode, int opn)
+char* getOperand( disas7000_t *ctx, int opcode, int opn )
 {
-	static char op[41];
+	char *op = ctx->operand;
 	unsigned x;
 
     strcpy (op, "??");
@@ -363,22 +346,22 @@ char* getOperand(int opcode, int opn)
 		break;
 	case WORD:
 		strcpy( op, "%" );
-		strcat( op, getLAddr() );
+		strcat( op, getLAddr( ctx ) );
 		break;
 	case WORD_B:
 		strcpy( op, "%" );
-		strcat( op, getLAddr() );
+		strcat( op, getLAddr( ctx ) );
 		strcat( op, "(B)" );
 		break;
 	case OFST:
-		return getSAddr();
+		return getSAddr( ctx );
 	case ADDR:
 		strcpy( op, "@" );
-		strcat( op, getLAddr() );
+		strcat( op, getLAddr( ctx ) );
 		break;
 	case ADDR_B:
 		strcpy( op, "@" );
-		strcat( op, getLAddr() );
+		strcat( op, getLAddr( ctx ) );
 		strcat( op, "(B)" );
 		break;
 	case ATRN:
@@ -398,15 +381,15 @@ char* getOperand(int opcode, int opn)
 }
 
 // get 1st operand name or value
-char* getOperand1(int opcode)
+char* getOperand1( disas7000_t *ctx, int opcode )
 {
-	return getOperand(opcode, instrTable[opcode].opn1);
+	return getOperand( ctx, opcode, instrTable[opcode].opn1 );
 }
 
 // get 2nd operand name or value
-char* getOperand2(int opcode)
+char* getOperand2( disas7000_t *ctx, int opcode )
 {
-	return getOperand(opcode, instrTable[opcode].opn2);
+	return getOperand( ctx, opcode, instrTable[opcode].opn2 );
 }
 
 // add comment if any
@@ -426,10 +409,10 @@ void addComment( char *src, int size, char *pComment )
 }
 
 // get single instruction source
-char* source ()
+char* source( disas7000_t *ctx )
 {
 	ushort opcode;
-	static char src[80];
+	char *src = ctx->src;
 	size_t i;
 	char* op;
 
@@ -442,13 +425,13 @@ char* source ()
 
 	src[i] = '\0';
 
-	comment = 0;
+	ctx->comment = 0;
 
-	op = getOperand1( opcode );
+	op = getOperand1( ctx, opcode );
 	if ( op )
 	{
 		strcat( src, op );
-		op = getOperand2( opcode );
+		op = getOperand2( ctx, opcode );
 		if ( op )
 		{
 			strcat( src, "," );
@@ -460,12 +443,12 @@ char* source ()
 			case BTJZ:
 			case BTJZP:
 				strcat( src, "," );
-				strcat( src, getSAddr() );
+				strcat( src, getSAddr( ctx ) );
 			}
 		}
 	}
 
-	addComment( src, sizeof(src), comment );
+	addComment( src, sizeof(ctx->src), ctx->comment );
 
 	for (i=strlen(src);i<48;i++) {
 		src[i] = ' ';
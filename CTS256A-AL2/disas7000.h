@@ -34,50 +34,73 @@
 
 
 typedef int (*compfptr_t)(const void*, const void*);
-typedef uchar (*readfptr_t)( ushort );
-typedef uchar (*writefptr_t)( ushort, uchar );
-
+typedef uchar (*readfptr_t)( void*, ushort );
+typedef uchar (*writefptr_t)( void*, ushort, uchar );
+
+
+// Disassembler context (one per disassembler instance)
+struct disas7000_t
+{
+	uint		pc;						// current address
+	char		*comment;				// comment of last getXAddr()/getLabel() call
+	char		noNewEqu;
+	char		labelcolon;
+
+	int			pcOffset;
+	ushort		pcOffsetBeg, pcOffsetEnd;
+	char		pcOffsetSeg;
+
+	// Symbols table
+	symbol_t	*symbols;
+	uint		symbolsSize;
+	uint		nSymbols;
+	uint		nNewSymbols;
+
+	// Memory access
+	readfptr_t	getData;
+	void		*object;
+
+	// Result buffers
+	char		label[40];
+	char		labelOffset[40];
+	char		xaddr[41];
+	char		dataAddr[41];
+	char		operand[41];
+	char		src[80];
+};
+
+// Initialize disassembler context
+void initTms7000( disas7000_t *ctx );
 
 // get label of given code address
-char* getLabel( uint val, char ds );
+char* getLabel( disas7000_t *ctx, uint val, char ds );
 
 // set label generated (DS labels)
-void setLabelGen( uint val );
+void setLabelGen( disas7000_t *ctx, uint val );
 
 // get label of given code address
-char* getXAddr( uint val );
+char* getXAddr( disas7000_t *ctx, uint val );
 
 // get comment associated to label of given code address from last getXAddr()/getLabel() call
-char* getLastComment();
+char* getLastComment( disas7000_t *ctx );
 
 // fetch long external address and return it as hex string or as label
-char* getLAddr();
+char* getLAddr( disas7000_t *ctx );
 
 // get single instruction source
-char* source();
-
-// Z-80 simulator
-extern uint		pc;
-
-extern char		noNewEqu;
-
-extern uint		nTms7000Symbols;
-extern symbol_t	*tms7000Symbols;
-extern int		pcOffset;
-extern ushort	pcOffsetBeg, pcOffsetEnd;
-extern char		pcOffsetSeg;
+char* source( disas7000_t *ctx );
 
 extern instr_t instrTable[];
 
 // Attach TMS7000 to external symbol table
-void setTms7000Symbols( symbol_t *pSymbols, int pNSymbols, int pSymbolsSize );
+void setTms7000Symbols( disas7000_t *ctx, symbol_t *pSymbols, int pNSymbols, int pSymbolsSize );
 
-void updateTms7000Symbols();
+void updateTms7000Symbols( disas7000_t *ctx );
 
-void resetTms7000Symbols();
+void resetTms7000Symbols( disas7000_t *ctx );
 
 // Attach TMS7000 to memory and I/O ports
-void setTms7000MemIO( readfptr_t getdata );
+void setTms7000MemIO( disas7000_t *ctx, readfptr_t getdata, void *object );
 
 // Sort symbols
 int  symSort(const void *a, const void *b);
@@ -34,17 +34,27 @@
 #include "TMS7000CPU.h"
 #include "TMS7000DebugHelper.h"
 #include "TMS7000Disassembler.h"
+#include "MappedInput.h"
+#include "Benchmark.h"
+#include "MicroBenchmarks.h"
+#include "GoldenSuite.h"
+#include "SentenceScheduler.h"
+#include "MetricsServer.h"
 
 #include <sstream>
-#include <fstream>
-#include <memory>
+#include <iterator>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
 
 void help()
 {
 	puts(
 		"GI/Microchip CTS256A-AL2(tm) Code-To-Speech Speech Processor\n\n"
 		"Usage:\n"
-		"cts256a-al2 [-iFile] [-t] [-b] [-e] [-d] [-v] [-n] [text]\n"
+		"cts256a-al2 [-iFile] [-t] [-b] [-e] [-d] [-v] [-n] [-w] [-pStraps] [-fPolicy] [-lMs] [-j[Threads]] [-oResults[,Baseline[,Pct]]]\n"
+		"            [-u[Filter][,Iterations[,Repetitions]]] [-y[+]GoldenDir] [-x[File]] [-c[File]]\n"
+		"            [-z[+]TraceFile[,Records]] [-h{Port|MetricsFile[,Ms]}] [text]\n"
 		" -iFile    Optional input filename\n"
 		" -t        Select text output (allophone labels) (default)\n"
 		" -b        Select binary output (range 40..7F)\n"
@@ -53,6 +63,29 @@ void help()
 		" -r        Rules debugging mode\n"
 		" -d        Debug mode\n"
 		" -n        Suppress 'O.K.'\n"
+		" -w        Word mode: any delimiter, flush output after each word\n"
+		" -pStraps  APORT straps in hex: 10=CR delimiter, 90=any delimiter (default 10)\n"
+		" -fPolicy  Output flush policy: A=allophone, W=word, S=sentence, B=bulk\n"
+		"           (default S, or B if the output is a file)\n"
+		" -lMs      Latency deadline in ms of the W and S policies (default 5, 0=none)\n"
+		" -j[Thr]   Batch mode: convert lines on Thr threads (default: all CPUs)\n"
+		" -oResults Benchmark: convert the input or the built-in corpus, write the results\n"
+		"           in JSON to Results (- = console), compare them with Baseline and fail\n"
+		"           on a regression beyond Pct % (default 10)\n"
+		" -u[Filt]  Micro-benchmarks of the kernels whose name contains Filt: simop, read;\n"
+		"           the results go to -o\n"
+		" -yGolden  Check the allophones of the reference cases against the golden\n"
+		"           outputs in the Golden directory; -y+Golden records them\n"
+		" -x[File]  Profile the firmware execution: write the instructions by routine, the\n"
+		"           call graph and the hot instructions to File (default: stderr)\n"
+		" -c[File]  Count the rules matches and the rules scanned before them, write them\n"
+		"           with the rules coverage to File in CSV, or JSON if File ends with .json\n"
+		"           (default: CSV to stderr)\n"
+		" -z+TrFile Record the I/O events of -v to a binary trace ring of Records (default\n"
+		"           65536), dumped to TrFile at the end\n"
+		" -zTrFile  Decode the binary trace TrFile to the text of -v\n"
+		" -hPort    Serve the metrics in Prometheus text format on the local TCP Port\n"
+		" -hFile,Ms Write the metrics to File every Ms (default 1000) and at the exit\n"
 		" --        Stop parsing options\n"
 		" text      Optional text to convert\n"
 		"If no -iFile and no text is given, reads input from stdin.\n"
@@ -60,22 +93,138 @@ void help()
 	);
 }
 
+// Benchmark corpus
+static const char benchmarkCorpus[] =
+	"The quick brown fox jumps over the lazy dog. Speech synthesis converts written text into spoken words.\r"
+	"On March 3rd, 1983, the temperature was 72 degrees at 10:45 AM; the wind blew from the north-west at 15 mph.\r"
+	"Please call 555-1234 and ask for extension 42. Is this the right way to the station? Yes, it is!\r"
+	"She sells sea shells by the sea shore, and the shells she sells are surely sea shells.\r"
+	"Numbers like 1, 22, 333, 4444 and 55555 are spelled out digit by digit, or as whole numbers.\r";
+
+// Convert the corpus on a detached system, keeping the best of the runs
+static int benchmark( Benchmark &bench, std::istream &istr, uchar aport )
+{
+	std::string text( ( std::istreambuf_iterator< char >( istr ) ), std::istreambuf_iterator< char >() );
+	if ( text.empty() )
+		text = benchmarkCorpus;
+
+	double best = 0;
+	size_t allophones = 0;
+	for ( unsigned run=0; run<bench.getRuns(); ++run )
+	{
+		std::istringstream in( text );
+		std::ostringstream out;
+
+		CTS256A_AL2 system( in, out );
+		system.setOption( 'M', 'B' );
+		system.setOption( 'N', true );
+		system.setOption( 'A', aport );
+		system.setOption( 'F', FLUSH_BULK );
+
+		const double start = Benchmark::now();
+		system.run();
+		const double elapsed = Benchmark::now() - start;
+
+		if ( !run || elapsed < best )
+			best = elapsed;
+		allophones = out.str().size();
+	}
+
+	bench.add( "cts_chars", double( text.size() ), BENCHMARK_EXACT );
+	bench.add( "cts_allophones", double( allophones ), BENCHMARK_EXACT );
+	bench.add( "cts_chars_per_s", best > 0 ? text.size() / best : 0 );
+	bench.add( "cts_allophones_per_s", best > 0 ? allophones / best : 0 );
+	bench.add( "peak_rss_mb", Benchmark::getPeakRss(), BENCHMARK_LOWER );
+
+	return bench.finish( stdout );
+}
+
+// Allophone codes of a text, converted by a detached system
+static void convert( const std::string &text, uchar aport, std::vector< int > &allophones )
+{
+	std::istringstream in( text );
+	std::ostringstream out;
+
+	CTS256A_AL2 system( in, out );
+	system.setOption( 'M', 'B' );
+	system.setOption( 'N', true );
+	system.setOption( 'A', aport );
+	system.setOption( 'F', FLUSH_BULK );
+	system.run();
+
+	const std::string bytes = out.str();
+	allophones.clear();
+	for ( size_t i=0; i<bytes.size(); ++i )
+		allophones.push_back( bytes[i] & 0x3F );
+}
+
+// Check the reference cases against the golden outputs
+static int golden( const char *dir, bool record )
+{
+	GoldenSuite suite( dir, record );
+	int err = suite.open();
+	if ( err )
+	{
+		char buf[80];
+		strerror_s( buf, err );
+		printf( "%s error: %s\n", dir, buf );
+		return 1;
+	}
+
+	std::vector< int > allophones;
+
+	// single system, CR delimiter
+	convert( benchmarkCorpus, APORT_DEFAULT, allophones );
+	suite.check( "cts_corpus", allophones, 1, SP0256_labels, SP0256_NLABELS, stdout );
+
+	// single system, any delimiter
+	convert( benchmarkCorpus, APORT_DEFAULT | APORT_ANY_DELIMITER, allophones );
+	suite.check( "cts_corpus_any", allophones, 1, SP0256_labels, SP0256_NLABELS, stdout );
+
+	// batch mode, on 2 threads
+	{
+		std::istringstream in( benchmarkCorpus );
+		std::ostringstream out;
+		CTS256A_AL2_Converter converter( 'B', true );
+		SentenceScheduler scheduler( converter, 2 );
+		scheduler.run( in, out );
+
+		const std::string bytes = out.str();
+		allophones.clear();
+		for ( size_t i=0; i<bytes.size(); ++i )
+			allophones.push_back( bytes[i] & 0x3F );
+		suite.check( "cts_corpus_batch", allophones, 1, SP0256_labels, SP0256_NLABELS, stdout );
+	}
+
+	return suite.finish( stdout );
+}
+
 int _tmain(int argc, _TCHAR* argv[])
 {
 	char mode = 'T';
 	bool echo = false, debug = false, debug_rules = false, verbose = false, noOK = false, opts = true;
+	uint threads = 0, aport = APORT_DEFAULT, deadline = OUTPUT_DEADLINE;
+	char flush = 0;
+	bool benchmarkMode = false;
+	bool microBenchmarks = false;
+	const char *goldenDir = 0;
+	bool goldenRecord = false;
+	const char *profileName = 0;
+	const char *rulesName = 0;
+	const char *traceName = 0;
+	bool traceRecord = false;
+	uint traceRecords = 0x10000;
+	const char *metricsOption = 0;
+	Benchmark bench( "cts256a-al2" );
 
-	std::istream *pistr = &std::cin;
+	std::istream *pistr = 0;
 	std::ostream *postr = &std::cout;
 
 	std::stringstream sstr;
 
-#if __cplusplus >= 201103L
-	std::unique_ptr< std::fstream > pfstr;
-#else
-	std::auto_ptr< std::fstream > pfstr;
-#endif
-	
+	MappedInput input;
+	std::istream istr( &input );
+
 	ConIOConsole console;
 	console.puts( NAME " - " VERSION "\n\n" );
 
@@ -92,13 +241,12 @@ int _tmain(int argc, _TCHAR* argv[])
 				++s;
 				if ( *s == ':' )
 					++s;
-				pfstr.reset( new std::fstream( s, std::fstream::in ) );
-				if ( !pfstr->is_open() )
+				if ( input.open( s ) )
 				{
 					console.printf( "Failed to open %s\n", s );
 					return 1;
 				}
-				pistr = pfstr.get();
+				pistr = &istr;
 				noOK = true;
 				break;
 			case 'B': // Bin file
@@ -124,6 +272,90 @@ int _tmain(int argc, _TCHAR* argv[])
 			case 'N': // No OK
 				noOK = 1;
 				break;
+			case 'W': // Word mode
+				aport |= APORT_ANY_DELIMITER;
+				flush = FLUSH_WORD;
+				break;
+			case 'F': // Flush policy
+				++s;
+				flush = char( toupper( *s ) );
+				if ( !flush || !strchr( "AWSB", flush ) )
+				{
+					console.printf( "Invalid flush policy: %s\n", s );
+					return 1;
+				}
+				break;
+			case 'L': // Latency deadline
+				++s;
+				deadline = atoi( s );
+				break;
+			case 'P': // APORT straps
+				++s;
+				if ( sscanf( s, "%x", &aport ) != 1 || !APORT_STRAPS_VALID( aport ) )
+				{
+					console.printf( "Invalid APORT straps: %s (allowed: 10 or 90)\n", s );
+					return 1;
+				}
+				break;
+			case 'J': // Batch mode
+				++s;
+				threads = atoi( s );
+				if ( !threads )
+				{
+					SYSTEM_INFO info;
+					GetSystemInfo( &info );
+					threads = info.dwNumberOfProcessors;
+				}
+				break;
+			case 'O': // Benchmark
+				++s;
+				if ( !bench.setOption( s ) )
+				{
+					console.printf( "Invalid benchmark option: %s\n", s );
+					return 1;
+				}
+				benchmarkMode = true;
+				break;
+			case 'U': // Micro-benchmarks
+				++s;
+				if ( !bench.setMicroOption( s ) )
+				{
+					console.printf( "Invalid micro-benchmark option: %s\n", s );
+					return 1;
+				}
+				microBenchmarks = true;
+				break;
+			case 'Y': // Golden outputs
+				++s;
+				goldenRecord = *s == '+';
+				if ( goldenRecord )
+					++s;
+				goldenDir = s;
+				break;
+			case 'X': // Execution profile
+				++s;
+				profileName = s;
+				break;
+			case 'C': // Rule counters
+				++s;
+				rulesName = s;
+				break;
+			case 'Z': // Binary trace
+				++s;
+				traceRecord = *s == '+';
+				if ( traceRecord )
+					++s;
+				if ( char *comma = strchr( s, ',' ) )
+				{
+					*comma = 0;
+					sscanf_s( comma + 1, "%u", &traceRecords );
+				}
+				traceName = s;
+				break;
+			case 'H': // Metrics endpoint
+				++s;
+				metricsOption = s;
+				break;
 			case '-': // End opts
 				opts = false;
 				break;
@@ -145,9 +377,70 @@ int _tmain(int argc, _TCHAR* argv[])
 		}
 	}
 
-	std::cin.sync_with_stdio();
+	if ( goldenDir )
+		return golden( goldenDir, goldenRecord );
+
+	if ( traceName && !traceRecord )
+	{
+		if ( TraceRing::decode( traceName, stdout ) )
+		{
+			console.printf( "Failed to decode %s\n", traceName );
+			return 1;
+		}
+		return 0;
+	}
+
+	// metrics registry, exposed until the exit
+	Metrics metrics;
+	MetricsServer metricsServer( metrics );
+	if ( metricsOption )
+	{
+		int err = metricsServer.start( metricsOption );
+		if ( err )
+		{
+			console.printf( "Metrics endpoint %s error: %d\n", metricsOption, err );
+			return 1;
+		}
+	}
+
+	if ( microBenchmarks )
+	{
+		MicroBenchmarks::run( bench, stdout );
+		return bench.finish( stdout );
+	}
+
+	if ( benchmarkMode )
+		return benchmark( bench, pistr ? *pistr : sstr, uchar( aport ) );
+
+	if ( !pistr )
+	{
+		// stdin: mapped if redirected from a file, else read by blocks
+		input.open( 0 );
+		pistr = &istr;
+	}
+
+	if ( threads && !debug && !profileName && !rulesName && !traceName )
+	{
+		CTS256A_AL2_Converter converter( mode, noOK, uchar( aport ) );
+		SentenceScheduler scheduler( converter, threads );
+		if ( metricsOption )
+		{
+			converter.setMetrics( &metrics );
+			scheduler.setMetrics( metrics );
+		}
+
+		scheduler.run( *pistr, *postr );
 
-	CTS256A_AL2 system( *pistr, *postr );
+		if ( mode == 'T' )
+			*postr << "\n";
+		postr->flush();
+
+		console.puts( "Conversion complete.\n\n" );
+
+		return 0;
+	}
+
+	CTS256A_AL2 system( *pistr, *postr, &console );
 
 	system.setOption( 'D', debug );
 	system.setOption( 'E', echo );
@@ -155,11 +448,83 @@ int _tmain(int argc, _TCHAR* argv[])
 	system.setOption( 'R', debug_rules );
 	system.setOption( 'N', noOK );
 	system.setOption( 'M', mode );
+	system.setOption( 'A', aport );
+	if ( !flush )
+	{
+		// interactive pipes get the sentences as soon as they are spoken,
+		// bulk files get the big blocks
+		flush = GetFileType( GetStdHandle( STD_OUTPUT_HANDLE ) ) == FILE_TYPE_DISK
+			? FLUSH_BULK : FLUSH_SENTENCE;
+	}
+
+	if ( echo || verbose || debug || debug_rules )
+	{
+		// keep the allophones in sync with the console output
+		flush = FLUSH_ALLOPHONE;
+	}
+
+	system.setOption( 'F', flush );
+	system.setOption( 'L', deadline );
+
+	if ( metricsOption )
+		system.setMetrics( metrics );
+
+	Profiler profiler;
+	if ( profileName )
+		system.setProfiler( &profiler );
+
+	RuleCounters ruleCounters;
+	if ( rulesName )
+		system.setRuleCounters( &ruleCounters );
+
+	TraceRing traceRing;
+	if ( traceName )
+	{
+		traceRing.init( traceRecords );
+		system.setTraceRing( &traceRing );
+	}
 
 	system.run();
 	
 	console.puts( "Conversion complete.\n\n" );
 
+	if ( profileName )
+	{
+		FILE *out = *profileName ? fopen( profileName, "w" ) : stderr;
+		if ( !out )
+		{
+			console.printf( "Failed to create %s\n", profileName );
+			return 1;
+		}
+		system.writeProfile( out );
+		if ( out != stderr )
+			fclose( out );
+	}
+
+	if ( traceName )
+	{
+		if ( verbose )
+			console.printf( "traceRecords=%u - lost=%u\n", traceRing.getRecords(), traceRing.getLost() );
+		if ( traceRing.dump( traceName ) )
+		{
+			console.printf( "Failed to create %s\n", traceName );
+			return 1;
+		}
+	}
+
+	if ( rulesName )
+	{
+		ruleCounters.summary( console );
+		const int err = ruleCounters.write( rulesName );
+		if ( err )
+		{
+			char buf[80];
+			strerror_s( buf, err );
+			console.printf( "%s error: %s\n", rulesName, buf );
+			return 1;
+		}
+	}
+
 	return 0;
 }
 
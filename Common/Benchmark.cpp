@@ -0,0 +1,254 @@
+/*
+    SP0256_CTS256A-AL2 - Benchmark Results.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Benchmark.h"
+
+#include <psapi.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#pragma comment( lib, "psapi.lib" )
+
+bool Benchmark::setOption( const char *arg )
+{
+	const char *comma = strchr( arg, ',' );
+	results_.assign( arg, comma ? comma - arg : strlen( arg ) );
+	if ( results_.empty() )
+		results_ = "-";
+	if ( comma )
+	{
+		arg = comma + 1;
+		comma = strchr( arg, ',' );
+		baseline_.assign( arg, comma ? comma - arg : strlen( arg ) );
+		if ( comma )
+		{
+			char *end;
+			threshold_ = strtod( comma + 1, &end );
+			if ( *end || threshold_ < 0 )
+				return false;
+		}
+	}
+	return true;
+}
+
+bool Benchmark::setMicroOption( const char *arg )
+{
+	const char *comma = strchr( arg, ',' );
+	filter_.assign( arg, comma ? comma - arg : strlen( arg ) );
+	if ( comma )
+	{
+		char *end;
+		iterations_ = strtoul( comma + 1, &end, 10 );
+		if ( *end == ',' )
+			repetitions_ = strtoul( end + 1, &end, 10 );
+		if ( *end || !repetitions_ )
+			return false;
+	}
+	return true;
+}
+
+void Benchmark::measure( const char *key, benchmarkKernel_t kernel, void *param, unsigned iterations, FILE *con )
+{
+	if ( !isSelected( key ) )
+		return;
+	if ( iterations_ )
+		iterations = iterations_;
+
+	if ( !header_ )
+	{
+		fprintf( con, "%-24s %10s %10s %10s %10s %7s\n", "kernel (ns/iteration)", "min", "median", "mean", "sd", "sd %" );
+		header_ = true;
+	}
+
+	for ( unsigned i=0; i<BENCHMARK_WARMUP; ++i )
+		kernel( param, iterations );
+
+	std::vector< double > times( repetitions_ );
+	double sum = 0;
+	for ( unsigned i=0; i<repetitions_; ++i )
+	{
+		const double start = now();
+		kernel( param, iterations );
+		times[i] = ( now() - start ) * 1e9 / iterations;
+		sum += times[i];
+	}
+
+	const double mean = sum / repetitions_;
+	double var = 0;
+	for ( unsigned i=0; i<repetitions_; ++i )
+		var += ( times[i] - mean ) * ( times[i] - mean );
+	const double sd = repetitions_ > 1 ? sqrt( var / ( repetitions_ - 1 ) ) : 0;
+
+	std::sort( times.begin(), times.end() );
+	const double median = repetitions_ & 1 ? times[repetitions_ / 2]
+		: ( times[repetitions_ / 2 - 1] + times[repetitions_ / 2] ) / 2;
+
+	fprintf( con, "%-24s %10.2f %10.2f %10.2f %10.2f %6.1f%%\n", key, times[0], median, mean, sd,
+		mean > 0 ? sd * 100 / mean : 0. );
+
+	add( ( std::string( key ) + "_ns" ).c_str(), median, BENCHMARK_LOWER );
+}
+
+void Benchmark::add( const char *key, double value, int kind )
+{
+	Metric metric;
+	metric.key = key;
+	metric.value = value;
+	metric.kind = kind;
+	metrics_.push_back( metric );
+}
+
+int Benchmark::write( FILE *file ) const
+{
+	fprintf( file, "{\n\t\"benchmark\": \"%s\",\n\t\"runs\": %u,\n\t\"metrics\": {\n", name_.c_str(), runs_ );
+	for ( size_t i=0; i<metrics_.size(); ++i )
+	{
+		const char *sep = i + 1 < metrics_.size() ? "," : "";
+		// exact counts as integers, not rounded to 6 digits
+		if ( metrics_[i].kind == BENCHMARK_EXACT )
+			fprintf( file, "\t\t\"%s\": %llu%s\n", metrics_[i].key.c_str(), (unsigned long long)( metrics_[i].value ), sep );
+		else
+			fprintf( file, "\t\t\"%s\": %.6g%s\n", metrics_[i].key.c_str(), metrics_[i].value, sep );
+	}
+	fputs( "\t}\n}\n", file );
+	return ferror( file ) ? EIO : 0;
+}
+
+bool Benchmark::find( const std::string &json, const std::string &key, double &value )
+{
+	const std::string quoted = "\"" + key + "\"";
+	const size_t pos = json.find( quoted );
+	if ( pos == std::string::npos )
+		return false;
+	const char *s = json.c_str() + pos + quoted.size();
+	while ( *s == ' ' || *s == '\t' )
+		++s;
+	if ( *s++ != ':' )
+		return false;
+	char *end;
+	value = strtod( s, &end );
+	return end != s;
+}
+
+int Benchmark::finish( FILE *con ) const
+{
+	int err = 0;
+	if ( results_.empty() )
+	{
+		// no results requested
+		return 0;
+	}
+	else if ( results_ == "-" )
+	{
+		write( con );
+	}
+	else
+	{
+		FILE *file;
+		err = fopen_s( &file, results_.c_str(), "w" );
+		if ( !err )
+		{
+			err = write( file );
+			if ( fclose( file ) && !err )
+				err = errno;
+		}
+		if ( err )
+		{
+			char buf[80];
+			strerror_s( buf, err );
+			fprintf( con, "%s error: %s\n", results_.c_str(), buf );
+			return 1;
+		}
+	}
+
+	if ( baseline_.empty() )
+		return 0;
+
+	// read the baseline
+	std::string json;
+	FILE *file;
+	err = fopen_s( &file, baseline_.c_str(), "r" );
+	if ( !err )
+	{
+		char buf[0x400];
+		size_t n;
+		while ( ( n = fread( buf, 1, sizeof( buf ), file ) ) > 0 )
+			json.append( buf, n );
+		fclose( file );
+	}
+	if ( err )
+	{
+		char buf[80];
+		strerror_s( buf, err );
+		fprintf( con, "%s error: %s\n", baseline_.c_str(), buf );
+		return 1;
+	}
+
+	// compare: the regressions are the changes beyond the threshold in the wrong
+	// direction, and any change of the workload
+	unsigned regressions = 0;
+	for ( size_t i=0; i<metrics_.size(); ++i )
+	{
+		const Metric &metric = metrics_[i];
+		double base;
+		if ( !find( json, metric.key, base ) || base == 0 )
+			continue;
+		const double change = ( metric.value - base ) * 100. / base;
+		const bool regression = metric.kind == BENCHMARK_HIGHER ? change < -threshold_
+			: metric.kind == BENCHMARK_LOWER ? change > threshold_
+			: metric.value != base;
+		fprintf( con, "%-20s %12.6g %12.6g %+8.2f%%%s\n", metric.key.c_str(), base, metric.value, change,
+			regression ? "  REGRESSION" : "" );
+		if ( regression )
+			++regressions;
+	}
+	fprintf( con, "%u regression(s) beyond %.1f%% against %s\n", regressions, threshold_, baseline_.c_str() );
+
+	return regressions ? 2 : 0;
+}
+
+double Benchmark::now()
+{
+	static LARGE_INTEGER freq;
+	if ( !freq.QuadPart )
+		QueryPerformanceFrequency( &freq );
+	LARGE_INTEGER count;
+	QueryPerformanceCounter( &count );
+	return double( count.QuadPart ) / double( freq.QuadPart );
+}
+
+double Benchmark::getPeakRss()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+	memset( &counters, 0, sizeof( counters ) );
+	counters.cb = sizeof( counters );
+	if ( !GetProcessMemoryInfo( GetCurrentProcess(), &counters, sizeof( counters ) ) )
+		return 0;
+	return counters.PeakWorkingSetSize / 1048576.;
+}
@@ -0,0 +1,131 @@
+/*
+    SP0256_CTS256A-AL2 - Benchmark Results.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <windows.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+// Default regression threshold, in %
+#define BENCHMARK_THRESHOLD 10
+
+// Default number of runs; the best one is kept
+#define BENCHMARK_RUNS 5
+
+// Micro-benchmarks: default repetitions, and warm-up repetitions
+#define BENCHMARK_REPETITIONS	20
+#define BENCHMARK_WARMUP		2
+
+// Metric kinds
+#define BENCHMARK_HIGHER	0	// throughput: the higher the better
+#define BENCHMARK_LOWER		1	// time or size: the lower the better
+#define BENCHMARK_EXACT		2	// count of the workload: must not change
+
+// Benchmark results: named metrics, written as JSON and compared with the
+// results of a previous run kept as baseline. Option syntax:
+//   Results[,Baseline[,Threshold]]
+// where Results is a JSON file or - for the console.
+// The micro-benchmarks time a kernel over repetitions of a batch of
+// iterations, after warm-up, and add the median time per iteration.
+// Option syntax:
+//   [Filter][,Iterations[,Repetitions]]
+// where Filter selects the kernels whose name contains it.
+
+// Micro-benchmark kernel: runs a batch of iterations
+typedef void (*benchmarkKernel_t)( void *param, unsigned iterations );
+
+class Benchmark
+{
+public:
+	Benchmark( const char *name )
+		: name_( name ), threshold_( BENCHMARK_THRESHOLD ), runs_( BENCHMARK_RUNS )
+		, iterations_( 0 ), repetitions_( BENCHMARK_REPETITIONS ), header_( false )
+	{
+	}
+
+	// parse the option argument; returns false if invalid
+	bool setOption( const char *arg );
+
+	// parse the micro-benchmark option argument; returns false if invalid
+	bool setMicroOption( const char *arg );
+
+	// kernel selected by the filter ?
+	bool isSelected( const char *key ) const
+	{
+		return filter_.empty() || strstr( key, filter_.c_str() ) != 0;
+	}
+
+	// time a kernel, by batches of iterations unless set by the option,
+	// and report the time per iteration to con
+	void measure( const char *key, benchmarkKernel_t kernel, void *param, unsigned iterations, FILE *con );
+
+	unsigned getRuns() const
+	{
+		return runs_;
+	}
+
+	// add a metric of a BENCHMARK_xxx kind
+	void add( const char *key, double value, int kind = BENCHMARK_HIGHER );
+
+	// write the results and compare them with the baseline; returns the exit code:
+	// 0 = ok, 1 = error, 2 = regression
+	int finish( FILE *con ) const;
+
+	// high-resolution time, in seconds
+	static double now();
+
+	// peak resident set size of the process, in MB
+	static double getPeakRss();
+
+private:
+	struct Metric
+	{
+		std::string		key;
+		double			value;
+		int				kind;
+	};
+
+	// write the results as JSON; returns 0 or errno
+	int write( FILE *file ) const;
+
+	// look up a metric in a results file; returns false if not found
+	static bool find( const std::string &json, const std::string &key, double &value );
+
+	std::string				name_;
+	std::string				results_;
+	std::string				baseline_;
+	double					threshold_;
+	unsigned				runs_;
+	std::string				filter_;
+	unsigned				iterations_;
+	unsigned				repetitions_;
+	bool					header_;
+	std::vector< Metric >	metrics_;
+};
@@ -0,0 +1,212 @@
+/*
+    SP0256_CTS256A-AL2 - Golden Output Suite.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "GoldenSuite.h"
+
+#include <windows.h>
+#include <errno.h>
+#include <string.h>
+
+int GoldenSuite::open()
+{
+	// the directory may already exist
+	if ( record_ )
+		CreateDirectoryA( dir_.c_str(), NULL );
+
+	// the index may be shared: the recorded cases replace their entries
+	FILE *file;
+	int err = fopen_s( &file, getPath( GOLDEN_INDEX ).c_str(), "r" );
+	if ( err )
+		return record_ && err == ENOENT ? 0 : err;
+
+	char line[256];
+	while ( fgets( line, sizeof( line ), file ) )
+	{
+		Entry entry;
+		const char *space = strchr( line, ' ' );
+		if ( space && sscanf_s( space, "%lu %llx", &entry.count, &entry.hash ) == 2 )
+		{
+			entry.name.assign( line, space - line );
+			entries_.push_back( entry );
+		}
+	}
+	fclose( file );
+	return 0;
+}
+
+unsigned long long GoldenSuite::hash( const std::vector< int > &stream, unsigned size )
+{
+	unsigned long long h = 0xCBF29CE484222325ULL;
+	for ( size_t i=0; i<stream.size(); ++i )
+	{
+		for ( unsigned b=0; b<size; ++b )
+		{
+			h ^= ( stream[i] >> ( 8 * b ) ) & 0xFF;
+			h *= 0x100000001B3ULL;
+		}
+	}
+	return h;
+}
+
+void GoldenSuite::check( const char *name, const std::vector< int > &stream, unsigned size,
+	const char * const *labels, unsigned nlabels, FILE *con )
+{
+	Entry entry;
+	entry.name = name;
+	entry.count = (unsigned long)( stream.size() );
+	entry.hash = hash( stream, size );
+
+	if ( record_ )
+	{
+		FILE *file;
+		int err = fopen_s( &file, getPath( entry.name + ".gold" ).c_str(), "wb" );
+		if ( !err )
+		{
+			for ( size_t i=0; i<stream.size(); ++i )
+				for ( unsigned b=0; b<size; ++b )
+					fputc( ( stream[i] >> ( 8 * b ) ) & 0xFF, file );
+			if ( fclose( file ) )
+				err = errno;
+		}
+		if ( err )
+		{
+			errno_ = err;
+			++failed_;
+			fprintf( con, "ERROR %s: can't write the golden stream\n", name );
+			return;
+		}
+		size_t i = 0;
+		while ( i < entries_.size() && entries_[i].name != entry.name )
+			++i;
+		if ( i < entries_.size() )
+			entries_[i] = entry;
+		else
+			entries_.push_back( entry );
+		++passed_;
+		fprintf( con, "RECORD %-20s %8lu %016llX\n", name, entry.count, entry.hash );
+		return;
+	}
+
+	for ( size_t i=0; i<entries_.size(); ++i )
+	{
+		if ( entries_[i].name == entry.name )
+		{
+			if ( entries_[i].count == entry.count && entries_[i].hash == entry.hash )
+			{
+				++passed_;
+				fprintf( con, "PASS   %-20s %8lu %016llX\n", name, entry.count, entry.hash );
+			}
+			else
+			{
+				++failed_;
+				fprintf( con, "FAIL   %-20s %8lu %016llX (golden: %lu %016llX)\n", name, entry.count, entry.hash,
+					entries_[i].count, entries_[i].hash );
+				report( name, stream, size, labels, nlabels, con );
+			}
+			return;
+		}
+	}
+
+	++failed_;
+	fprintf( con, "FAIL   %-20s no golden output\n", name );
+}
+
+void GoldenSuite::report( const char *name, const std::vector< int > &stream, unsigned size,
+	const char * const *labels, unsigned nlabels, FILE *con ) const
+{
+	// load the golden stream
+	std::vector< int > golden;
+	FILE *file;
+	if ( fopen_s( &file, getPath( std::string( name ) + ".gold" ).c_str(), "rb" ) )
+	{
+		fprintf( con, "       can't read the golden stream\n" );
+		return;
+	}
+	for ( ;; )
+	{
+		int value = 0, c = 0;
+		for ( unsigned b=0; b<size && ( c = fgetc( file ) ) != EOF; ++b )
+			value |= c << ( 8 * b );
+		if ( c == EOF )
+			break;
+		if ( size == 2 )
+			value = short( value );
+		golden.push_back( value );
+	}
+	fclose( file );
+
+	// first difference
+	size_t first = 0;
+	while ( first < stream.size() && first < golden.size() && stream[first] == golden[first] )
+		++first;
+	fprintf( con, "       first difference at element %lu (golden: %lu elements)\n",
+		(unsigned long)( first ), (unsigned long)( golden.size() ) );
+
+	const size_t from = first > GOLDEN_CONTEXT ? first - GOLDEN_CONTEXT : 0;
+	fprintf( con, "         %8s  %-10s  %-10s\n", "element", "golden", "output" );
+	for ( size_t i=from; i<=first+GOLDEN_CONTEXT; ++i )
+	{
+		if ( i >= stream.size() && i >= golden.size() )
+			break;
+		fprintf( con, "       %c %8lu", i == first ? '>' : ' ', (unsigned long)( i ) );
+		for ( int k=0; k<2; ++k )
+		{
+			const std::vector< int > &s = k ? stream : golden;
+			if ( i >= s.size() )
+				fprintf( con, "  %-10s", "-" );
+			else if ( labels && unsigned( s[i] ) < nlabels )
+				fprintf( con, "  %-10s", labels[s[i]] );
+			else
+				fprintf( con, "  %-10d", s[i] );
+		}
+		fputs( "\n", con );
+	}
+}
+
+int GoldenSuite::finish( FILE *con )
+{
+	if ( record_ && !errno_ )
+	{
+		FILE *file;
+		errno_ = fopen_s( &file, getPath( GOLDEN_INDEX ).c_str(), "w" );
+		if ( !errno_ )
+		{
+			for ( size_t i=0; i<entries_.size(); ++i )
+				fprintf( file, "%s %lu %016llX\n", entries_[i].name.c_str(), entries_[i].count, entries_[i].hash );
+			if ( fclose( file ) )
+				errno_ = errno;
+		}
+	}
+
+	if ( errno_ )
+	{
+		char buf[80];
+		strerror_s( buf, errno_ );
+		fprintf( con, "%s error: %s\n", dir_.c_str(), buf );
+	}
+
+	fprintf( con, "%u case(s) %s, %u failed\n", passed_, record_ ? "recorded" : "passed", failed_ );
+	return errno_ || failed_ ? 1 : 0;
+}
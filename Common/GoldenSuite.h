@@ -0,0 +1,92 @@
+/*
+    SP0256_CTS256A-AL2 - Golden Output Suite.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+// Name of the index of the golden directory
+#define GOLDEN_INDEX	"golden.txt"
+
+// Elements displayed around the first difference
+#define GOLDEN_CONTEXT	4
+
+// Golden output suite: the output streams of reference cases are hashed and
+// compared with the golden hashes; on a divergence, the golden stream is
+// loaded to show the first differing element with its context. The golden
+// directory holds the index ("Name Count Hash" lines) and a Name.gold file
+// per case with the stream (elements of 1 or 2 bytes, little-endian).
+
+class GoldenSuite
+{
+public:
+	// dir: golden directory; record: write the golden outputs instead of checking them
+	GoldenSuite( const char *dir, bool record )
+		: dir_( dir ), record_( record ), passed_( 0 ), failed_( 0 ), errno_( 0 )
+	{
+	}
+
+	// load the index; returns 0 or errno
+	int open();
+
+	// check or record a case, reported to con; size: bytes per element;
+	// labels: element names, if any
+	void check( const char *name, const std::vector< int > &stream, unsigned size,
+		const char * const *labels, unsigned nlabels, FILE *con );
+
+	// write the index (record mode) and the summary; returns the exit code:
+	// 0 = ok, 1 = error or divergence
+	int finish( FILE *con );
+
+	// FNV-1a 64-bit hash of the stream elements
+	static unsigned long long hash( const std::vector< int > &stream, unsigned size );
+
+private:
+	struct Entry
+	{
+		std::string			name;
+		unsigned long		count;
+		unsigned long long	hash;
+	};
+
+	std::string getPath( const std::string &file ) const
+	{
+		return dir_ + "/" + file;
+	}
+
+	// show the first difference with the golden stream
+	void report( const char *name, const std::vector< int > &stream, unsigned size,
+		const char * const *labels, unsigned nlabels, FILE *con ) const;
+
+	std::string				dir_;
+	bool					record_;
+	std::vector< Entry >	entries_;
+	unsigned				passed_;
+	unsigned				failed_;
+	int						errno_;
+};
@@ -0,0 +1,170 @@
+/*
+    SP0256_CTS256A-AL2 - Memory Mapped Input.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MappedInput.h"
+
+#include <io.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+int MappedInput::open( const char *fileName )
+{
+	close();
+
+	if ( !fileName || !strcmp( fileName, "-" ) )
+	{
+		fd_ = _fileno( stdin );
+		// binary as the mapped files: keep CR LF and 0x1A
+		_setmode( fd_, _O_BINARY );
+		close_ = false;
+	}
+	else
+	{
+		fd_ = _open( fileName, _O_RDONLY | _O_BINARY | _O_SEQUENTIAL );
+		if ( fd_ < 0 )
+			return errno;
+		close_ = true;
+	}
+
+	if ( !map() )
+	{
+		buffer_ = new char[MAPPED_INPUT_BUFFER_SIZE];
+		setg( buffer_, buffer_, buffer_ );
+	}
+
+	return 0;
+}
+
+// map the file from the current position to the end
+bool MappedInput::map()
+{
+	HANDLE file = HANDLE( _get_osfhandle( fd_ ) );
+
+	if ( file == INVALID_HANDLE_VALUE || GetFileType( file ) != FILE_TYPE_DISK )
+		return false;
+
+	LARGE_INTEGER size, pos, zero;
+	zero.QuadPart = 0;
+
+	if ( !GetFileSizeEx( file, &size ) || !SetFilePointerEx( file, zero, &pos, FILE_CURRENT ) )
+		return false;
+
+	// too big for the address space
+	if ( ULONGLONG( size.QuadPart ) > ULONGLONG( size_t( -1 ) ) )
+		return false;
+
+	// empty: nothing to map
+	if ( pos.QuadPart >= size.QuadPart )
+		return false;
+
+	mapping_ = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( !mapping_ )
+		return false;
+
+	view_ = static_cast< char* >( MapViewOfFile( mapping_, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( !view_ )
+	{
+		CloseHandle( mapping_ );
+		mapping_ = NULL;
+		return false;
+	}
+
+	setg( view_, view_ + size_t( pos.QuadPart ), view_ + size_t( size.QuadPart ) );
+
+	// leave the file position at the end, as if read
+	SetFilePointerEx( file, size, NULL, FILE_BEGIN );
+
+	return true;
+}
+
+void MappedInput::close()
+{
+	if ( view_ )
+		UnmapViewOfFile( view_ );
+	if ( mapping_ )
+		CloseHandle( mapping_ );
+	if ( close_ )
+		_close( fd_ );
+
+	delete[] buffer_;
+
+	fd_ = -1;
+	close_ = false;
+	mapping_ = NULL;
+	view_ = 0;
+	buffer_ = 0;
+	cr_ = false;
+
+	setg( 0, 0, 0 );
+}
+
+MappedInput::int_type MappedInput::underflow()
+{
+	if ( gptr() < egptr() )
+		return traits_type::to_int_type( *gptr() );
+
+	// the mapped view holds the whole file
+	if ( !buffer_ )
+		return traits_type::eof();
+
+	int n = 0, r;
+
+	if ( cr_ )
+	{
+		buffer_[n++] = '\r';
+		cr_ = false;
+	}
+
+	// a lone CR waits for the next read, which may bring its LF
+	do
+	{
+		r = _read( fd_, buffer_ + n, MAPPED_INPUT_BUFFER_SIZE - n );
+		if ( r > 0 )
+			n += r;
+	}
+	while ( r > 0 && n == 1 && buffer_[0] == '\r' );
+
+	if ( !n )
+		return traits_type::eof();
+
+	// hold back a final CR for the next refill
+	if ( n > 1 && buffer_[n - 1] == '\r' )
+	{
+		cr_ = true;
+		--n;
+	}
+
+	setg( buffer_, buffer_, buffer_ + n );
+
+	return traits_type::to_int_type( *gptr() );
+}
+
+std::streamsize MappedInput::showmanyc()
+{
+	// -1: the end is reached, 0: unknown (a read might block)
+	return buffer_ ? 0 : -1;
+}
@@ -0,0 +1,79 @@
+/*
+    SP0256_CTS256A-AL2 - Memory Mapped Input.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <windows.h>
+
+#include <streambuf>
+
+// Size of the read buffer, when the input can't be mapped
+#define MAPPED_INPUT_BUFFER_SIZE 0x10000
+
+// Input stream buffer over a file mapped in memory. The get area is the
+// mapped view itself, so the bytes are consumed through the inline cursor
+// of the stream buffer, without copy. Pipes, consoles and files too big
+// for the address space fall back to large buffered reads; a CR ending a
+// read is held back to the next one, so that a CR LF pair is never split
+// by a refill.
+
+class MappedInput : public std::streambuf
+{
+public:
+	MappedInput()
+		: fd_( -1 ), close_( false ), mapping_( NULL ), view_( 0 ), buffer_( 0 ), cr_( false )
+	{
+	}
+
+	~MappedInput()
+	{
+		close();
+	}
+
+	// open a file, or stdin if fileName is 0 or "-"; returns 0 or errno
+	int open( const char *fileName );
+
+	void close();
+
+	bool isMapped() const
+	{
+		return view_ != 0;
+	}
+
+protected:
+	int_type underflow();
+
+	std::streamsize showmanyc();
+
+private:
+	bool map();
+
+	int					fd_;
+	bool				close_;
+	HANDLE				mapping_;
+	char				*view_;
+	char				*buffer_;
+	bool				cr_;			// CR held back from the last read
+};
@@ -0,0 +1,271 @@
+/*
+    SP0256_CTS256A-AL2 - Metrics Registry.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma warning(disable:4996)	// warning C4996: '%0': This function or variable may be unsafe.
+
+#include "Metrics.h"
+
+#include <errno.h>
+#include <stdio.h>
+
+// thread slots: numbered from 1 in the order of the first update
+static const DWORD s_tls = TlsAlloc();
+static volatile LONG s_threads = 0;
+
+const double Metrics::latencyBounds[] =
+{
+	0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025,
+	0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10
+};
+
+const unsigned Metrics::nLatencyBounds = sizeof( latencyBounds ) / sizeof( *latencyBounds );
+
+unsigned Metrics::getSlot()
+{
+	unsigned slot = unsigned( size_t( TlsGetValue( s_tls ) ) );
+	if ( !slot )
+	{
+		slot = unsigned( InterlockedIncrement( &s_threads ) );
+		TlsSetValue( s_tls, LPVOID( size_t( slot ) ) );
+	}
+	return slot < METRICS_SLOTS ? slot - 1 : METRICS_SLOTS - 1;
+}
+
+void *Metrics::allocSlots( size_t size, char *&buffer )
+{
+	// new only aligns on the fundamental types: the slots would share
+	// their first and last lines with the neighbouring memory
+	buffer = new char[size + METRICS_LINE - 1];
+	char *slots = buffer + ( METRICS_LINE - size_t( buffer ) % METRICS_LINE ) % METRICS_LINE;
+	memset( slots, 0, size );
+	return slots;
+}
+
+Metrics::Counter::Counter()
+{
+	slots_ = static_cast< slot_t* >( Metrics::allocSlots( METRICS_SLOTS * sizeof( slot_t ), buffer_ ) );
+}
+
+Metrics::Counter::~Counter()
+{
+	delete[] buffer_;
+}
+
+unsigned long long Metrics::Counter::get() const
+{
+	unsigned long long value = 0;
+	for ( unsigned i = 0; i < METRICS_SLOTS; ++i )
+		value += Metrics::load( &slots_[i].value );
+	return value;
+}
+
+Metrics::Histogram::Histogram( const double *bounds, unsigned nBounds )
+	: nBounds_( nBounds < METRICS_BUCKETS ? nBounds : METRICS_BUCKETS )
+{
+	memcpy( bounds_, bounds, nBounds_ * sizeof( double ) );
+	slots_ = static_cast< slot_t* >( Metrics::allocSlots( METRICS_SLOTS * sizeof( slot_t ), buffer_ ) );
+}
+
+Metrics::Histogram::~Histogram()
+{
+	delete[] buffer_;
+}
+
+void Metrics::Histogram::observe( double value )
+{
+	unsigned bucket = 0;
+	while ( bucket < nBounds_ && value > bounds_[bucket] )
+		++bucket;
+
+	slot_t &s = slots_[Metrics::getSlot()];
+	InterlockedIncrement64( &s.counts[bucket] );
+
+	// the last slot may be shared: add to the sum until no other thread
+	// did in between
+	LONGLONG bits, sum;
+	do
+	{
+		bits = Metrics::load( &s.sum );
+		double d;
+		memcpy( &d, &bits, sizeof( d ) );
+		d += value;
+		memcpy( &sum, &d, sizeof( sum ) );
+	}
+	while ( InterlockedCompareExchange64( &s.sum, sum, bits ) != bits );
+}
+
+Metrics::Metrics()
+{
+	InitializeCriticalSection( &lock_ );
+}
+
+Metrics::~Metrics()
+{
+	for ( size_t i = 0; i < metrics_.size(); ++i )
+	{
+		switch ( metrics_[i].type )
+		{
+		case COUNTER:
+			delete static_cast< Counter* >( metrics_[i].metric );
+			break;
+		case GAUGE:
+			delete static_cast< Gauge* >( metrics_[i].metric );
+			break;
+		case HISTOGRAM:
+			delete static_cast< Histogram* >( metrics_[i].metric );
+			break;
+		}
+	}
+	DeleteCriticalSection( &lock_ );
+}
+
+Metrics::metric_t *Metrics::find( const char *name )
+{
+	for ( size_t i = 0; i < metrics_.size(); ++i )
+	{
+		if ( metrics_[i].name == name )
+			return &metrics_[i];
+	}
+	return 0;
+}
+
+Metrics::Counter &Metrics::counter( const char *name, const char *help )
+{
+	EnterCriticalSection( &lock_ );
+	metric_t *metric = find( name );
+	if ( !metric )
+	{
+		metric_t m = { name, help, COUNTER, new Counter };
+		metrics_.push_back( m );
+		metric = &metrics_.back();
+	}
+	LeaveCriticalSection( &lock_ );
+	return *static_cast< Counter* >( metric->metric );
+}
+
+Metrics::Gauge &Metrics::gauge( const char *name, const char *help )
+{
+	EnterCriticalSection( &lock_ );
+	metric_t *metric = find( name );
+	if ( !metric )
+	{
+		metric_t m = { name, help, GAUGE, new Gauge };
+		metrics_.push_back( m );
+		metric = &metrics_.back();
+	}
+	LeaveCriticalSection( &lock_ );
+	return *static_cast< Gauge* >( metric->metric );
+}
+
+Metrics::Histogram &Metrics::histogram( const char *name, const char *help, const double *bounds, unsigned nBounds )
+{
+	EnterCriticalSection( &lock_ );
+	metric_t *metric = find( name );
+	if ( !metric )
+	{
+		metric_t m = { name, help, HISTOGRAM, new Histogram( bounds, nBounds ) };
+		metrics_.push_back( m );
+		metric = &metrics_.back();
+	}
+	LeaveCriticalSection( &lock_ );
+	return *static_cast< Histogram* >( metric->metric );
+}
+
+void Metrics::write( std::string &text )
+{
+	static const char *types[] = { "counter", "gauge", "histogram" };
+	char buf[200];
+
+	text.clear();
+
+	EnterCriticalSection( &lock_ );
+	for ( size_t i = 0; i < metrics_.size(); ++i )
+	{
+		const metric_t &metric = metrics_[i];
+		const char *name = metric.name.c_str();
+
+		text += "# HELP " + metric.name + " " + metric.help + "\n";
+		text += "# TYPE " + metric.name + " " + types[metric.type] + "\n";
+
+		switch ( metric.type )
+		{
+		case COUNTER:
+			sprintf( buf, "%s %llu\n", name, static_cast< Counter* >( metric.metric )->get() );
+			text += buf;
+			break;
+		case GAUGE:
+			sprintf( buf, "%s %.9g\n", name, static_cast< Gauge* >( metric.metric )->get() );
+			text += buf;
+			break;
+		case HISTOGRAM:
+			{
+				const Histogram &histogram = *static_cast< Histogram* >( metric.metric );
+				unsigned long long count = 0;
+				double sum = 0;
+				for ( unsigned bucket = 0; bucket <= histogram.nBounds_; ++bucket )
+				{
+					for ( unsigned slot = 0; slot < METRICS_SLOTS; ++slot )
+						count += load( &histogram.slots_[slot].counts[bucket] );
+					if ( bucket < histogram.nBounds_ )
+						sprintf( buf, "%s_bucket{le=\"%g\"} %llu\n", name, histogram.bounds_[bucket], count );
+					else
+						sprintf( buf, "%s_bucket{le=\"+Inf\"} %llu\n", name, count );
+					text += buf;
+				}
+				for ( unsigned slot = 0; slot < METRICS_SLOTS; ++slot )
+				{
+					const LONGLONG bits = load( &histogram.slots_[slot].sum );
+					double d;
+					memcpy( &d, &bits, sizeof( d ) );
+					sum += d;
+				}
+				sprintf( buf, "%s_sum %.9g\n%s_count %llu\n", name, sum, name, count );
+				text += buf;
+			}
+			break;
+		}
+	}
+	LeaveCriticalSection( &lock_ );
+}
+
+int Metrics::writeFile( const char *name )
+{
+	std::string text;
+	write( text );
+
+	// write aside, then replace: the readers never see a partial file
+	const std::string temp = std::string( name ) + ".tmp";
+	FILE *file = fopen( temp.c_str(), "w" );
+	if ( !file )
+		return errno;
+	int err = fwrite( text.data(), 1, text.size(), file ) == text.size() ? 0 : EIO;
+	if ( fclose( file ) && !err )
+		err = EIO;
+	// replaced at once, the file never goes missing
+	if ( !err && !MoveFileExA( temp.c_str(), name, MOVEFILE_REPLACE_EXISTING ) )
+		err = EIO;
+	return err;
+}
@@ -0,0 +1,189 @@
+/*
+    SP0256_CTS256A-AL2 - Metrics Registry.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <windows.h>
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+// Number of per-thread slots of a metric: the threads beyond share the last
+// slot
+#define METRICS_SLOTS		64
+
+// Maximum number of buckets of a histogram, +Inf excluded
+#define METRICS_BUCKETS		16
+
+// Size of a cache line
+#define METRICS_LINE		64
+
+// Metrics registry: counters, gauges and histograms, exposed in the
+// Prometheus text format. The counters and histograms have a slot per
+// thread, on its own cache line: the 64-bit interlocked updates are not
+// contended and never torn, even on x86, and the exposition sums the slots.
+// The metrics are created or looked up by name, and live as long as the
+// registry.
+class Metrics
+{
+public:
+	// monotonic counter
+	class Counter
+	{
+	public:
+		void add( unsigned long long value = 1 )
+		{
+			InterlockedExchangeAdd64( &slots_[Metrics::getSlot()].value, LONGLONG( value ) );
+		}
+
+		unsigned long long get() const;
+
+	private:
+		friend class Metrics;
+
+		Counter();
+
+		~Counter();
+
+		// a slot per cache line
+		struct slot_t
+		{
+			volatile LONGLONG	value;
+			char				pad[METRICS_LINE - sizeof( LONGLONG )];
+		};
+
+		slot_t				*slots_;		// aligned in buffer_
+		char				*buffer_;
+	};
+
+	// value set by a single thread
+	class Gauge
+	{
+	public:
+		void set( double value )
+		{
+			value_ = value;
+		}
+
+		double get() const
+		{
+			return value_;
+		}
+
+	private:
+		friend class Metrics;
+
+		Gauge()
+			: value_( 0 )
+		{
+		}
+
+		volatile double		value_;
+	};
+
+	// distribution of observations in buckets of upper bounds
+	class Histogram
+	{
+	public:
+		void observe( double value );
+
+	private:
+		friend class Metrics;
+
+		Histogram( const double *bounds, unsigned nBounds );
+
+		~Histogram();
+
+		// padded to whole cache lines
+		struct slot_t
+		{
+			volatile LONGLONG	counts[METRICS_BUCKETS + 1];	// by bucket, +Inf last
+			volatile LONGLONG	sum;							// bits of a double
+			char				pad[METRICS_LINE - ( METRICS_BUCKETS + 2 ) * sizeof( LONGLONG ) % METRICS_LINE];
+		};
+
+		double				bounds_[METRICS_BUCKETS];
+		unsigned			nBounds_;
+		slot_t				*slots_;		// aligned in buffer_
+		char				*buffer_;
+	};
+
+	Metrics();
+
+	~Metrics();
+
+	// metric of a name, created on the first call
+	Counter &counter( const char *name, const char *help );
+
+	Gauge &gauge( const char *name, const char *help );
+
+	// bounds: nBounds increasing upper bounds, without +Inf
+	Histogram &histogram( const char *name, const char *help, const double *bounds, unsigned nBounds );
+
+	// Prometheus text format of all the metrics
+	void write( std::string &text );
+
+	// write a snapshot to a file, replaced when complete; returns 0 or errno
+	int writeFile( const char *name );
+
+	// default bounds of the latency histograms, in seconds
+	static const double latencyBounds[];
+	static const unsigned nLatencyBounds;
+
+private:
+	enum type_t
+	{
+		COUNTER, GAUGE, HISTOGRAM
+	};
+
+	struct metric_t
+	{
+		std::string		name;
+		std::string		help;
+		type_t			type;
+		void			*metric;
+	};
+
+	// slot of the calling thread, the last one shared
+	static unsigned getSlot();
+
+	// zeroed slots of size bytes, aligned on a cache line in buffer, to be
+	// deleted
+	static void *allocSlots( size_t size, char *&buffer );
+
+	// atomic 64-bit read
+	static LONGLONG load( volatile LONGLONG *value )
+	{
+		return InterlockedCompareExchange64( value, 0, 0 );
+	}
+
+	metric_t *find( const char *name );
+
+	std::vector< metric_t >	metrics_;
+	CRITICAL_SECTION		lock_;
+};
@@ -0,0 +1,200 @@
+/*
+    SP0256_CTS256A-AL2 - Metrics Endpoint.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma warning(disable:4996)	// warning C4996: '%0': This function or variable may be unsafe.
+
+// before windows.h
+#include <winsock2.h>
+
+#include "MetricsServer.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#pragma comment( lib, "ws2_32.lib" )
+
+MetricsServer::MetricsServer( Metrics &metrics )
+	: metrics_( metrics ), port_( 0 ), period_( METRICS_PERIOD ), listener_( size_t( INVALID_SOCKET ) )
+	, thread_( 0 ), stop_( 0 )
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+	stop();
+}
+
+int MetricsServer::start( const char *option )
+{
+	char *end = 0;
+	const unsigned long port = strtoul( option, &end, 10 );
+
+	if ( *option && !*end )
+	{
+		if ( !port || port > 0xFFFF )
+			return EINVAL;
+
+		WSADATA wsaData;
+		int err = WSAStartup( MAKEWORD( 2, 2 ), &wsaData );
+		if ( err )
+			return err;
+
+		// local connections only
+		SOCKET listener = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+		if ( listener == INVALID_SOCKET )
+		{
+			err = WSAGetLastError();
+			WSACleanup();
+			return err;
+		}
+
+		sockaddr_in addr;
+		memset( &addr, 0, sizeof( addr ) );
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+		addr.sin_port = htons( u_short( port ) );
+		if ( bind( listener, (sockaddr*)&addr, sizeof( addr ) ) == SOCKET_ERROR
+			|| listen( listener, SOMAXCONN ) == SOCKET_ERROR )
+		{
+			err = WSAGetLastError();
+			closesocket( listener );
+			WSACleanup();
+			return err;
+		}
+
+		port_ = unsigned( port );
+		listener_ = size_t( listener );
+	}
+	else
+	{
+		const char *comma = strchr( option, ',' );
+		file_.assign( option, comma ? comma - option : strlen( option ) );
+		if ( comma )
+			period_ = DWORD( atol( comma + 1 ) );
+		if ( file_.empty() || !period_ )
+			return EINVAL;
+
+		// check the file now, rather than at the first snapshot
+		const int err = metrics_.writeFile( file_.c_str() );
+		if ( err )
+			return err;
+	}
+
+	stop_ = CreateEvent( NULL, TRUE, FALSE, NULL );
+	thread_ = CreateThread( NULL, 0, threadProc, this, 0, NULL );
+	return 0;
+}
+
+void MetricsServer::stop()
+{
+	if ( !thread_ )
+		return;
+
+	SetEvent( stop_ );
+	// the socket timeouts bound the wait
+	WaitForSingleObject( thread_, INFINITE );
+	CloseHandle( thread_ );
+	CloseHandle( stop_ );
+	thread_ = 0;
+	stop_ = 0;
+
+	if ( port_ )
+	{
+		closesocket( SOCKET( listener_ ) );
+		WSACleanup();
+		listener_ = size_t( INVALID_SOCKET );
+	}
+	else
+	{
+		metrics_.writeFile( file_.c_str() );
+	}
+}
+
+DWORD WINAPI MetricsServer::threadProc( void *param )
+{
+	MetricsServer *server = static_cast< MetricsServer* >( param );
+
+	if ( server->port_ )
+		server->serve();
+	else
+		server->snapshots();
+
+	return 0;
+}
+
+void MetricsServer::serve()
+{
+	const SOCKET listener = SOCKET( listener_ );
+	std::string text;
+
+	while ( WaitForSingleObject( stop_, 0 ) == WAIT_TIMEOUT )
+	{
+		// wait for a connection, checking the stop event every 100 ms
+		fd_set fds;
+		FD_ZERO( &fds );
+		FD_SET( listener, &fds );
+		timeval timeout = { 0, 100000 };
+		if ( select( int( listener + 1 ), &fds, NULL, NULL, &timeout ) <= 0 )
+			continue;
+
+		SOCKET client = accept( listener, NULL, NULL );
+		if ( client == INVALID_SOCKET )
+			continue;
+
+		// a silent or stalled client must not hold the thread
+		const DWORD ioTimeout = METRICS_IO_TIMEOUT;
+		setsockopt( client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&ioTimeout, sizeof( ioTimeout ) );
+		setsockopt( client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&ioTimeout, sizeof( ioTimeout ) );
+
+		// the request is not parsed: any request gets the metrics
+		char request[1024];
+		recv( client, request, sizeof( request ), 0 );
+
+		metrics_.write( text );
+		char header[160];
+		sprintf( header, "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %u\r\n\r\n",
+			unsigned( text.size() ) );
+		text.insert( 0, header );
+
+		// a client reading slowly is dropped at the deadline
+		const DWORD start = GetTickCount();
+		for ( size_t sent = 0; sent < text.size() && GetTickCount() - start < METRICS_SEND_TIMEOUT; )
+		{
+			const int n = send( client, text.data() + sent, int( text.size() - sent ), 0 );
+			if ( n <= 0 )
+				break;
+			sent += n;
+		}
+		closesocket( client );
+	}
+}
+
+void MetricsServer::snapshots()
+{
+	while ( WaitForSingleObject( stop_, period_ ) == WAIT_TIMEOUT )
+		metrics_.writeFile( file_.c_str() );
+}
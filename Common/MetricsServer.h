@@ -0,0 +1,84 @@
+/*
+    SP0256_CTS256A-AL2 - Metrics Endpoint.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "Metrics.h"
+
+#include <windows.h>
+
+#include <string>
+
+// Default period of the snapshots, in ms
+#define METRICS_PERIOD		1000
+
+// Timeout of the reads and writes of a connection, in ms
+#define METRICS_IO_TIMEOUT	1000
+
+// Total time to send a response, in ms
+#define METRICS_SEND_TIMEOUT	3000
+
+// Exposes a metrics registry from a background thread, either on a local
+// TCP port, answering each connection (e.g. the HTTP GET of a Prometheus
+// scrape) with the text format, or by writing snapshots to a file
+// periodically and at the end. Option syntax:
+//   Port | File[,Period]
+// where Port is a number, and Period in ms.
+class MetricsServer
+{
+public:
+	MetricsServer( Metrics &metrics );
+
+	~MetricsServer();
+
+	// start serving; returns 0 or the error (errno, or socket error)
+	int start( const char *option );
+
+	// stop serving, after a last snapshot
+	void stop();
+
+	bool isStarted() const
+	{
+		return thread_ != 0;
+	}
+
+private:
+	static DWORD WINAPI threadProc( void *param );
+
+	// answer the connections until stopped
+	void serve();
+
+	// write the snapshots until stopped
+	void snapshots();
+
+	Metrics					&metrics_;
+	std::string				file_;
+	unsigned				port_;
+	DWORD					period_;
+	size_t					listener_;		// listening socket
+	HANDLE					thread_;
+	HANDLE					stop_;			// event: stop serving
+};
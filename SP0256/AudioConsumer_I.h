@@ -0,0 +1,51 @@
+/*
+    SP0256A - Audio Consumer API.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AudioRing.h"
+
+// Number of committed blocks needed to start or restart the playback
+#define AUDIO_PREBUFFER 2
+
+// Audio consumer API: plays the blocks committed to an audio ring
+// (8-bit unsigned stereo samples), and releases them when done
+
+class AudioConsumer_I
+{
+public:
+	// open the consumer at the given sample frequency
+	virtual bool open( AudioRing &ring, ulong freq ) = 0;
+
+	// a block has been committed to the ring
+	virtual void push( uchar *block ) = 0;
+
+	// play the remaining blocks, then close the consumer
+	virtual void close() = 0;
+
+	virtual ~AudioConsumer_I()
+	{
+	}
+};
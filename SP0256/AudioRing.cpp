@@ -0,0 +1,66 @@
+/*
+    SP0256A - Audio Ring.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "AudioRing.h"
+
+#include <string.h>
+
+AudioRing::AudioRing( uint blocks, uint blockSize )
+	: data_( new uchar[ blocks * blockSize ] ), blocks_( blocks ), blockSize_( blockSize )
+	, write_( 0 ), read_( 0 ), underruns_( 0 ), waits_( 0 ), waitTime_( 0 ), releaseTimes_( new LONGLONG[ blocks ] )
+{
+	memset( data_, 0x80, blocks * blockSize );
+	memset( (void*)releaseTimes_, 0, blocks * sizeof( LONGLONG ) );
+	released_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+}
+
+AudioRing::~AudioRing()
+{
+	CloseHandle( released_ );
+	delete[] releaseTimes_;
+	delete[] data_;
+}
+
+uchar *AudioRing::acquire()
+{
+	if ( getFill() >= blocks_ )
+	{
+		InterlockedIncrement( &waits_ );
+		LONGLONG start = DeadlinePacer::now();
+
+		while ( getFill() >= blocks_ )
+			WaitForSingleObject( released_, AUDIO_RING_WAIT );
+
+		waitTime_ += DeadlinePacer::now() - start;
+	}
+
+	return getBlock( ulong( write_ ) % blocks_ );
+}
+
+void AudioRing::drain()
+{
+	while ( getFill() )
+		WaitForSingleObject( released_, AUDIO_RING_WAIT );
+}
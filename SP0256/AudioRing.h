@@ -0,0 +1,156 @@
+/*
+    SP0256A - Audio Ring.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "DeadlinePacer.h"
+#include "types.h"
+
+#include <windows.h>
+
+// Max wait in ms for a released block, in case a release event is missed
+#define AUDIO_RING_WAIT 100
+
+// Single producer / single consumer ring of preallocated audio blocks.
+// The producer acquires the next free block, fills it and commits it;
+// the consumer releases the committed blocks in the same order. The
+// producer waits while all the blocks are committed and not released
+// (back-pressure).
+
+class AudioRing
+{
+public:
+	AudioRing( uint blocks, uint blockSize );
+
+	~AudioRing();
+
+	// producer: next block to fill, waiting while the ring is full
+	uchar *acquire();
+
+	// producer: publish the acquired block
+	void commit()
+	{
+		InterlockedIncrement( &write_ );
+	}
+
+	// consumer: oldest committed block not yet released, or 0 if none
+	uchar *front() const
+	{
+		return write_ == read_ ? 0 : getBlock( ulong( read_ ) % blocks_ );
+	}
+
+	// consumer: release the oldest committed block
+	void release()
+	{
+		InterlockedExchange64( &releaseTimes_[ ulong( read_ ) % blocks_ ], DeadlinePacer::now() );
+		InterlockedIncrement( &read_ );
+		SetEvent( released_ );
+	}
+
+	// consumer: a block was needed but none was committed
+	void underrun()
+	{
+		InterlockedIncrement( &underruns_ );
+	}
+
+	// wait until all the committed blocks are released
+	void drain();
+
+	// number of committed blocks not yet released
+	uint getFill() const
+	{
+		return uint( ulong( write_ ) - ulong( read_ ) );
+	}
+
+	uchar *getBlock( uint index ) const
+	{
+		return data_ + index * blockSize_;
+	}
+
+	uint getIndex( const uchar *block ) const
+	{
+		return uint( ( block - data_ ) / blockSize_ );
+	}
+
+	uint getBlocks() const
+	{
+		return blocks_;
+	}
+
+	uint getBlockSize() const
+	{
+		return blockSize_;
+	}
+
+	// number of committed blocks
+	ulong getCommits() const
+	{
+		return ulong( write_ );
+	}
+
+	// number of blocks needed by the consumer while the ring was empty
+	ulong getUnderruns() const
+	{
+		return ulong( underruns_ );
+	}
+
+	// number of times the producer waited for a free block
+	ulong getWaits() const
+	{
+		return ulong( waits_ );
+	}
+
+	// total time the producer waited for a free block (ns)
+	LONGLONG getWaitTime() const
+	{
+		return waitTime_;
+	}
+
+	// number of released blocks
+	ulong getReleases() const
+	{
+		return ulong( read_ );
+	}
+
+	// time the block number n was released (ns, DeadlinePacer clock),
+	// valid for the last blocks released, before the one released next;
+	// read at once, as a 64-bit read may tear on x86
+	LONGLONG getReleaseTime( ulong n ) const
+	{
+		return InterlockedCompareExchange64( &releaseTimes_[ n % blocks_ ], 0, 0 );
+	}
+
+private:
+	uchar				*data_;
+	uint				blocks_;
+	uint				blockSize_;
+	volatile LONG		write_;			// committed blocks, written by the producer
+	volatile LONG		read_;			// released blocks, written by the consumer
+	volatile LONG		underruns_;
+	volatile LONG		waits_;
+	LONGLONG			waitTime_;		// written by the producer
+	volatile LONGLONG	*releaseTimes_;	// written by the consumer, per block
+	HANDLE				released_;		// auto-reset, set at each release
+};
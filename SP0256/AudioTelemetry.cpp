@@ -0,0 +1,203 @@
+/*
+    SP0256A - Audio Output Telemetry.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "AudioTelemetry.h"
+
+#include "AudioConsumer_I.h"
+
+// value below which p of the counted values are
+static ulong percentile( const std::vector<ulong> &counts, ulong n, double p )
+{
+	ulong sum = 0;
+	for ( ulong i = 0; i < counts.size(); ++i )
+	{
+		sum += counts[i];
+		if ( sum > n * p || sum == n )
+			return i;
+	}
+	return ulong( counts.size() - 1 );
+}
+
+AudioTelemetry::AudioTelemetry()
+	: pacer_( 0 ), freq_( 1 ), blockFrames_( 1 ), blockTime_( 0 ), start_( 0 ), startWait_( 0 ), busy_( 0 )
+	, commits_( 0 ), depthSamples_( 0 ), depthSum_( 0 )
+	, windowStart_( 0 ), windowWait_( 0 ), windowCommits_( 0 ), worstRealTime_( 0 )
+	, underruns_( 0 ), synthesisUnderruns_( 0 ), nEvents_( 0 )
+	, markHead_( 0 ), markTail_( 0 ), lostMarks_( 0 )
+	, latencies_( 0 ), latencyMin_( 0 ), latencyMax_( 0 ), latencySum_( 0 )
+{
+}
+
+void AudioTelemetry::start( const AudioRing &ring, ulong freq, ulong blockFrames )
+{
+	freq_ = freq;
+	blockFrames_ = blockFrames;
+	blockTime_ = LONGLONG( blockFrames ) * 1000000000 / freq;
+	start_ = windowStart_ = DeadlinePacer::now();
+	startWait_ = windowWait_ = getWaitTime( ring );
+	commits_ = windowCommits_ = ring.getCommits();
+	underruns_ = ring.getUnderruns();
+	depths_.assign( ring.getBlocks() + 1, 0 );
+}
+
+void AudioTelemetry::mark( ulong position )
+{
+	if ( markHead_ - markTail_ == TELEMETRY_MARKS )
+	{
+		++lostMarks_;
+		return;
+	}
+
+	Mark &mark = marks_[ markHead_++ % TELEMETRY_MARKS ];
+	mark.position = position;
+	mark.time = DeadlinePacer::now();
+}
+
+void AudioTelemetry::committed( const AudioRing &ring )
+{
+	LONGLONG now = DeadlinePacer::now();
+	LONGLONG wait = getWaitTime( ring );
+
+	commits_ = ring.getCommits();
+	busy_ = now - start_ - ( wait - startWait_ );
+
+	// real-time factor of the current window
+	LONGLONG windowBusy = now - windowStart_ - ( wait - windowWait_ );
+	double realTime = windowBusy > 0 ? double( commits_ - windowCommits_ ) * blockTime_ / windowBusy : 0.;
+
+	// underruns since the last block: blame the synthesis if it was slower than real time
+	for ( ulong underruns = ring.getUnderruns(); underruns_ < underruns; ++underruns_ )
+	{
+		if ( realTime < 1. )
+			++synthesisUnderruns_;
+		if ( nEvents_ < TELEMETRY_EVENTS )
+		{
+			events_[nEvents_].time = now - start_;
+			events_[nEvents_].realTime = realTime;
+			++nEvents_;
+		}
+	}
+
+	if ( now - windowStart_ >= TELEMETRY_WINDOW )
+	{
+		if ( !worstRealTime_ || realTime < worstRealTime_ )
+			worstRealTime_ = realTime;
+		windowStart_ = now;
+		windowWait_ = wait;
+		windowCommits_ = commits_;
+	}
+
+	// depth once playing
+	if ( commits_ > AUDIO_PREBUFFER )
+	{
+		ulong fill = ring.getFill();
+		if ( fill >= depths_.size() )
+			fill = ulong( depths_.size() - 1 );
+		++depths_[fill];
+		depthSum_ += fill;
+		++depthSamples_;
+	}
+
+	played( ring );
+}
+
+void AudioTelemetry::finish( const AudioRing &ring )
+{
+	played( ring );
+}
+
+void AudioTelemetry::played( const AudioRing &ring )
+{
+	ulong released = ring.getReleases();
+
+	for ( ; markTail_ != markHead_; ++markTail_ )
+	{
+		const Mark &mark = marks_[ markTail_ % TELEMETRY_MARKS ];
+		ulong block = mark.position / blockFrames_;
+
+		if ( block >= released )
+			break;
+
+		// release time overwritten since: the slot of block + blocks is the
+		// next one written by the consumer
+		if ( released - block >= ring.getBlocks() )
+		{
+			++lostMarks_;
+			continue;
+		}
+
+		LONGLONG releaseTime = ring.getReleaseTime( block );
+
+		// overwritten while reading
+		released = ring.getReleases();
+		if ( released - block >= ring.getBlocks() )
+		{
+			++lostMarks_;
+			continue;
+		}
+
+		// the sample is played before the end of its block
+		LONGLONG time = releaseTime
+			- LONGLONG( ( block + 1 ) * blockFrames_ - mark.position ) * 1000000000 / freq_;
+		LONGLONG latency = time - mark.time;
+
+		if ( !latencies_ || latency < latencyMin_ )
+			latencyMin_ = latency;
+		if ( !latencies_ || latency > latencyMax_ )
+			latencyMax_ = latency;
+		latencySum_ += double( latency );
+		++latencies_;
+	}
+}
+
+void AudioTelemetry::report( FILE *out ) const
+{
+	const double blockMs = blockTime_ / 1e6;
+	const double audio = double( commits_ ) * blockTime_ / 1e9;
+
+	fprintf( out, "realTime=%.2fx - worst=%.2fx - audio=%.3f s - busy=%.3f s\n",
+		busy_ > 0 ? audio * 1e9 / busy_ : 0., worstRealTime_, audio, busy_ / 1e9 );
+
+	if ( depthSamples_ )
+	{
+		fprintf( out, "bufferDepth min=%.0f p5=%.0f median=%.0f mean=%.0f max=%.0f ms\n",
+			percentile( depths_, depthSamples_, 0. ) * blockMs, percentile( depths_, depthSamples_, .05 ) * blockMs,
+			percentile( depths_, depthSamples_, .5 ) * blockMs, depthSum_ / depthSamples_ * blockMs,
+			percentile( depths_, depthSamples_, 1. ) * blockMs );
+	}
+
+	if ( latencies_ )
+	{
+		fprintf( out, "latency commands=%lu - min=%.1f mean=%.1f max=%.1f ms - lost=%lu\n",
+			latencies_, latencyMin_ / 1e6, latencySum_ / latencies_ / 1e6, latencyMax_ / 1e6, lostMarks_ );
+	}
+
+	fprintf( out, "underruns=%lu - synthesis=%lu - output=%lu\n",
+		underruns_, synthesisUnderruns_, underruns_ - synthesisUnderruns_ );
+
+	for ( ulong i = 0; i < nEvents_; ++i )
+		fprintf( out, "underrun at %.3f s - realTime=%.2fx\n", events_[i].time / 1e9, events_[i].realTime );
+}
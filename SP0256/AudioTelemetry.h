@@ -0,0 +1,131 @@
+/*
+    SP0256A - Audio Output Telemetry.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "AudioRing.h"
+#include "DeadlinePacer.h"
+#include "types.h"
+
+#include <cstdio>
+#include <vector>
+
+// Commands waiting for their first sample to be played
+#define TELEMETRY_MARKS		256
+
+// Underrun events kept for the report
+#define TELEMETRY_EVENTS	16
+
+// Window of the real-time factor (ns)
+#define TELEMETRY_WINDOW	1000000000
+
+// Live audio output telemetry, updated by the producer at each committed
+// block: ring depth, underruns, real-time factor of the synthesis (audio
+// time produced per time not waiting for the pacer or a free block), and
+// latency from a command to its first sample played (a block ends playing
+// when the consumer releases it). An underrun while the real-time factor
+// is below 1 is caused by the synthesis, else by the output path.
+
+class AudioTelemetry
+{
+public:
+	AudioTelemetry();
+
+	// pacer of the synthesis, for its wait time
+	void setPacer( const DeadlinePacer *pacer )
+	{
+		pacer_ = pacer;
+	}
+
+	// start of the playback: blocks of blockFrames stereo frames at freq Hz
+	void start( const AudioRing &ring, ulong freq, ulong blockFrames );
+
+	// a command was sent, its first sample is the frame number position
+	void mark( ulong position );
+
+	// a block was committed to the ring
+	void committed( const AudioRing &ring );
+
+	// the ring was drained: the last commands were played
+	void finish( const AudioRing &ring );
+
+	// write the summary
+	void report( FILE *out ) const;
+
+private:
+	struct Mark
+	{
+		ulong		position;		// frame number
+		LONGLONG	time;			// time sent (ns)
+	};
+
+	struct Event
+	{
+		LONGLONG	time;			// time since the start (ns)
+		double		realTime;		// real-time factor of the synthesis then
+	};
+
+	// total time waited by the producer (ns)
+	LONGLONG getWaitTime( const AudioRing &ring ) const
+	{
+		return ring.getWaitTime() + ( pacer_ ? pacer_->getWaitTime() : 0 );
+	}
+
+	// latencies of the commands played up to now
+	void played( const AudioRing &ring );
+
+	const DeadlinePacer	*pacer_;
+	ulong				freq_;
+	ulong				blockFrames_;
+	LONGLONG			blockTime_;			// ns
+	LONGLONG			start_;
+	LONGLONG			startWait_;
+	LONGLONG			busy_;				// up to the last commit
+	ulong				commits_;
+	// ring depth, per committed block once playing
+	std::vector<ulong>	depths_;
+	ulong				depthSamples_;
+	double				depthSum_;
+	// real-time factor windows
+	LONGLONG			windowStart_;
+	LONGLONG			windowWait_;
+	ulong				windowCommits_;
+	double				worstRealTime_;
+	// underruns
+	ulong				underruns_;
+	ulong				synthesisUnderruns_;
+	ulong				nEvents_;
+	Event				events_[TELEMETRY_EVENTS];
+	// command latencies
+	Mark				marks_[TELEMETRY_MARKS];
+	ulong				markHead_;
+	ulong				markTail_;
+	ulong				lostMarks_;
+	ulong				latencies_;
+	LONGLONG			latencyMin_;
+	LONGLONG			latencyMax_;
+	double				latencySum_;
+};
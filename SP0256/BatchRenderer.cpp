@@ -0,0 +1,269 @@
+/*
+    SP0256A - Batch Renderer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "BatchRenderer.h"
+#include "MappedInput.h"
+#include "WaveWriter.h"
+
+#include <sstream>
+#include <ctime>
+
+BatchRenderer::BatchRenderer( const LabelTokenizer &tokenizer, const uint8_t *mask, char mode, uint threads )
+: tokenizer_( tokenizer ), mask_( mask ), mode_( mode ), threads_( threads ), waveFreq_( 0 ), sampFreq_( 0 )
+, nBitsPerSample_( 8 ), formatTag_( WAVE_TAG_PCM ), next_( 0 ), con_( stdout )
+, jobsMetric_( 0 ), commandsMetric_( 0 ), samplesMetric_( 0 ), pendingMetric_( 0 ), renderMetric_( 0 )
+{
+	InitializeCriticalSection( &lock_ );
+}
+
+BatchRenderer::~BatchRenderer(void)
+{
+	DeleteCriticalSection( &lock_ );
+}
+
+void BatchRenderer::setOutput( unsigned waveFreq, unsigned sampFreq, unsigned nBitsPerSample, unsigned formatTag )
+{
+	waveFreq_ = waveFreq;
+	sampFreq_ = sampFreq;
+	nBitsPerSample_ = nBitsPerSample;
+	formatTag_ = formatTag;
+}
+
+void BatchRenderer::setMetrics( Metrics &metrics )
+{
+	jobsMetric_ = &metrics.counter( "sp0256_utterances_total", "Utterances rendered (batch jobs or inputs)." );
+	commandsMetric_ = &metrics.counter( "sp0256_commands_total", "Commands sent to the synthesizers." );
+	samplesMetric_ = &metrics.counter( "sp0256_samples_total", "Samples rendered." );
+	pendingMetric_ = &metrics.gauge( "sp0256_batch_pending_jobs", "Batch jobs not yet taken by a worker." );
+	renderMetric_ = &metrics.histogram( "sp0256_batch_render_seconds", "Rendering time of the batch jobs.",
+		Metrics::latencyBounds, Metrics::nLatencyBounds );
+}
+
+uint BatchRenderer::load( std::streambuf &manifest )
+{
+	uint lineNo = 0;
+	std::string line;
+	int c;
+
+	do
+	{
+		c = manifest.sbumpc();
+		if ( c != '\n' && c != EOF )
+		{
+			if ( c != '\r' )
+				line += char( c );
+			continue;
+		}
+
+		++lineNo;
+		const size_t begin = line.find_first_not_of( " \t" );
+		if ( begin != std::string::npos && line[begin] != '#' )
+		{
+			const size_t end = line.find_first_of( " \t", begin );
+			const size_t source = end == std::string::npos ? end : line.find_first_not_of( " \t", end );
+			if ( source == std::string::npos )
+				return lineNo;
+
+			Job job;
+			job.output = line.substr( begin, end - begin );
+			job.file = line[source] == '@';
+			job.source = line.substr( job.file ? source + 1 : source );
+			job.errno_ = 0;
+			job.samples = 0;
+			job.seconds = 0;
+			jobs_.push_back( job );
+		}
+		line.clear();
+	}
+	while ( c != EOF );
+
+	return 0;
+}
+
+uint BatchRenderer::run( FILE *con )
+{
+	con_ = con;
+	next_ = 0;
+
+	const clock_t start = clock();
+
+	std::vector< HANDLE > workers;
+	for ( uint i=0; i<threads_ && i<jobs_.size(); ++i )
+		workers.push_back( CreateThread( NULL, 0, workerProc, this, 0, NULL ) );
+	for ( size_t i=0; i<workers.size(); ++i )
+	{
+		WaitForSingleObject( workers[i], INFINITE );
+		CloseHandle( workers[i] );
+	}
+
+	const double elapsed = double( clock() - start ) / CLOCKS_PER_SEC;
+
+	uint failed = 0;
+	ulong samples = 0;
+	double busy = 0;
+	for ( size_t i=0; i<jobs_.size(); ++i )
+	{
+		failed += jobs_[i].errno_ != 0;
+		samples += jobs_[i].samples;
+		busy += jobs_[i].seconds;
+	}
+
+	const double audio = double( samples ) / sampFreq_;
+	fprintf( con_, "jobs=%u - failed=%u - threads=%u - audio=%.3f s - elapsed=%.3f s - busy=%.3f s\n",
+		getJobs(), failed, uint( workers.size() ), audio, elapsed, busy );
+	if ( elapsed > 0 )
+		fprintf( con_, "throughput: %.1f jobs/s - %.0f samples/s - x%.1f real time\n",
+			getJobs() / elapsed, samples / elapsed, audio / elapsed );
+
+	return failed;
+}
+
+DWORD WINAPI BatchRenderer::workerProc( void *param )
+{
+	static_cast< BatchRenderer* >( param )->work();
+	return 0;
+}
+
+void BatchRenderer::work()
+{
+	// take the jobs in manifest order
+	for (;;)
+	{
+		const LONG index = InterlockedIncrement( &next_ ) - 1;
+		if ( index >= LONG( jobs_.size() ) )
+			break;
+		if ( pendingMetric_ )
+			pendingMetric_->set( double( LONG( jobs_.size() ) - index - 1 ) );
+		render( jobs_[index] );
+		report( jobs_[index] );
+	}
+}
+
+void BatchRenderer::render( Job &job )
+{
+	const clock_t start = clock();
+
+	MappedInput file;
+	std::stringbuf text( job.source );
+	std::streambuf *input = &text;
+	char mode = 'T';
+
+	if ( job.file )
+	{
+		job.errno_ = file.open( job.source.c_str() );
+		if ( job.errno_ )
+		{
+			job.failed = job.source;
+			return;
+		}
+		input = &file;
+		mode = mode_;
+	}
+
+	WaveWriter writer;
+	job.errno_ = writer.create( job.output.c_str(), waveFreq_, sampFreq_, 1, nBitsPerSample_, formatTag_ );
+	if ( job.errno_ )
+	{
+		job.failed = job.output;
+		return;
+	}
+
+	// independent synthesizer
+	ivoice_t voice;
+	sp0256_voiceInit( &voice, mask_ );
+
+	bool eos = false;
+	ulong samples = 0;
+	int16_t block[SP0256_RENDER_BLOCK];
+
+	while ( !eos || !sp0256_voiceHalted( &voice ) )
+	{
+		if ( !eos && sp0256_voiceGetStatus( &voice ) )
+		{
+			int code;
+			if ( mode == 'B' )
+			{
+				code = input->sbumpc();
+				if ( code != EOF )
+					code &= 0x3F;
+			}
+			else
+			{
+				code = tokenizer_.next( *input );
+			}
+
+			if ( code < 0 )
+				eos = true;
+			else
+			{
+				sp0256_voiceSendCommand( &voice, uint32_t( code ) );
+				if ( commandsMetric_ )
+					commandsMetric_->add();
+			}
+		}
+
+		// up to the next command
+		const int n = sp0256_voiceRender( &voice, block, SP0256_RENDER_BLOCK );
+		for ( int i=0; i<n; ++i )
+		{
+			int sample = block[i];
+			if ( formatTag_ == WAVE_TAG_PCM && nBitsPerSample_ == 8 )
+				sample = ( ( sample >> 8 ) + 0x80 ) & 0xFF;
+			writer.write( sample );
+		}
+		samples += n;
+	}
+
+	writer.close();
+	job.errno_ = writer.getErrno();
+	job.failed = job.output;
+	job.samples = samples;
+	job.seconds = double( clock() - start ) / CLOCKS_PER_SEC;
+
+	if ( jobsMetric_ )
+	{
+		jobsMetric_->add();
+		samplesMetric_->add( samples );
+		renderMetric_->observe( job.seconds );
+	}
+}
+
+void BatchRenderer::report( const Job &job )
+{
+	EnterCriticalSection( &lock_ );
+	if ( job.errno_ )
+	{
+		char buf[80];
+		strerror_s( buf, job.errno_ );
+		fprintf( con_, "%s error: %s\n", job.failed.c_str(), buf );
+	}
+	else
+	{
+		const double audio = double( job.samples ) / sampFreq_;
+		fprintf( con_, "%s: %lu samples - %.3f s in %.3f s - x%.1f real time\n",
+			job.output.c_str(), job.samples, audio, job.seconds, job.seconds > 0 ? audio / job.seconds : 0. );
+	}
+	LeaveCriticalSection( &lock_ );
+}
@@ -0,0 +1,106 @@
+/*
+    SP0256A - Batch Renderer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "LabelTokenizer.h"
+#include "Metrics.h"
+#include "sp0256.h"
+
+#include <windows.h>
+
+#include <cstdio>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Renders the jobs of a manifest to wave files, on a fixed pool of worker
+// threads running independent synthesizer instances.
+// Manifest: one job per line, "OutFile Source", where Source is @InFile
+// (labels, or binary with -b) or inline labels; '#' starts a comment line.
+
+class BatchRenderer
+{
+public:
+	BatchRenderer( const LabelTokenizer &tokenizer, const uint8_t *mask, char mode, uint threads );
+
+	~BatchRenderer(void);
+
+	// output format, as WaveWriter::create()
+	void setOutput( unsigned waveFreq, unsigned sampFreq, unsigned nBitsPerSample, unsigned formatTag );
+
+	// count the jobs, commands and samples, and time the jobs
+	void setMetrics( Metrics &metrics );
+
+	// read the manifest; returns 0, or the number of the first invalid line
+	uint load( std::streambuf &manifest );
+
+	// render all jobs, printing their throughput to con; returns the number of failed jobs
+	uint run( FILE *con );
+
+	uint getJobs() const
+	{
+		return uint( jobs_.size() );
+	}
+
+private:
+	struct Job
+	{
+		std::string		output;
+		std::string		source;
+		bool			file;		// source is an input file name
+		int				errno_;
+		std::string		failed;		// file name of the error
+		ulong			samples;
+		double			seconds;	// rendering time
+	};
+
+	static DWORD WINAPI workerProc( void *param );
+
+	void work();
+
+	void render( Job &job );
+
+	// print the job result
+	void report( const Job &job );
+
+	const LabelTokenizer	&tokenizer_;
+	const uint8_t			*mask_;
+	char					mode_;
+	uint					threads_;
+	unsigned				waveFreq_;
+	unsigned				sampFreq_;
+	unsigned				nBitsPerSample_;
+	unsigned				formatTag_;
+	std::vector< Job >		jobs_;
+	volatile LONG			next_;			// next job to take
+	CRITICAL_SECTION		lock_;			// console output
+	FILE					*con_;
+	Metrics::Counter		*jobsMetric_;
+	Metrics::Counter		*commandsMetric_;
+	Metrics::Counter		*samplesMetric_;
+	Metrics::Gauge			*pendingMetric_;
+	Metrics::Histogram		*renderMetric_;
+};
@@ -0,0 +1,121 @@
+/*
+    SP0256A - Deadline Pacer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DeadlinePacer.h"
+
+#include <math.h>
+
+DeadlinePacer::DeadlinePacer()
+	: period_( 10000000 ), deadline_( -1 ), drift_( 0 ), maxDrift_( 0 ), jitterMax_( 0 ), waitTime_( 0 )
+	, jitterSum_( 0 ), jitterSumSq_( 0 ), sleeps_( 0 ), periods_( 0 ), resyncs_( 0 )
+{
+}
+
+LONGLONG DeadlinePacer::now()
+{
+	static LONGLONG freq = 0;
+	LARGE_INTEGER counter;
+
+	if ( !freq )
+	{
+		LARGE_INTEGER f;
+		QueryPerformanceFrequency( &f );
+		freq = f.QuadPart;
+	}
+
+	QueryPerformanceCounter( &counter );
+
+	// split to avoid the overflow of counter * 1e9
+	return ( counter.QuadPart / freq ) * 1000000000 + ( counter.QuadPart % freq ) * 1000000000 / freq;
+}
+
+void DeadlinePacer::reset()
+{
+	deadline_ = now();
+	drift_ = 0;
+}
+
+void DeadlinePacer::wait( Sleeper_I *sleeper )
+{
+	if ( deadline_ < 0 )
+		reset();
+
+	deadline_ += period_;
+	++periods_;
+
+	LONGLONG t = now();
+
+	if ( t >= deadline_ )
+	{
+		// late: don't sleep, catch up on the next periods
+		drift_ = t - deadline_;
+		if ( drift_ > maxDrift_ )
+			maxDrift_ = drift_;
+
+		if ( drift_ > PACER_RESYNC_LAG )
+		{
+			// too late to catch up
+			++resyncs_;
+			reset();
+		}
+		return;
+	}
+
+	drift_ = 0;
+
+	// sleep once, then yield until the deadline
+	LONGLONG left = deadline_ - t;
+	LONGLONG start = t;
+	if ( left > PACER_SLEEP_MARGIN && sleeper )
+		sleeper->sleep( ulong( ( left - PACER_SLEEP_MARGIN ) / 1000000 ) );
+
+	while ( ( t = now() ) < deadline_ )
+		SwitchToThread();
+
+	waitTime_ += t - start;
+
+	LONGLONG jitter = t - deadline_;
+	jitterSum_ += double( jitter );
+	jitterSumSq_ += double( jitter ) * double( jitter );
+	if ( jitter > jitterMax_ )
+		jitterMax_ = jitter;
+	++sleeps_;
+}
+
+double DeadlinePacer::getJitterMean() const
+{
+	return sleeps_ ? jitterSum_ / sleeps_ : 0.;
+}
+
+double DeadlinePacer::getJitterStdDev() const
+{
+	if ( !sleeps_ )
+		return 0.;
+
+	double mean = jitterSum_ / sleeps_;
+	double var = jitterSumSq_ / sleeps_ - mean * mean;
+
+	return var > 0 ? sqrt( var ) : 0.;
+}
@@ -0,0 +1,133 @@
+/*
+    SP0256A - Deadline Pacer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Sleeper_I.h"
+#include "types.h"
+
+#include <windows.h>
+
+// Time left to the deadline (ns) below which the pacer yields instead of sleeping
+#define PACER_SLEEP_MARGIN	2000000
+
+// Lag (ns) beyond which the deadlines are restarted (e.g. after a suspend)
+#define PACER_RESYNC_LAG	1000000000
+
+// Paces a periodic task on absolute deadlines from a monotonic nanosecond
+// clock: each wait() sleeps once until the end of the current period, so
+// the sleep and wake-up errors don't accumulate.
+
+class DeadlinePacer
+{
+public:
+	DeadlinePacer();
+
+	// set the period in ns, and restart the deadlines
+	void setPeriod( LONGLONG period )
+	{
+		period_ = period;
+		deadline_ = -1;
+	}
+
+	LONGLONG getPeriod() const
+	{
+		return period_;
+	}
+
+	// end of the current period (ns), or -1 before the first wait
+	LONGLONG getDeadline() const
+	{
+		return deadline_;
+	}
+
+	// wait for the end of the current period
+	void wait( Sleeper_I *sleeper );
+
+	// restart the deadlines at the next wait
+	void restart()
+	{
+		deadline_ = -1;
+	}
+
+	// monotonic clock in ns
+	static LONGLONG now();
+
+	// number of periods waited for
+	ulong getPeriods() const
+	{
+		return periods_;
+	}
+
+	// lag behind the deadline when the last period ended late (ns)
+	LONGLONG getDrift() const
+	{
+		return drift_;
+	}
+
+	// max lag behind the deadlines (ns)
+	LONGLONG getMaxDrift() const
+	{
+		return maxDrift_;
+	}
+
+	// total time spent waiting for the deadlines (ns)
+	LONGLONG getWaitTime() const
+	{
+		return waitTime_;
+	}
+
+	// number of deadline restarts
+	ulong getResyncs() const
+	{
+		return resyncs_;
+	}
+
+	// wake-up delay after the deadline, mean / max / standard deviation (ns)
+	double getJitterMean() const;
+
+	LONGLONG getJitterMax() const
+	{
+		return jitterMax_;
+	}
+
+	double getJitterStdDev() const;
+
+private:
+	// restart the deadlines from now
+	void reset();
+
+	LONGLONG		period_;
+	LONGLONG		deadline_;			// end of the current period, or -1
+	LONGLONG		drift_;
+	LONGLONG		maxDrift_;
+	LONGLONG		jitterMax_;
+	LONGLONG		waitTime_;
+	double			jitterSum_;
+	double			jitterSumSq_;
+	ulong			sleeps_;			// number of wake-ups in the jitter stats
+	ulong			periods_;
+	ulong			resyncs_;
+};
@@ -0,0 +1,126 @@
+/*
+    SP0256A - SPB640 Decle Stream.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "DecleStream.h"
+
+#include <cerrno>
+
+void DecleStream::feed()
+{
+	if ( end_ )
+		return;
+
+	if ( sp0256_isFifoFull() )
+	{
+		++fullWaits_;
+		return;
+	}
+
+	do
+	{
+		const int lo = input_.sbumpc();
+		const int hi = input_.sbumpc();
+		if ( hi == EOF )
+		{
+			// let the micro-sequencer drain the FIFO
+			end_ = true;
+			sp0256_setFifoEnd( 1 );
+			break;
+		}
+		sp0256_pushDecle( uint32_t( lo | hi << 8 ) );
+		++decles_;
+	}
+	while ( !sp0256_isFifoFull() );
+}
+
+int DecleWriter::create( const char *fileName )
+{
+	close();
+
+	errno_ = fopen_s( &file_, fileName, "wb" );
+	bits_ = 0;
+	nBits_ = 0;
+	decles_ = 0;
+	calls_ = 0;
+	return errno_;
+}
+
+// Reverse the bits of a byte: the branch addresses are stored reversed
+static uint32_t reverse8( uint32_t byte )
+{
+	uint32_t rev = 0;
+	for ( int i=0; i<8; ++i, byte >>= 1 )
+		rev = rev << 1 | ( byte & 1 );
+	return rev;
+}
+
+void DecleWriter::call( int command )
+{
+	// entry of the command: byte $1000 + 2 * command
+	const uint32_t entry = 2 * uint32_t( command );
+
+	putBits( 0x8, 4 );		// SETPAGE $1000
+	putBits( 0x0, 4 );
+	putBits( reverse8( ( entry >> 8 ) & 0xF ) >> 4, 4 );	// JSR entry
+	putBits( 0xD, 4 );
+	putBits( reverse8( entry & 0xFF ), 8 );
+	align();
+	++calls_;
+}
+
+void DecleWriter::close()
+{
+	if ( file_ )
+	{
+		if ( calls_ )
+		{
+			putBits( 0x0, 8 );	// HLT
+			align();
+		}
+		if ( fclose( file_ ) && !errno_ )
+			errno_ = errno;
+		file_ = 0;
+	}
+}
+
+void DecleWriter::putBits( uint32_t bits, int n )
+{
+	bits_ |= ( bits & ( ( 1u << n ) - 1 ) ) << nBits_;
+	nBits_ += n;
+	while ( nBits_ >= 10 )
+	{
+		fputc( bits_ & 0xFF, file_ );
+		fputc( ( bits_ >> 8 ) & 0x03, file_ );
+		bits_ >>= 10;
+		nBits_ -= 10;
+		++decles_;
+	}
+}
+
+void DecleWriter::align()
+{
+	if ( nBits_ )
+		putBits( 0, 10 - nBits_ );
+}
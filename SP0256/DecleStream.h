@@ -0,0 +1,117 @@
+/*
+    SP0256A - SPB640 Decle Stream.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "sp0256.h"
+
+#include <cstdio>
+#include <streambuf>
+
+// Decle stream file: 10-bit decles in 16-bit little-endian words
+
+// Feeds the SPB640 FIFO from a decle stream, while it is not full
+class DecleStream
+{
+public:
+	DecleStream( std::streambuf &input )
+		: input_( input ), end_( false ), decles_( 0 ), fullWaits_( 0 )
+	{
+	}
+
+	// Push decles until the FIFO is full or the stream ends
+	void feed();
+
+	// Stream ended and FIFO empty ?
+	bool isDrained() const
+	{
+		return end_ && !sp0256_getFifoLevel();
+	}
+
+	ulong getDecles() const
+	{
+		return decles_;
+	}
+
+	// number of feeds held back by a full FIFO
+	ulong getFullWaits() const
+	{
+		return fullWaits_;
+	}
+
+private:
+	std::streambuf		&input_;
+	bool				end_;
+	ulong				decles_;
+	ulong				fullWaits_;
+};
+
+// Writes a decle stream calling the speech ROM entries from the FIFO,
+// one program per utterance
+class DecleWriter
+{
+public:
+	DecleWriter()
+		: file_( 0 ), errno_( 0 ), bits_( 0 ), nBits_( 0 ), decles_( 0 ), calls_( 0 )
+	{
+	}
+
+	~DecleWriter()
+	{
+		close();
+	}
+
+	int create( const char *fileName );
+
+	// Call the ROM entry of a command: SETPAGE $1000, JSR entry.
+	// The return to the FIFO discards the partial decle.
+	void call( int command );
+
+	// End the program with a HLT and close the file
+	void close();
+
+	int getErrno() const
+	{
+		return errno_;
+	}
+
+	ulong getDecles() const
+	{
+		return decles_;
+	}
+
+private:
+	void putBits( uint32_t bits, int n );
+
+	// Write the partial decle, if any
+	void align();
+
+	FILE				*file_;
+	int					errno_;
+	uint32_t			bits_;
+	int					nBits_;
+	ulong				decles_;
+	ulong				calls_;
+};
@@ -0,0 +1,155 @@
+/*
+    SP0256A - LPC Frame Stream.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "FrameStream.h"
+
+#include <cstring>
+#include <cerrno>
+
+int FrameRecorder::create( const char *fileName )
+{
+	close();
+
+	errno_ = fopen_s( &file_, fileName, "wb" );
+	if ( errno_ )
+		return errno_;
+
+	setvbuf( file_, 0, _IOFBF, FRAME_STREAM_BUFFER );
+	fwrite( FRAME_STREAM_MAGIC, 1, 4, file_ );
+	fputc( FRAME_STREAM_VERSION, file_ );
+	bytes_ = 5;
+	frames_ = 0;
+	memset( regs_, 0, sizeof( regs_ ) );
+
+	sp0256_setFrameRecorder( recordProc, this );
+	return 0;
+}
+
+void FrameRecorder::close()
+{
+	if ( file_ )
+	{
+		sp0256_setFrameRecorder( 0, 0 );
+		if ( fclose( file_ ) && !errno_ )
+			errno_ = errno;
+		file_ = 0;
+	}
+}
+
+void FrameRecorder::recordProc( void *param, const lpc12_t *filt, int flags )
+{
+	static_cast< FrameRecorder* >( param )->record( filt, flags );
+}
+
+void FrameRecorder::record( const lpc12_t *filt, int flags )
+{
+	uint8_t buf[3 + FRAME_STREAM_REGS];
+	size_t n = 0;
+
+	if ( flags & SP0256_FRAME_HALT )
+	{
+		buf[n++] = 0;
+	}
+	else
+	{
+		buf[n++] = uint8_t( ( filt->rpt & FRAME_STREAM_RPT_MASK ) | ( flags & ( SP0256_FRAME_SILENT | SP0256_FRAME_START ) ) );
+		n += 2;
+		uint16_t mask = 0;
+		for ( int i=0; i<FRAME_STREAM_REGS; ++i )
+		{
+			if ( filt->r[i] != regs_[i] )
+			{
+				mask |= 1 << i;
+				buf[n++] = regs_[i] = filt->r[i];
+			}
+		}
+		buf[1] = uint8_t( mask );
+		buf[2] = uint8_t( mask >> 8 );
+		++frames_;
+	}
+
+	if ( fwrite( buf, 1, n, file_ ) != n && !errno_ )
+		errno_ = errno;
+	bytes_ += ulong( n );
+}
+
+int FrameReplay::open()
+{
+	char magic[5];
+	if ( input_.sgetn( magic, 5 ) != 5 || memcmp( magic, FRAME_STREAM_MAGIC, 4 ) || magic[4] != FRAME_STREAM_VERSION )
+		return EINVAL;
+
+	sp0256_replayInit( &filt_ );
+	memset( regs_, 0, sizeof( regs_ ) );
+	silent_ = false;
+	done_ = false;
+	frames_ = 0;
+	return 0;
+}
+
+bool FrameReplay::nextFrame()
+{
+	const int head = input_.sbumpc();
+	if ( head == EOF || !( head & FRAME_STREAM_RPT_MASK ) )
+		return false;
+
+	const int lo = input_.sbumpc();
+	const int hi = input_.sbumpc();
+	if ( hi == EOF )
+		return false;
+
+	const int mask = lo | hi << 8;
+	for ( int i=0; i<FRAME_STREAM_REGS; ++i )
+	{
+		if ( mask & ( 1 << i ) )
+		{
+			const int reg = input_.sbumpc();
+			if ( reg == EOF )
+				return false;
+			regs_[i] = uint8_t( reg );
+		}
+	}
+
+	silent_ = ( head & SP0256_FRAME_SILENT ) != 0;
+	sp0256_replayFrame( &filt_, regs_, head & FRAME_STREAM_RPT_MASK );
+	++frames_;
+	return true;
+}
+
+int FrameReplay::getNextSample()
+{
+	if ( done_ )
+		return 0;
+
+	// load the next frame when the repeat count expires, as the micro-sequencer
+	if ( filt_.rpt <= 0 && filt_.cnt <= 0 && !nextFrame() )
+	{
+		// halted: silent
+		done_ = true;
+		return 0;
+	}
+
+	return sp0256_replaySample( &filt_, silent_ );
+}
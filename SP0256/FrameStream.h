@@ -0,0 +1,129 @@
+/*
+    SP0256A - LPC Frame Stream.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "sp0256.h"
+
+#include <cstdio>
+#include <streambuf>
+
+// LPC frame stream file format:
+// - header: "LPCF" and version byte;
+// - frame: byte = repeat count (1..63) | SP0256_FRAME_SILENT | SP0256_FRAME_START,
+//   word (LE) = mask of the registers changed since the previous frame,
+//   then the changed register bytes, in register order;
+// - halt: byte = 0, at the end of the speech.
+#define FRAME_STREAM_MAGIC		"LPCF"
+#define FRAME_STREAM_VERSION	1
+#define FRAME_STREAM_REGS		16
+#define FRAME_STREAM_RPT_MASK	0x3F
+#define FRAME_STREAM_BUFFER		0x10000
+
+// Records the frames produced by the micro-sequencer to a frame stream file
+class FrameRecorder
+{
+public:
+	FrameRecorder()
+		: file_( 0 ), errno_( 0 ), frames_( 0 ), bytes_( 0 )
+	{
+	}
+
+	~FrameRecorder()
+	{
+		close();
+	}
+
+	// Create the file and start recording
+	int create( const char *fileName );
+
+	// Stop recording and close the file
+	void close();
+
+	// system errno of the last file i/o
+	int getErrno() const
+	{
+		return errno_;
+	}
+
+	ulong getFrames() const
+	{
+		return frames_;
+	}
+
+	ulong getBytes() const
+	{
+		return bytes_;
+	}
+
+private:
+	static void recordProc( void *param, const lpc12_t *filt, int flags );
+
+	void record( const lpc12_t *filt, int flags );
+
+	FILE				*file_;
+	int					errno_;
+	uint8_t				regs_[FRAME_STREAM_REGS];	// last recorded register set
+	ulong				frames_;
+	ulong				bytes_;
+};
+
+// Renders the samples of a frame stream, without micro-sequencing
+class FrameReplay
+{
+public:
+	FrameReplay( std::streambuf &input )
+		: input_( input ), silent_( false ), done_( true ), frames_( 0 )
+	{
+	}
+
+	// Read the header; EINVAL if not a frame stream
+	int open();
+
+	// No more samples ?
+	bool isDone() const
+	{
+		return done_;
+	}
+
+	// Next sample, as sp0256_getNextSample()
+	int getNextSample();
+
+	ulong getFrames() const
+	{
+		return frames_;
+	}
+
+private:
+	// Load the next frame; false at halt or end of stream
+	bool nextFrame();
+
+	std::streambuf		&input_;
+	lpc12_t				filt_;
+	uint8_t				regs_[FRAME_STREAM_REGS];	// last decoded register set
+	bool				silent_;
+	bool				done_;
+	ulong				frames_;
+};
@@ -0,0 +1,64 @@
+/*
+    SP0256A - Allophone Label Tokenizer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LabelTokenizer.h"
+
+#include <ctype.h>
+
+LabelTokenizer::LabelTokenizer( const char * const labels[], unsigned nlabels )
+	: states_( 2 * LABEL_SYMBOLS, LABEL_STATE_DEAD ), codes_( 2, -1 )
+{
+	for ( int c = 0; c < 256; ++c )
+	{
+		symbols_[c] = isdigit( c ) ? schar( c - '0' )
+			: isupper( c ) ? schar( c - 'A' + 10 )
+			: islower( c ) ? schar( c - 'a' + 10 )
+			: -1;
+	}
+
+	for ( unsigned i = 0; i < nlabels; ++i )
+	{
+		int state = LABEL_STATE_ROOT;
+		const char *p = labels[i];
+
+		for ( ; *p && symbols_[ uchar( *p ) ] >= 0; ++p )
+		{
+			sshort &next = states_[ state * LABEL_SYMBOLS + symbols_[ uchar( *p ) ] ];
+
+			if ( next == LABEL_STATE_DEAD )
+			{
+				next = sshort( codes_.size() );
+				codes_.push_back( -1 );
+				states_.resize( states_.size() + LABEL_SYMBOLS, LABEL_STATE_DEAD );
+			}
+
+			state = states_[ state * LABEL_SYMBOLS + symbols_[ uchar( *p ) ] ];
+		}
+
+		// labels with other chars can't be matched within a word
+		if ( !*p && p != labels[i] )
+			codes_[ state ] = sshort( i );
+	}
+}
@@ -0,0 +1,76 @@
+/*
+    SP0256A - Allophone Label Tokenizer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "types.h"
+
+#include <streambuf>
+#include <vector>
+
+// Number of input symbols: 0-9 and A-Z (case insensitive)
+#define LABEL_SYMBOLS	36
+
+// Tokenizer matching the allophone labels in a text input, by a DFA built
+// from the labels table. The labels are matched case-insensitively within
+// the words, and the first (shortest) matching label is returned.
+
+class LabelTokenizer
+{
+public:
+	LabelTokenizer( const char * const labels[], unsigned nlabels );
+
+	// next label code from the input, or -1 at end of input
+	int next( std::streambuf &input ) const
+	{
+		int state = LABEL_STATE_ROOT;
+
+		for (;;)
+		{
+			int c = input.sbumpc();
+
+			if ( c == EOF )
+				return -1;
+
+			// a non alphanumeric char restarts the word
+			const int symbol = symbols_[ uchar( c ) ];
+			state = symbol < 0 ? LABEL_STATE_ROOT : states_[ state * LABEL_SYMBOLS + symbol ];
+
+			if ( codes_[ state ] >= 0 )
+				return codes_[ state ];
+		}
+	}
+
+private:
+	enum
+	{
+		LABEL_STATE_DEAD = 0,	// no label starts like the current word
+		LABEL_STATE_ROOT = 1	// start of word
+	};
+
+	schar					symbols_[256];
+	std::vector< sshort >	states_;
+	std::vector< sshort >	codes_;
+};
@@ -0,0 +1,348 @@
+/*
+    SP0256A - Micro-Benchmarks.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "MicroBenchmarks.h"
+
+#include "sp0256.h"
+#include "sp0256_al2.h"
+#include "WaveWriter.h"
+
+#include <windows.h>
+#include <string.h>
+
+// ROM page of the synthetic programs, as set at reset
+#define PROGRAM_PAGE	( 0x1000 << 3 )
+
+// Frame instructions by opcode class (opcode fields as fetched)
+static const uint8_t loadOpcodes[]		= { 0x8, 0x4, 0x2, 0x3, 0x7 };	// LOADALL, LOAD_2, LOAD_4, LOAD_C, LOAD_E
+static const uint8_t setmsbOpcodes[]	= { 0xC, 0xA, 0x6, 0x5 };		// SETMSB_3, SETMSB_5, SETMSB_6, SETMSB_A
+static const uint8_t deltaOpcodes[]		= { 0x9, 0xB };					// DELTA_9, DELTA_D
+static const uint8_t pauseOpcodes[]		= { 0xF };						// PAUSE
+
+// Results of the kernels, kept from the optimizer
+static volatile uint32_t sink;
+
+// Filter kernel
+struct FilterParam
+{
+	lpc12_t		filt;
+	int16_t		out[SCBUF_SIZE];
+};
+
+static void filterKernel( void *param, unsigned iterations )
+{
+	FilterParam &p = *static_cast< FilterParam* >( param );
+	lpc12_t filt = p.filt;
+	filt.rpt = int( iterations ) + 1;
+	filt.cnt = 0;
+	sp0256_filterUpdate( &filt, int( iterations ), p.out );
+}
+
+// Voice kernels: micro-sequencer and bit fetch
+struct VoiceParam
+{
+	ivoice_t	voice;
+	int			start;
+	int			end;
+	uint8_t		program[0x1000];
+};
+
+static void microKernel( void *param, unsigned iterations )
+{
+	ivoice_t &voice = static_cast< VoiceParam* >( param )->voice;
+	for ( unsigned i=0; i<iterations; ++i )
+	{
+		voice.filt.rpt = 0;
+		voice.filt.cnt = 0;
+		sp0256_voiceMicro( &voice );
+	}
+}
+
+static void getbKernel( void *param, unsigned iterations )
+{
+	VoiceParam &p = *static_cast< VoiceParam* >( param );
+	uint32_t sum = 0;
+	for ( unsigned i=0; i<iterations; ++i )
+	{
+		sum += sp0256_voiceGetBits( &p.voice, 8 - ( i & 7 ) );
+		if ( p.voice.pc >= p.end )
+			p.voice.pc = p.start;
+	}
+	sink = sum;
+}
+
+// .wav writer kernel
+struct WaveParam
+{
+	WaveWriter	writer;
+	int			shift;
+};
+
+static void waveKernel( void *param, unsigned iterations )
+{
+	WaveParam &p = *static_cast< WaveParam* >( param );
+	for ( unsigned i=0; i<iterations; ++i )
+	{
+		const int sample = int( sshort( i * 2531 ) );
+		p.writer.write( p.shift ? ( ( sample >> 8 ) + 0x80 ) & 0xFF : sample );
+	}
+}
+
+// Reverse the bits of a nibble: the immediate fields are stored reversed
+static uint8_t reverse4( uint8_t nibble )
+{
+	return uint8_t( ( nibble & 1 ) << 3 | ( nibble & 2 ) << 1 | ( nibble & 4 ) >> 1 | ( nibble & 8 ) >> 3 );
+}
+
+// Bit writer for the synthetic programs, LSB first
+class ProgramWriter
+{
+public:
+	ProgramWriter( uint8_t *program, size_t size )
+		: program_( program ), size_( size ), bits_( 0 )
+	{
+		memset( program_, 0, size_ );
+	}
+
+	void put( uint32_t value, int n )
+	{
+		for ( int i=0; i<n; ++i, ++bits_ )
+			if ( value >> i & 1 )
+				program_[bits_ >> 3] |= uint8_t( 1 << ( bits_ & 7 ) );
+	}
+
+	// instruction with zero data bits
+	void instruction( uint8_t immed4, uint8_t opcode, int dataBits )
+	{
+		put( immed4, 4 );
+		put( opcode, 4 );
+		bits_ += dataBits;
+	}
+
+	// JMP or JSR to a byte in the page
+	void jump( uint8_t opcode, uint32_t target )
+	{
+		put( reverse4( uint8_t( ( target >> 8 ) & 0xF ) ), 4 );
+		put( opcode, 4 );
+		uint32_t rev = 0;
+		for ( int i=0; i<8; ++i )
+			rev |= ( ( target >> i ) & 1 ) << ( 7 - i );
+		put( rev, 8 );
+	}
+
+	void align()
+	{
+		bits_ = ( bits_ + 7 ) & ~7;
+	}
+
+	size_t getBits() const
+	{
+		return bits_;
+	}
+
+	// room left for n bits and a final jump ?
+	bool hasRoom( size_t n ) const
+	{
+		return bits_ + n + 24 < size_ * 8;
+	}
+
+private:
+	uint8_t		*program_;
+	size_t		size_;
+	size_t		bits_;
+};
+
+// Start a voice on the program
+static void startProgram( VoiceParam &p )
+{
+	sp0256_voiceInit( &p.voice, p.program );
+	p.voice.halted = 0;
+	p.voice.pc = PROGRAM_PAGE;
+}
+
+// Number of data bits of a frame instruction, measured on the micro-sequencer
+static int getDataBits( VoiceParam &p, uint8_t opcode )
+{
+	ProgramWriter writer( p.program, sizeof( p.program ) );
+	writer.instruction( 1, opcode, 0 );
+	startProgram( p );
+	sp0256_voiceMicro( &p.voice );
+	return p.voice.pc - PROGRAM_PAGE - 8;
+}
+
+// Program looping on the frame instructions of a class
+static void frameProgram( VoiceParam &p, const uint8_t *opcodes, size_t n )
+{
+	int dataBits[16];
+	for ( size_t i=0; i<n; ++i )
+		dataBits[i] = getDataBits( p, opcodes[i] );
+
+	ProgramWriter writer( p.program, sizeof( p.program ) );
+	for ( size_t i=0; writer.hasRoom( 8 + dataBits[i % n] ); ++i )
+		writer.instruction( 1, opcodes[i % n], dataBits[i % n] );
+	writer.jump( 0xE, 0 );	// JMP start
+	startProgram( p );
+}
+
+// Program looping on control transfers: SETMODE, JSR to a PAUSE, RTS
+static void controlProgram( VoiceParam &p )
+{
+	const uint32_t sub = sizeof( p.program ) - 0x10;
+	const int dataBits = getDataBits( p, 0xF );
+
+	ProgramWriter writer( p.program, sizeof( p.program ) );
+	while ( writer.hasRoom( 0x20 * 8 + 32 ) )
+	{
+		writer.instruction( 0, 0x1, 0 );	// SETMODE 0
+		writer.jump( 0xD, sub );			// JSR sub
+		writer.align();
+	}
+	writer.jump( 0xE, 0 );					// JMP start
+
+	ProgramWriter subWriter( p.program + sub, 0x10 );
+	subWriter.instruction( 1, 0xF, dataBits );	// PAUSE
+	subWriter.instruction( 0, 0x0, 0 );			// RTS
+	startProgram( p );
+}
+
+// Filter state of a ROM entry, when the excitation is established
+static bool captureFilter( lpc12_t &filt, const char *label, bool voiced )
+{
+	int code = -1;
+	for ( unsigned i=0; i<sp0256_al2::nlabels; ++i )
+		if ( !strcmp( sp0256_al2::labels[i], label ) )
+			code = int( i );
+	if ( code < 0 )
+		return false;
+
+	ivoice_t voice;
+	sp0256_voiceInit( &voice, sp0256_al2::mask );
+	sp0256_voiceSendCommand( &voice, uint32_t( code ) );
+	for ( int i=0; i<10000; ++i )
+	{
+		sp0256_voiceGetNextSample( &voice );
+		if ( sp0256_voiceHalted( &voice ) )
+			break;
+		if ( !voice.silent && voice.filt.amp && ( voice.filt.per != 0 ) == voiced )
+		{
+			filt = voice.filt;
+			return true;
+		}
+	}
+	return false;
+}
+
+int MicroBenchmarks::run( Benchmark &bench, FILE *con )
+{
+	// filter
+	static FilterParam filter;
+	static const struct { const char *key, *label; bool voiced, interp; } filters[] =
+	{
+		{ "filter/voiced",			"AA", true,  false },
+		{ "filter/voiced_interp",	"AA", true,  true  },
+		{ "filter/noise",			"SH", false, false },
+		{ "filter/noise_interp",	"SH", false, true  },
+	};
+	for ( size_t i=0; i<sizeof( filters ) / sizeof( *filters ); ++i )
+	{
+		if ( !bench.isSelected( filters[i].key ) || !captureFilter( filter.filt, filters[i].label, filters[i].voiced ) )
+			continue;
+		filter.filt.interp = filters[i].interp;
+		filter.filt.r[14] = filter.filt.r[15] = 0;	// null deltas: stable interpolation
+		bench.measure( filters[i].key, filterKernel, &filter, 100000, con );
+	}
+
+	// micro-sequencer
+	static VoiceParam voice;
+	static const struct { const char *key; const uint8_t *opcodes; size_t n; } classes[] =
+	{
+		{ "micro/load",		loadOpcodes,	sizeof( loadOpcodes ) },
+		{ "micro/setmsb",	setmsbOpcodes,	sizeof( setmsbOpcodes ) },
+		{ "micro/delta",	deltaOpcodes,	sizeof( deltaOpcodes ) },
+		{ "micro/pause",	pauseOpcodes,	sizeof( pauseOpcodes ) },
+	};
+	for ( size_t i=0; i<sizeof( classes ) / sizeof( *classes ); ++i )
+	{
+		if ( !bench.isSelected( classes[i].key ) )
+			continue;
+		frameProgram( voice, classes[i].opcodes, classes[i].n );
+		bench.measure( classes[i].key, microKernel, &voice, 20000, con );
+	}
+	if ( bench.isSelected( "micro/control" ) )
+	{
+		controlProgram( voice );
+		bench.measure( "micro/control", microKernel, &voice, 20000, con );
+	}
+
+	// bit fetch
+	if ( bench.isSelected( "getb/rom" ) )
+	{
+		sp0256_voiceInit( &voice.voice, sp0256_al2::mask );
+		voice.start = voice.voice.pc = PROGRAM_PAGE;
+		voice.end = PROGRAM_PAGE + 0x7F0 * 8;
+		bench.measure( "getb/rom", getbKernel, &voice, 100000, con );
+	}
+	if ( bench.isSelected( "getb/fifo" ) )
+	{
+		sp0256_voiceInit( &voice.voice, sp0256_al2::mask );
+		voice.voice.fifo_sel = 1;
+		voice.voice.fifo_head = 0xFFFFFFFF;
+		for ( int i=0; i<64; ++i )
+			voice.voice.fifo[i] = uint16_t( ( i * 0x155 ) & 0x3FF );
+		voice.start = voice.end = 0x7FFFFFFF;	// the PC doesn't move
+		bench.measure( "getb/fifo", getbKernel, &voice, 100000, con );
+	}
+
+	// .wav writer
+	static const struct { const char *key; unsigned bits, tag; } formats[] =
+	{
+		{ "wave/pcm8",		8,	WAVE_TAG_PCM },
+		{ "wave/pcm16",		16,	WAVE_TAG_PCM },
+		{ "wave/float",		32,	WAVE_TAG_FLOAT },
+		{ "wave/ulaw",		8,	WAVE_TAG_ULAW },
+		{ "wave/adpcm",		4,	WAVE_TAG_IMA_ADPCM },
+	};
+	char tempPath[MAX_PATH], tempName[MAX_PATH];
+	if ( !GetTempPathA( MAX_PATH, tempPath ) || !GetTempFileNameA( tempPath, "spb", 0, tempName ) )
+		return EACCES;
+	int err = 0;
+	for ( size_t i=0; !err && i<sizeof( formats ) / sizeof( *formats ); ++i )
+	{
+		if ( !bench.isSelected( formats[i].key ) )
+			continue;
+		WaveParam wave;
+		wave.shift = formats[i].tag == WAVE_TAG_PCM && formats[i].bits == 8;
+		err = wave.writer.create( tempName, 10000, 10000, 1, formats[i].bits, formats[i].tag );
+		if ( !err )
+		{
+			bench.measure( formats[i].key, waveKernel, &wave, 1000000, con );
+			wave.writer.close();
+			err = wave.writer.getErrno();
+		}
+	}
+	DeleteFileA( tempName );
+
+	return err;
+}
@@ -0,0 +1,43 @@
+/*
+    SP0256A - Micro-Benchmarks.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Benchmark.h"
+
+// Micro-benchmarks of the synthesizer kernels:
+// - filter/...: LPC filter update, per sample, voiced or noise excitation,
+//   with or without interpolation;
+// - micro/...: micro-sequencer step, per frame, by opcode class, running a
+//   synthetic program of the class in a loop;
+// - getb/...: bit fetch from the ROM or from the FIFO, per fetch;
+// - wave/...: .wav writer, per sample, by sample format.
+
+class MicroBenchmarks
+{
+public:
+	// run the kernels selected by the filter; returns 0 or errno
+	static int run( Benchmark &bench, FILE *con );
+};
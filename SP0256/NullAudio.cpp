@@ -0,0 +1,130 @@
+/*
+    SP0256A - Null Audio Consumer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "NullAudio.h"
+
+#include <errno.h>
+
+bool NullAudio::open( AudioRing &ring, ulong freq )
+{
+	close();
+
+	if ( fileName_ )
+	{
+		errno_ = fopen_s( &file_, fileName_, "wb" );
+		if ( errno_ )
+			return false;
+	}
+
+	ring_ = &ring;
+	// 2 bytes per sample (stereo)
+	pacer_.setPeriod( LONGLONG( ring.getBlockSize() ) * 1000000000 / ( 2 * freq ) );
+	closing_ = 0;
+	pushed_ = CreateEvent( NULL, FALSE, FALSE, NULL );
+	thread_ = CreateThread( NULL, 0, threadProc, this, 0, NULL );
+
+	return thread_ != NULL;
+}
+
+void NullAudio::close()
+{
+	if ( thread_ )
+	{
+		InterlockedExchange( &closing_, 1 );
+		SetEvent( pushed_ );
+		WaitForSingleObject( thread_, INFINITE );
+		CloseHandle( thread_ );
+		CloseHandle( pushed_ );
+		thread_ = NULL;
+		pushed_ = NULL;
+	}
+
+	if ( file_ )
+	{
+		fclose( file_ );
+		file_ = 0;
+	}
+}
+
+DWORD WINAPI NullAudio::threadProc( void *param )
+{
+	static_cast< NullAudio* >( param )->run();
+	return 0;
+}
+
+void NullAudio::run()
+{
+	bool started = false, starved = false;
+
+	for ( ;; )
+	{
+		uchar *block = ring_->front();
+
+		// wait for the prebuffer before (re)starting the playback
+		if ( ( !started || starved ) && !closing_ && ring_->getFill() < AUDIO_PREBUFFER )
+			block = 0;
+
+		if ( !block )
+		{
+			if ( closing_ )
+				break;
+
+			DWORD timeout = INFINITE;
+
+			if ( started && !starved )
+			{
+				// end of the last played block
+				LONGLONG left = pacer_.getDeadline() - DeadlinePacer::now();
+				if ( left > 0 )
+				{
+					timeout = DWORD( ( left + 999999 ) / 1000000 );
+				}
+				else
+				{
+					// the next block is late
+					ring_->underrun();
+					starved = true;
+				}
+			}
+
+			WaitForSingleObject( pushed_, timeout );
+			continue;
+		}
+
+		// (re)start the playback clock
+		if ( !started || starved )
+			pacer_.restart();
+		started = true;
+		starved = false;
+
+		if ( file_ )
+			fwrite( block, 1, ring_->getBlockSize(), file_ );
+
+		// play the block
+		pacer_.wait( &sleeper_ );
+
+		ring_->release();
+	}
+}
@@ -0,0 +1,81 @@
+/*
+    SP0256A - Null Audio Consumer.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "AudioConsumer_I.h"
+#include "DeadlinePacer.h"
+#include "Win32Sleeper.h"
+
+#include <cstdio>
+
+// Headless audio consumer: plays the blocks in real time on a worker
+// thread, by waiting for their deadlines as the live pacer, and optionally writes them to
+// a raw PCM file (8-bit unsigned stereo)
+
+class NullAudio : public AudioConsumer_I
+{
+public:
+	NullAudio( const char *fileName = 0 )
+		: fileName_( fileName ), file_( 0 ), ring_( 0 ), thread_( NULL ), pushed_( NULL )
+		, closing_( 0 ), errno_( 0 )
+	{
+	}
+
+	~NullAudio()
+	{
+		close();
+	}
+
+	bool open( AudioRing &ring, ulong freq );
+
+	void push( uchar *block )
+	{
+		SetEvent( pushed_ );
+	}
+
+	void close();
+
+	// error number from the file creation
+	int getErrno() const
+	{
+		return errno_;
+	}
+
+private:
+	static DWORD WINAPI threadProc( void *param );
+
+	void run();
+
+	const char			*fileName_;
+	FILE				*file_;
+	AudioRing			*ring_;
+	HANDLE				thread_;
+	HANDLE				pushed_;		// auto-reset, set at each push
+	volatile LONG		closing_;
+	DeadlinePacer		pacer_;			// one period per block
+	Win32Sleeper		sleeper_;
+	int					errno_;
+};
@@ -0,0 +1,247 @@
+/*
+    SP0256A - PCM Sound Bank.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "SoundBank.h"
+
+#include <io.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+void SoundBankWriter::add( uint16_t rom, const uint8_t *mask, const char * const labels[], uint nlabels )
+{
+	Entry entry;
+	entry.rom = rom;
+	entry.mask = mask;
+	for ( uint i=0; i<nlabels; ++i )
+	{
+		entry.code = uint16_t( i );
+		entry.label = labels[i];
+		entries_.push_back( entry );
+	}
+}
+
+ulong SoundBankWriter::getSamples() const
+{
+	ulong samples = 0;
+	for ( size_t i=0; i<entries_.size(); ++i )
+		samples += ulong( entries_[i].samples.size() );
+	return samples;
+}
+
+DWORD WINAPI SoundBankWriter::workerProc( void *param )
+{
+	static_cast< SoundBankWriter* >( param )->work();
+	return 0;
+}
+
+void SoundBankWriter::work()
+{
+	for (;;)
+	{
+		const LONG index = InterlockedIncrement( &next_ ) - 1;
+		if ( index >= LONG( entries_.size() ) )
+			break;
+		render( entries_[index] );
+	}
+}
+
+void SoundBankWriter::render( Entry &entry )
+{
+	ivoice_t voice;
+	sp0256_voiceInit( &voice, entry.mask );
+
+	// one command, until halted
+	int16_t block[SP0256_RENDER_BLOCK];
+	bool sent = false;
+	while ( !sent || !sp0256_voiceHalted( &voice ) )
+	{
+		if ( !sent && sp0256_voiceGetStatus( &voice ) )
+		{
+			sp0256_voiceSendCommand( &voice, entry.code );
+			sent = true;
+		}
+		const int n = sp0256_voiceRender( &voice, block, SP0256_RENDER_BLOCK );
+		entry.samples.insert( entry.samples.end(), block, block + n );
+	}
+}
+
+int SoundBankWriter::write( const char *fileName )
+{
+	// render
+	next_ = 0;
+	std::vector< HANDLE > workers;
+	for ( uint i=0; i<threads_ && i<entries_.size(); ++i )
+		workers.push_back( CreateThread( NULL, 0, workerProc, this, 0, NULL ) );
+	for ( size_t i=0; i<workers.size(); ++i )
+	{
+		WaitForSingleObject( workers[i], INFINITE );
+		CloseHandle( workers[i] );
+	}
+
+	// layout
+	SoundBankHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, SOUND_BANK_MAGIC, 4 );
+	header.version = SOUND_BANK_VERSION;
+	header.entries = uint16_t( entries_.size() );
+	header.indexOffset = sizeof( SoundBankHeader );
+	header.dataOffset = uint32_t( header.indexOffset + entries_.size() * sizeof( SoundBankEntry ) );
+	header.bitsPerSample = 16;
+	header.channels = 1;
+
+	std::vector< SoundBankEntry > index( entries_.size() );
+	uint32_t offset = header.dataOffset;
+	for ( size_t i=0; i<entries_.size(); ++i )
+	{
+		SoundBankEntry &e = index[i];
+		memset( &e, 0, sizeof( e ) );
+		e.offset = offset;
+		e.length = uint32_t( entries_[i].samples.size() );
+		e.sampleRate = sampleRate_;
+		e.duration = uint32_t( e.length * 1000000.0 / sampleRate_ + 0.5 );
+		e.rom = entries_[i].rom;
+		e.code = entries_[i].code;
+		for ( uint n=0; n<SOUND_BANK_LABEL-1 && entries_[i].label[n]; ++n )
+			e.label[n] = entries_[i].label[n];
+		offset += ( e.length * 2 + SOUND_BANK_ALIGN - 1 ) & ~( SOUND_BANK_ALIGN - 1 );
+	}
+	header.dataSize = offset - header.dataOffset;
+
+	// write
+	FILE *file;
+	int err = fopen_s( &file, fileName, "wb" );
+	if ( err )
+		return err;
+
+	static const char pad[SOUND_BANK_ALIGN] = { 0 };
+	bool ok = fwrite( &header, sizeof( header ), 1, file ) == 1
+		&& ( index.empty() || fwrite( &index[0], sizeof( SoundBankEntry ), index.size(), file ) == index.size() );
+	for ( size_t i=0; ok && i<entries_.size(); ++i )
+	{
+		const uint32_t length = index[i].length;
+		ok = !length || fwrite( &entries_[i].samples[0], 2, length, file ) == length;
+		const size_t padding = ( SOUND_BANK_ALIGN - length * 2 % SOUND_BANK_ALIGN ) % SOUND_BANK_ALIGN;
+		if ( ok && padding )
+			ok = fwrite( pad, 1, padding, file ) == padding;
+	}
+	if ( !ok )
+		err = errno ? errno : EIO;
+	if ( fclose( file ) && !err )
+		err = errno;
+
+	return err;
+}
+
+int SoundBank::open( const char *fileName )
+{
+	close();
+
+	fd_ = _open( fileName, _O_RDONLY | _O_BINARY );
+	if ( fd_ < 0 )
+		return errno;
+
+	HANDLE file = HANDLE( _get_osfhandle( fd_ ) );
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( file, &size ) || ULONGLONG( size.QuadPart ) < sizeof( SoundBankHeader )
+		|| ULONGLONG( size.QuadPart ) > ULONGLONG( size_t( -1 ) ) )
+	{
+		close();
+		return EINVAL;
+	}
+
+	mapping_ = CreateFileMappingA( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if ( mapping_ )
+		view_ = static_cast< const char* >( MapViewOfFile( mapping_, FILE_MAP_READ, 0, 0, 0 ) );
+	if ( !view_ )
+	{
+		close();
+		return ENOMEM;
+	}
+
+	// validate the header and the index
+	const SoundBankHeader *header = reinterpret_cast< const SoundBankHeader* >( view_ );
+	const ULONGLONG fileSize = ULONGLONG( size.QuadPart );
+	bool valid = !memcmp( header->magic, SOUND_BANK_MAGIC, 4 ) && header->version == SOUND_BANK_VERSION
+		&& header->bitsPerSample == 16 && header->channels == 1
+		&& header->indexOffset + ULONGLONG( header->entries ) * sizeof( SoundBankEntry ) <= fileSize;
+	const SoundBankEntry *index = reinterpret_cast< const SoundBankEntry* >( view_ + header->indexOffset );
+	for ( uint i=0; valid && i<header->entries; ++i )
+		valid = index[i].offset % 2 == 0 && index[i].offset + ULONGLONG( index[i].length ) * 2 <= fileSize;
+	if ( !valid )
+	{
+		close();
+		return EINVAL;
+	}
+
+	header_ = header;
+	index_ = index;
+	return 0;
+}
+
+void SoundBank::close()
+{
+	if ( view_ )
+		UnmapViewOfFile( view_ );
+	if ( mapping_ )
+		CloseHandle( mapping_ );
+	if ( fd_ >= 0 )
+		_close( fd_ );
+
+	fd_ = -1;
+	mapping_ = NULL;
+	view_ = 0;
+	header_ = 0;
+	index_ = 0;
+}
+
+int SoundBank::find( uint16_t rom, uint16_t code ) const
+{
+	// the entries are sorted by ROM and code
+	uint lo = 0, hi = getEntries();
+	while ( lo < hi )
+	{
+		const uint mid = ( lo + hi ) / 2;
+		const SoundBankEntry &e = index_[mid];
+		if ( e.rom < rom || ( e.rom == rom && e.code < code ) )
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < getEntries() && index_[lo].rom == rom && index_[lo].code == code ? int( lo ) : -1;
+}
+
+void SoundBankPlayer::play( int code )
+{
+	const int index = bank_.find( rom_, uint16_t( code ) );
+	if ( hits_ )
+		( index < 0 ? misses_ : hits_ )->add();
+	if ( index < 0 )
+		return;
+	samples_ = bank_.getSamples( index );
+	length_ = bank_.getEntry( index ).length;
+	pos_ = 0;
+}
@@ -0,0 +1,203 @@
+/*
+    SP0256A - PCM Sound Bank.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "Metrics.h"
+#include "sp0256.h"
+
+#include <windows.h>
+
+#include <string>
+#include <vector>
+
+// PCM sound bank file: every allophone or word of the speech ROMs rendered
+// to 16-bit signed mono PCM, little-endian, packed after an index; it is
+// mapped in memory by the loader and the samples are used in place.
+#define SOUND_BANK_MAGIC	"SPBK"
+#define SOUND_BANK_VERSION	1
+#define SOUND_BANK_LABEL	32
+#define SOUND_BANK_ALIGN	4
+
+// Speech ROMs
+#define SOUND_BANK_ROM_AL2	0
+#define SOUND_BANK_ROM_012	1
+
+struct SoundBankHeader
+{
+	char			magic[4];
+	uint16_t		version;
+	uint16_t		entries;
+	uint32_t		indexOffset;		// file offset of the index
+	uint32_t		dataOffset;			// file offset of the samples
+	uint32_t		dataSize;
+	uint16_t		bitsPerSample;
+	uint16_t		channels;
+	uint32_t		reserved[2];
+};
+
+struct SoundBankEntry
+{
+	uint32_t		offset;				// file offset of the samples
+	uint32_t		length;				// number of samples
+	uint32_t		sampleRate;			// Hz
+	uint32_t		duration;			// us
+	uint16_t		rom;				// SOUND_BANK_ROM_xxx
+	uint16_t		code;				// command
+	char			label[SOUND_BANK_LABEL];
+	uint32_t		reserved[3];
+};
+
+// Renders the entries of the speech ROMs in parallel and writes the bank
+class SoundBankWriter
+{
+public:
+	SoundBankWriter( uint threads, uint32_t sampleRate )
+		: threads_( threads ), sampleRate_( sampleRate ), next_( 0 )
+	{
+	}
+
+	// add all the entries of a speech ROM
+	void add( uint16_t rom, const uint8_t *mask, const char * const labels[], uint nlabels );
+
+	// render the entries and write the bank; returns 0 or errno
+	int write( const char *fileName );
+
+	uint getEntries() const
+	{
+		return uint( entries_.size() );
+	}
+
+	ulong getSamples() const;
+
+private:
+	struct Entry
+	{
+		uint16_t				rom;
+		uint16_t				code;
+		const uint8_t			*mask;
+		const char				*label;
+		std::vector< sshort >	samples;
+	};
+
+	static DWORD WINAPI workerProc( void *param );
+
+	void work();
+
+	// render one command on an independent synthesizer
+	void render( Entry &entry );
+
+	uint					threads_;
+	uint32_t				sampleRate_;
+	std::vector< Entry >	entries_;
+	volatile LONG			next_;
+};
+
+// Sound bank mapped in memory, read-only
+class SoundBank
+{
+public:
+	SoundBank()
+		: fd_( -1 ), mapping_( NULL ), view_( 0 ), header_( 0 ), index_( 0 )
+	{
+	}
+
+	~SoundBank()
+	{
+		close();
+	}
+
+	// map a bank file; returns 0 or errno (EINVAL if not a valid bank)
+	int open( const char *fileName );
+
+	void close();
+
+	uint getEntries() const
+	{
+		return header_ ? header_->entries : 0;
+	}
+
+	const SoundBankEntry &getEntry( uint index ) const
+	{
+		return index_[index];
+	}
+
+	// samples of an entry, in the mapped view
+	const sshort *getSamples( uint index ) const
+	{
+		return reinterpret_cast< const sshort* >( view_ + index_[index].offset );
+	}
+
+	// index of a command of a ROM, or -1
+	int find( uint16_t rom, uint16_t code ) const;
+
+private:
+	int						fd_;
+	HANDLE					mapping_;
+	const char				*view_;
+	const SoundBankHeader	*header_;
+	const SoundBankEntry	*index_;
+};
+
+// Plays the bank entries in place of the synthesizer, command by command
+class SoundBankPlayer
+{
+public:
+	SoundBankPlayer( const SoundBank &bank, uint16_t rom )
+		: bank_( bank ), rom_( rom ), samples_( 0 ), length_( 0 ), pos_( 0 ), hits_( 0 ), misses_( 0 )
+	{
+	}
+
+	// count the commands found or not in the bank
+	void setMetrics( Metrics &metrics )
+	{
+		hits_ = &metrics.counter( "sp0256_bank_hits_total", "Commands played from the sound bank." );
+		misses_ = &metrics.counter( "sp0256_bank_misses_total", "Commands missing from the sound bank." );
+	}
+
+	// no entry playing ?
+	bool isIdle() const
+	{
+		return pos_ >= length_;
+	}
+
+	// start playing a command; unknown commands are skipped
+	void play( int code );
+
+	// next sample, 0 when idle
+	int getNextSample()
+	{
+		return pos_ < length_ ? samples_[pos_++] : 0;
+	}
+
+private:
+	const SoundBank			&bank_;
+	uint16_t				rom_;
+	const sshort			*samples_;
+	uint32_t				length_;
+	uint32_t				pos_;
+	Metrics::Counter		*hits_;
+	Metrics::Counter		*misses_;
+};
@@ -25,9 +25,6 @@
 
 #include "SystemClock.h"
 
-#include <time.h>
-
-#define _AUDIO_ENABLE_ 0
 static const long AUTO_TURBO_MIN = 0x1000;
 static const long AUTO_TURBO_MAX = 0x10000;
 
@@ -47,7 +44,6 @@ void SystemClock::resetAutoTurbo()
 void SystemClock::runCycles(long cycles)
 {
 	cycles *= cyclesMult_;
-	cycles_ += cycles;
 	autoCycles_ += cycles;
 
 	if ( clockSpeed_ && !turbo_ )
@@ -55,78 +51,47 @@ void SystemClock::runCycles(long cycles)
 		if ( autoTurbo_ && autoCycles_ > AUTO_TURBO_MAX )
 			turbo_ = true;
 
-		while( cycles_ > 0 )
-		{
-			// Wait 1/100 sec clock change
-			if ( clock100_ < 0 )
-			{	// 1st call: initialize
-				clock100_ = clock() / ( CLOCKS_PER_SEC / throttleFreq_ );
-#if _AUDIO_ENABLE_
-				cyclesAudio = 0;
-#endif
-				cycles_ = 0;
-			}
+		cycles_ += cycles;
 
-			long s = clock100_;
-			long timeout = 500L;
+		// wait once per period of cycles, until its deadline
+		while ( cycles_ >= periodCycles_ )
+		{
+			cycles_ -= periodCycles_;
 
-			while ( s == clock100_  )
+			if ( level_ && level_->getBufferedTime() < targetLevel_ )
 			{
-				s = clock() / ( CLOCKS_PER_SEC / throttleFreq_ );
-				if ( s == clock100_ )
-				{
-					sleep( 5 );
-					timeout -= 5;
-					if ( timeout < 0 )
-					{
-						clock100_ = s = -1;
-					}
-				}
+				// buffer below target: don't wait, and
+				// restart the deadlines when back on target
+				pacer_.restart();
+				++turboPeriods_;
 			}
-
-			// ds = elapsed hundredths of seconds
-			long ds = s - clock100_;
-			clock100_ = s;
-
-			while ( ds < 0 )
+			else
 			{
-				ds += 3600L*throttleFreq_; // Add 1 hour
+				pacer_.wait( sleeper_ );
 			}
 
-			if ( ds > 10L*throttleFreq_ )
+			// RTCINT counter
+			rtcTest_ += rtcRate_ * period_;
+			while ( rtcTest_ > 0 )
 			{
-				// avoid lockups after wake-up
-				clock100_ = -1;
-			}
-			else
-			{
-
-				cycles_ -= ds * 1000L * clockSpeed_ / throttleFreq_;
-#if _AUDIO_ENABLE_
-				cyclesAudio += ds * 1000L * clockspeed * ( AudioFreq/1000 ) / ThrottleFreq;
-#endif
-				// RTCINT counter
-				rtcTest_ += ds * rtcRate_;
-
-				// Update wave output
-#if _AUDIO_ENABLE_
-				outWaveUpdate();
-#endif
-				if ( rtcTest_ > 0 )
-				{
-					trigIrq();
-					rtcTest_ -= throttleFreq_;
-					//cprintf("<INT RT>");
-				}
+				trigIrq();
+				rtcTest_ -= 1000000L;
 			}
 		}
-#if _AUDIO_ENABLE_
-		outWaveUpdate();
-#endif
 	}
 	else
 	{
-		clock100_ = -1;
+		pacer_.restart();
 		cycles_ = 0;
 	}
 }
+
+void SystemClock::updatePeriodCycles()
+{
+	// clock speed in kHz, period in us
+	periodCycles_ = LONGLONG( clockSpeed_ ) * period_ / 1000;
+	if ( periodCycles_ < 1 )
+		periodCycles_ = 1;
+	pacer_.setPeriod( LONGLONG( period_ ) * 1000 );
+	cycles_ = 0;
+}
@@ -27,6 +27,8 @@
 
 #include "Clock_I.h"
 
+#include "DeadlinePacer.h"
+#include "BufferLevel_I.h"
 #include "Sleeper_I.h"
 #include "IRQ_I.h"
 #include "types.h"
@@ -36,9 +38,10 @@ class SystemClock :
 {
 public:
 	SystemClock(void) :
-		clockSpeed_( 0 ), clock100_( -1L ), rtcRate_( 30 ), rtcTest_( 0 ),
-		throttleFreq_( 100 ), cycles_( 0 ), sleeper_( 0 ), irq_( 0 ), cyclesMult_( 1 ),
-		autoCycles_( 0 ), autoTurbo_( false ), turbo_( false )
+		clockSpeed_( 0 ), period_( 10000 ), periodCycles_( 1 ), rtcRate_( 30 ), rtcTest_( 0 ),
+		cycles_( 0 ), sleeper_( 0 ), irq_( 0 ), cyclesMult_( 1 ),
+		autoCycles_( 0 ), autoTurbo_( false ), turbo_( false ),
+		level_( 0 ), targetLevel_( 0 ), turboPeriods_( 0 )
 	{
 	}
 
@@ -59,7 +62,20 @@ public:
 	virtual void setClockSpeed( long speed )
 	{
 		clockSpeed_ = speed;
-		cycles_ = 0;
+		updatePeriodCycles();
+	}
+
+	// Set pacing period (us)
+	void setPeriod( long period )
+	{
+		period_ = period;
+		updatePeriodCycles();
+	}
+
+	// Get the pacer, for its statistics
+	const DeadlinePacer &getPacer() const
+	{
+		return pacer_;
 	}
 
 	// Set RTC rate (Hz)
@@ -77,6 +93,19 @@ public:
 	// Reset auto turbo cycles counter
 	void resetAutoTurbo();
 
+	// Set adaptive turbo: run unthrottled while the buffer level is below target (us)
+	void setBufferLevel( BufferLevel_I *level, long target )
+	{
+		level_ = level;
+		targetLevel_ = target;
+	}
+
+	// Get the number of pacing periods run unthrottled by the adaptive turbo
+	ulong getTurboPeriods() const
+	{
+		return turboPeriods_;
+	}
+
 	// Set sleeper
 	void setSleeper( Sleeper_I *sleeper )
 	{
@@ -103,16 +132,22 @@ public:
 
 
 protected:
+	void updatePeriodCycles();
+
 	long			clockSpeed_;		// Clock speed in kHz
-	long			clock100_;			// Clock as n/100 sec from midnight
+	long			period_;			// Pacing period in us
+	LONGLONG		periodCycles_;		// cycles per pacing period
+	DeadlinePacer	pacer_;				// pacing period deadlines
 	long			rtcRate_;			// RTC rate in Hz
 	long			rtcTest_;			//
-	long			throttleFreq_;		//
-	long			cycles_;			// cycles to consume
+	LONGLONG		cycles_;			// cycles to consume
 	long			cyclesMult_;		// cycles multiplier
 	long			autoCycles_;		// auto cycles counter
 	bool			autoTurbo_;			// enable auto turbo
 	bool			turbo_;				// turbo is active
 	Sleeper_I		*sleeper_;			// sleep( millis )
 	IRQ_I			*irq_;				// IRQ handler
+	BufferLevel_I	*level_;			// adaptive turbo buffer level
+	long			targetLevel_;		// adaptive turbo target level in us
+	ulong			turboPeriods_;		// periods run by the adaptive turbo
 };
@@ -0,0 +1,181 @@
+/*
+    SP0256A - Wave Encoders.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "WaveEncoders.h"
+
+// G.711 segment ends
+static const short uSegEnd[8] = { 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF, 0x1FFF };
+static const short aSegEnd[8] = { 0x1F, 0x3F, 0x7F, 0xFF, 0x1FF, 0x3FF, 0x7FF, 0xFFF };
+
+static int segment( int value, const short *segEnd )
+{
+	int seg = 0;
+	while ( seg < 8 && value > segEnd[seg] )
+		++seg;
+	return seg;
+}
+
+// mu-law code of a 14-bit sample
+static uchar uLaw( int pcm )
+{
+	int mask = 0xFF;
+	if ( pcm < 0 )
+	{
+		pcm = -pcm;
+		mask = 0x7F;
+	}
+	if ( pcm > 8159 )
+		pcm = 8159;
+	pcm += 0x84 >> 2;
+	const int seg = segment( pcm, uSegEnd );
+	if ( seg >= 8 )
+		return uchar( 0x7F ^ mask );
+	return uchar( ( seg << 4 | ( ( pcm >> ( seg + 1 ) ) & 0x0F ) ) ^ mask );
+}
+
+// A-law code of a 13-bit sample
+static uchar aLaw( int pcm )
+{
+	int mask = 0xD5;
+	if ( pcm < 0 )
+	{
+		pcm = -pcm - 1;
+		mask = 0x55;
+	}
+	const int seg = segment( pcm, aSegEnd );
+	if ( seg >= 8 )
+		return uchar( 0x7F ^ mask );
+	return uchar( ( seg << 4 | ( ( pcm >> ( seg < 2 ? 1 : seg ) ) & 0x0F ) ) ^ mask );
+}
+
+// Code tables indexed by the significant sample bits, built at start-up
+static struct G711Tables
+{
+	G711Tables()
+	{
+		for ( int i=0; i<0x4000; ++i )
+			ulaw[i] = uLaw( sshort( i << 2 ) >> 2 );
+		for ( int i=0; i<0x2000; ++i )
+			alaw[i] = aLaw( sshort( i << 3 ) >> 3 );
+	}
+
+	uchar ulaw[0x4000];
+	uchar alaw[0x2000];
+} g711;
+
+void encodeULaw( const sshort *in, uchar *out, size_t n )
+{
+	for ( size_t i=0; i<n; ++i )
+		out[i] = g711.ulaw[ushort( in[i] ) >> 2];
+}
+
+void encodeALaw( const sshort *in, uchar *out, size_t n )
+{
+	for ( size_t i=0; i<n; ++i )
+		out[i] = g711.alaw[ushort( in[i] ) >> 3];
+}
+
+// IMA-ADPCM tables
+static const int imaIndex[16] =
+{
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int imaStep[89] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+void ImaAdpcmEncoder::encodeBlock( const sshort *in, uchar *out, size_t blockAlign )
+{
+	// header: first sample as predictor, step index
+	int predictor = in[0];
+	out[0] = uchar( predictor & 0xFF );
+	out[1] = uchar( ( predictor >> 8 ) & 0xFF );
+	out[2] = uchar( index_ );
+	out[3] = 0;
+
+	const size_t n = getSamplesPerBlock( blockAlign ) - 1;
+	for ( size_t i=0; i<n; ++i )
+	{
+		int diff = in[i+1] - predictor;
+		int code = 0;
+		if ( diff < 0 )
+		{
+			code = 8;
+			diff = -diff;
+		}
+
+		int step = imaStep[index_];
+		int vpdiff = step >> 3;
+		if ( diff >= step )
+		{
+			code |= 4;
+			diff -= step;
+			vpdiff += step;
+		}
+		step >>= 1;
+		if ( diff >= step )
+		{
+			code |= 2;
+			diff -= step;
+			vpdiff += step;
+		}
+		step >>= 1;
+		if ( diff >= step )
+		{
+			code |= 1;
+			vpdiff += step;
+		}
+
+		predictor += code & 8 ? -vpdiff : vpdiff;
+		if ( predictor > 32767 )
+			predictor = 32767;
+		else if ( predictor < -32768 )
+			predictor = -32768;
+
+		index_ += imaIndex[code];
+		if ( index_ < 0 )
+			index_ = 0;
+		else if ( index_ > 88 )
+			index_ = 88;
+
+		// low nibble first
+		uchar &byte = out[4 + ( i >> 1 )];
+		if ( i & 1 )
+			byte |= uchar( code << 4 );
+		else
+			byte = uchar( code );
+	}
+}
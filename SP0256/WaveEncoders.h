@@ -0,0 +1,55 @@
+/*
+    SP0256A - Wave Encoders.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "types.h"
+
+#include <cstddef>
+
+// G.711 mu-law and A-law block encoders: 16-bit signed samples to 8-bit codes
+void encodeULaw( const sshort *in, uchar *out, size_t n );
+void encodeALaw( const sshort *in, uchar *out, size_t n );
+
+// IMA-ADPCM block encoder (mono, WAV layout: 4-byte header + 4-bit codes)
+class ImaAdpcmEncoder
+{
+public:
+	ImaAdpcmEncoder() : index_( 0 )
+	{
+	}
+
+	// Number of samples per block of blockAlign bytes
+	static size_t getSamplesPerBlock( size_t blockAlign )
+	{
+		return ( blockAlign - 4 ) * 2 + 1;
+	}
+
+	// Encode one block of getSamplesPerBlock( blockAlign ) samples
+	void encodeBlock( const sshort *in, uchar *out, size_t blockAlign );
+
+private:
+	int index_;
+};
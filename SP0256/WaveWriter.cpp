@@ -28,88 +28,176 @@
 #include "types.h"
 
 #include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <io.h>
+#include <fcntl.h>
 
 
-static int fput32( int n, FILE *out )
-{
-	int i;
-	for ( i=0; i<4; ++i ) {
-		fputc( n & 0xFF, out );
-		n >>= 8;
-	}
-	return n;
-}
-
-static int fput16( int n, FILE *out )
-{
-	int i;
-	for ( i=0; i<2; ++i ) {
-		fputc( n & 0xFF, out );
-		n >>= 8;
-	}
-	return n;
-}
-
-static int fput8( int n, FILE *out )
-{
-	fputc( n & 0xFF, out );
-	return n;
-}
-
 WaveWriter::WaveWriter( const char *filename, const unsigned waveFreq, const unsigned sampFreq, const unsigned nChannels, const unsigned nBitsPerSample )
-: waveFreq_( waveFreq ), sampFreq_( sampFreq ), nChannels_( nChannels ), nBitsPerSample_( nBitsPerSample )
+: file_( 0 ), lastSamples_( 0 ), buffer_( 0 ), block_( 0 ), errno_( 0 )
 {
 	create( filename, waveFreq, sampFreq, nChannels, nBitsPerSample );
 }
 
-int WaveWriter::create( const char *filename, const unsigned waveFreq, const unsigned sampFreq, const unsigned nChannels, const unsigned nBitsPerSample )
+int WaveWriter::create( const char *filename, const unsigned waveFreq, const unsigned sampFreq, const unsigned nChannels, const unsigned nBitsPerSample,
+	const unsigned formatTag, const bool raw )
 {
-	this->errno_ = fopen_s( &file_, filename, "wb" );
-	if ( this->errno_ )
-		return this->errno_;
+	close();
+
+	if ( formatTag == WAVE_TAG_IMA_ADPCM && nChannels != 1 )
+		return this->errno_ = EINVAL;
+
+	if ( !strcmp( filename, "-" ) )
+	{
+		// binary stdout, for pipelines
+		fflush( stdout );
+		_setmode( _fileno( stdout ), _O_BINARY );
+		file_ = stdout;
+		this->errno_ = 0;
+	}
+	else
+	{
+		this->errno_ = fopen_s( &file_, filename, "wb" );
+		if ( this->errno_ )
+			return this->errno_;
+	}
 
 	waveFreq_ = waveFreq;
 	sampFreq_ = sampFreq;
 	nChannels_ = nChannels;
 	nBitsPerSample_ = nBitsPerSample;
+	formatTag_ = formatTag;
+	raw_ = raw;
 	dataSize_ = 0;
 	lastSamples_ = new int[nChannels];
 	for ( size_t i=0; i<nChannels; ++i )
 		lastSamples_[i] = 0;
 	lastcnt_ = cnt_ = 0;
+	buffer_ = new unsigned char[WAVE_BUFFER_SIZE];
+	fill_ = 0;
+	samples_ = 0;
+
+	// compressed formats are encoded by blocks
+	blockAlign_ = nChannels * nBitsPerSample / 8;
+	blockSamples_ = 0;
+	if ( formatTag == WAVE_TAG_ULAW || formatTag == WAVE_TAG_ALAW )
+	{
+		blockSamples_ = WAVE_G711_BLOCK * nChannels;
+	}
+	else if ( formatTag == WAVE_TAG_IMA_ADPCM )
+	{
+		blockAlign_ = 256 * ( waveFreq <= 11025 ? 1 : waveFreq <= 22050 ? 2 : 4 );
+		blockSamples_ = ImaAdpcmEncoder::getSamplesPerBlock( blockAlign_ );
+		adpcm_ = ImaAdpcmEncoder();
+	}
+	if ( blockSamples_ )
+		block_ = new sshort[blockSamples_];
+	blockFill_ = 0;
+
+	// -1 if not seekable (pipe)
+	fileOffset_ = ftell( file_ );
+
+	if ( raw_ )
+		return 0;
+
+	// non-PCM formats need the cbSize field and the "fact" chunk;
+	// IMA-ADPCM adds the number of samples per block
+	const bool pcm = formatTag == WAVE_TAG_PCM;
+	const unsigned fmtSize = pcm ? 16 : formatTag == WAVE_TAG_IMA_ADPCM ? 20 : 18;
+	const unsigned headerLen = 20 + fmtSize + ( pcm ? 0 : 12 ) + 8;
+	// lengths unknown when streaming, announce the maximum
+	const unsigned long riffLen = isStream() ? WAVE_STREAM_LENGTH : headerLen - 8;
+	const unsigned long dataLen = isStream() ? WAVE_STREAM_LENGTH - ( headerLen - 8 ) : 0;
 
 	// RIFF Header
-	fputs( "RIFF", file_ );
-	riffLenOffset_ = ftell( file_ );
-	fput32( 36, file_ );
-	fputs( "WAVE", file_ );
+	put( 'R' | 'I' << 8 | 'F' << 16 | (unsigned long)'F' << 24, 4 );
+	riffLenOffset_ = long( fill_ );
+	put( riffLen, 4 );
+	put( 'W' | 'A' << 8 | 'V' << 16 | (unsigned long)'E' << 24, 4 );
 
 	// Subchunk "fmt "
-	fputs( "fmt ", file_ ); // Subchunk1ID
-	fput32( 16, file_ ); // Subchunk1size
-	fput16( 1, file_ ); // AudioFormat
-	fput16( nChannels, file_ ); // NumChannels
-	fput32( waveFreq, file_ ); // SampleRate
-	fput32( waveFreq * nChannels * nBitsPerSample / 8, file_ ); // ByteRate
-	fput16( nChannels * nBitsPerSample / 8, file_ ); // BlockAlign
-	fput16( nBitsPerSample, file_ ); // BitsPerSample
+	put( 'f' | 'm' << 8 | 't' << 16 | (unsigned long)' ' << 24, 4 ); // Subchunk1ID
+	put( fmtSize, 4 ); // Subchunk1size
+	put( formatTag, 2 ); // AudioFormat
+	put( nChannels, 2 ); // NumChannels
+	put( waveFreq, 4 ); // SampleRate
+	put( formatTag == WAVE_TAG_IMA_ADPCM
+		? ulong( double( waveFreq ) * blockAlign_ / blockSamples_ + 0.5 )
+		: waveFreq * ulong( blockAlign_ ), 4 ); // ByteRate
+	put( ulong( blockAlign_ ), 2 ); // BlockAlign
+	put( nBitsPerSample, 2 ); // BitsPerSample
+	if ( formatTag == WAVE_TAG_IMA_ADPCM )
+	{
+		put( 2, 2 ); // cbSize
+		put( ulong( blockSamples_ ), 2 ); // SamplesPerBlock
+	}
+	else if ( !pcm )
+	{
+		put( 0, 2 ); // cbSize
+	}
+
+	// Subchunk "fact"
+	factLenOffset_ = -1;
+	if ( !pcm )
+	{
+		put( 'f' | 'a' << 8 | 'c' << 16 | (unsigned long)'t' << 24, 4 );
+		put( 4, 4 );
+		factLenOffset_ = long( fill_ );
+		put( isStream() ? WAVE_STREAM_LENGTH : 0, 4 ); // SampleLength
+	}
 
 	// Subchunk "data"
-	fputs( "data", file_ ); // Subchunk2ID
-	dataLenOffset_ = ftell( file_ );
-	fput32( 0, file_ ); // Subchunk2size
+	put( 'd' | 'a' << 8 | 't' << 16 | (unsigned long)'a' << 24, 4 ); // Subchunk2ID
+	dataLenOffset_ = long( fill_ );
+	put( dataLen, 4 ); // Subchunk2size
 	return 0;
 }
 
+void WaveWriter::put( unsigned long value, unsigned n )
+{
+	while ( n-- )
+	{
+		buffer_[fill_++] = uchar( value & 0xFF );
+		value >>= 8;
+	}
+	if ( fill_ > WAVE_BUFFER_SIZE - 4 )
+		flushBuffer();
+}
+
+void WaveWriter::flushBuffer()
+{
+	if ( fill_ && fwrite( buffer_, 1, fill_, file_ ) != fill_ && !this->errno_ )
+		this->errno_ = errno ? errno : EIO;
+	fill_ = 0;
+}
+
 void WaveWriter::close()
 {
 	if ( file_ )
 	{
-		fseek( file_, riffLenOffset_, SEEK_SET );
-		fput32( dataSize_ + 36, file_ );
-		fseek( file_, dataLenOffset_, SEEK_SET );
-		fput32( dataSize_, file_ );
-		fclose( file_ );
+		if ( blockFill_ )
+			encodeBlock();
+		flushBuffer();
+		// patch the lengths if the output can seek back
+		if ( !raw_ && fileOffset_ >= 0 && !fseek( file_, fileOffset_ + riffLenOffset_, SEEK_SET ) )
+		{
+			put( dataSize_ + dataLenOffset_ - riffLenOffset_, 4 );
+			flushBuffer();
+			fseek( file_, fileOffset_ + dataLenOffset_, SEEK_SET );
+			put( dataSize_, 4 );
+			flushBuffer();
+			if ( factLenOffset_ >= 0 )
+			{
+				fseek( file_, fileOffset_ + factLenOffset_, SEEK_SET );
+				put( samples_ / nChannels_, 4 );
+				flushBuffer();
+			}
+		}
+		if ( isStream() )
+			fflush( file_ );
+		else
+			fclose( file_ );
 		file_ = 0;
 	}
 	if ( lastSamples_ )
@@ -117,6 +205,47 @@ void WaveWriter::close()
 		delete[] lastSamples_;
 		lastSamples_ = 0;
 	}
+	if ( buffer_ )
+	{
+		delete[] buffer_;
+		buffer_ = 0;
+	}
+	if ( block_ )
+	{
+		delete[] block_;
+		block_ = 0;
+	}
+}
+
+void WaveWriter::encodeBlock()
+{
+	if ( fill_ + blockSamples_ > WAVE_BUFFER_SIZE )
+		flushBuffer();
+
+	size_t size = blockFill_;
+	if ( formatTag_ == WAVE_TAG_IMA_ADPCM )
+	{
+		// pad the last block with its last sample
+		while ( blockFill_ < blockSamples_ )
+		{
+			block_[blockFill_] = block_[blockFill_ - 1];
+			++blockFill_;
+		}
+		adpcm_.encodeBlock( block_, buffer_ + fill_, blockAlign_ );
+		size = blockAlign_;
+	}
+	else if ( formatTag_ == WAVE_TAG_ULAW )
+	{
+		encodeULaw( block_, buffer_ + fill_, size );
+	}
+	else
+	{
+		encodeALaw( block_, buffer_ + fill_, size );
+	}
+
+	fill_ += size;
+	dataSize_ += long( size );
+	blockFill_ = 0;
 }
 
 void WaveWriter::write( size_t nChans, int *samples )
@@ -134,21 +263,36 @@ void WaveWriter::write( size_t nChans, int *samples )
 				int delta = lastSamples_[i] - samples[nSample];
 				int sample = samples[nSample] + ( delta * long( cnt_ ) ) / inc;
 
-			switch ( nBitsPerSample_ )
+			if ( formatTag_ == WAVE_TAG_FLOAT )
+			{
+				float value = sample / 32768.0f;
+				unsigned int bits = 0;
+				memcpy( &bits, &value, 4 );
+				put( bits, 4 );
+				dataSize_ += 4;
+			}
+			else if ( block_ )
+			{
+				block_[blockFill_] = sshort( sample );
+				if ( ++blockFill_ == blockSamples_ )
+					encodeBlock();
+			}
+			else switch ( nBitsPerSample_ )
 			{
 			case 8:
-					fput8( sample, file_ );
+					put( sample, 1 );
 				++dataSize_;
 				break;
 			case 16:
-					fput16( sample, file_ );
+					put( sample, 2 );
 				dataSize_ += 2;
 				break;
 			case 32:
-					fput32( sample, file_ );
+					put( sample, 4 );
 				dataSize_ += 4;
 				break;
 			}
+			++samples_;
 			if ( ++nSample == nChans )
 				nSample = 0;
 		}
@@ -25,13 +25,33 @@
 
 #pragma once
 
+#include "WaveEncoders.h"
+
 #include <cstdio>
 
-// .WAV file writer
+// Wave format tags
+#define WAVE_TAG_PCM		1
+#define WAVE_TAG_FLOAT		3
+#define WAVE_TAG_ALAW		6
+#define WAVE_TAG_ULAW		7
+#define WAVE_TAG_IMA_ADPCM	0x11
+
+// Samples per G.711 encoder block
+#define WAVE_G711_BLOCK		1024
+
+// Output buffer size
+#define WAVE_BUFFER_SIZE	0x10000
+
+// Maximal chunk length, for streams whose length is unknown
+#define WAVE_STREAM_LENGTH	0xFFFFFFFF
+
+// .WAV file or raw PCM writer.
+// Writes to stdout when the file name is "-", for pipelines: the WAV header
+// then announces maximal lengths, patched at close if stdout can seek.
 class WaveWriter
 {
 public:
-	WaveWriter() : file_( 0 ), lastSamples_( 0 ), errno_( 0 )
+	WaveWriter() : file_( 0 ), lastSamples_( 0 ), buffer_( 0 ), block_( 0 ), errno_( 0 )
 	{
 	}
 
@@ -43,8 +63,12 @@ public:
 		close();
 	}
 
-	// Create a wave file
-	int create( const char *filename, const unsigned waveFreq, const unsigned sampFreq, const unsigned nChannels, const unsigned nBitsPerSample );
+	// Create a wave file, or a headerless raw PCM file if raw is true.
+	// Samples are unsigned for 8-bit PCM, signed otherwise; for the float,
+	// G.711 and IMA-ADPCM tags they are signed 16-bit values to encode
+	// (nBitsPerSample 32, 8 and 4 resp.). IMA-ADPCM is mono only.
+	int create( const char *filename, const unsigned waveFreq, const unsigned sampFreq, const unsigned nChannels, const unsigned nBitsPerSample,
+		const unsigned formatTag = WAVE_TAG_PCM, const bool raw = false );
 
 	// Get the system errno of the last disk i/o
 	int getErrno() const
@@ -52,6 +76,12 @@ public:
 		return this->errno_;
 	}
 
+	// Writing to stdout ?
+	bool isStream() const
+	{
+		return file_ == stdout;
+	}
+
 	// Write a number of samples
 	void write( size_t nChans, int* samples );
 
@@ -72,14 +102,33 @@ public:
 	void close();
 
 private:
+	// Append n bytes of value to the output buffer, little-endian
+	void put( unsigned long value, unsigned n );
+
+	// Write the output buffer
+	void flushBuffer();
+
+	// Encode the pending samples of a compressed format
+	void encodeBlock();
+
 	FILE *file_;
 	int errno_;
 	unsigned waveFreq_;
 	unsigned sampFreq_;
 	unsigned nChannels_;
 	unsigned nBitsPerSample_;
+	unsigned formatTag_;
+	bool raw_;
+	long fileOffset_;
 	long riffLenOffset_, dataLenOffset_;
 	long dataSize_;
 	int *lastSamples_;
 	unsigned long cnt_, lastcnt_;
+	unsigned char *buffer_;
+	size_t fill_;
+	sshort *block_;
+	size_t blockFill_, blockSamples_, blockAlign_;
+	ImaAdpcmEncoder adpcm_;
+	long factLenOffset_;
+	unsigned long samples_;
 };
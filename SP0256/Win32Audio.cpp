@@ -24,25 +24,9 @@
 */
 
 #include "stdafx.h"
-#include "windows.h"
-#include "mmsystem.h"
 
 #include "Win32Audio.h"
 
-#include <deque>
-
-
-static bool WaveDeviceInitialized = false;
-static int WaveBuffersQueued = 0;
-static long WaveBuffersCounter = 0;
-
-static HWAVEOUT		hWaveOut;
-static WAVEFORMATEX	waveform;
-
-std::deque< PWAVEHDR > WaveHdrsToDelete;
-
-static CRITICAL_SECTION* pCriticalSection = NULL;
-
 
 // ============================================================================
 // get MM Result Message
@@ -90,125 +74,106 @@ MMRESULT MMErrorBox( MMRESULT errCode, char* context = NULL )
 	return errCode;
 }
 
-void CALLBACK waveOutProc(HWAVEOUT waveOut, UINT uMsg, DWORD dwInstance, DWORD dwParam1, DWORD dwParam2)
+void CALLBACK Win32Audio::waveOutProc( HWAVEOUT waveOut, UINT uMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2 )
 {
 	/* Has a buffer finished playing? */
 	if ( uMsg == MM_WOM_DONE )
 	{
-#pragma warning(suppress:4312)
-		PWAVEHDR pWaveHdr = (PWAVEHDR)dwParam1;
+		// only SetEvent() and the like may be called from here
+		Win32Audio *audio = reinterpret_cast< Win32Audio* >( dwInstance );
 
-		EnterCriticalSection( pCriticalSection );
-		WaveHdrsToDelete.push_back( pWaveHdr );
-		LeaveCriticalSection( pCriticalSection );
+		audio->ring_->release();
 
-		--WaveBuffersQueued;
-		++WaveBuffersCounter;
+		if ( !audio->ring_->getFill() && !audio->closing_ )
+			audio->ring_->underrun();
 	}
 }
 
-CFUNC void cleanWaveBufferQueue()
+void Win32Audio::push( uchar *block )
 {
-	PWAVEHDR pWaveHdr;
-
-	EnterCriticalSection( pCriticalSection );
-
-	while ( !WaveHdrsToDelete.empty() )
+	if ( hWaveOut_ )
 	{
-		pWaveHdr = WaveHdrsToDelete.front();
-		WaveHdrsToDelete.pop_front();
-		MMErrorBox( waveOutUnprepareHeader( hWaveOut, pWaveHdr, sizeof( WAVEHDR ) ), "cleanWaveBufferQueue/waveOutUnprepareHeader" );
-		delete pWaveHdr;
-	}
+		// the block is already committed: wait for the prebuffer
+		uint fill = ring_->getFill();
 
-	LeaveCriticalSection( pCriticalSection );
-}
-
-CFUNC void queueWaveBuffer( unsigned char* Buffer, unsigned long BufSize )
-{
-	PWAVEHDR pWaveHdr = new WAVEHDR;
-
-	cleanWaveBufferQueue();
+		if ( fill == 1 )
+			MMErrorBox( waveOutPause( hWaveOut_ ), "Win32Audio::push/waveOutPause" );
+		else if ( fill == AUDIO_PREBUFFER )
+			MMErrorBox( waveOutRestart( hWaveOut_ ), "Win32Audio::push/waveOutRestart" );
 
-	if ( WaveDeviceInitialized )
+		MMErrorBox( waveOutWrite( hWaveOut_, &headers_[ ring_->getIndex( block ) ], sizeof( WAVEHDR ) ), "Win32Audio::push/waveOutWrite" );
+	}
+	else
 	{
-
-		if ( WaveBuffersQueued == 0 )
-			MMErrorBox( waveOutPause( hWaveOut ), "queueWaveBuffer/waveOutPause" );
-		else if ( WaveBuffersQueued == 1 )
-			MMErrorBox( waveOutRestart( hWaveOut ), "queueWaveBuffer/waveOutRestart" );
-
-		ZeroMemory( pWaveHdr, sizeof( WAVEHDR ) );
-
-		pWaveHdr->lpData = (LPSTR)Buffer;
-		pWaveHdr->dwBufferLength = BufSize;
-
-		MMErrorBox( waveOutPrepareHeader( hWaveOut, pWaveHdr, sizeof( WAVEHDR ) ), "queueWaveBuffer/waveOutPrepareHeader" );
-
-		MMErrorBox( waveOutWrite( hWaveOut, pWaveHdr, sizeof( WAVEHDR ) ), "queueWaveBuffer/waveOutWrite"  );
-
-		++WaveBuffersQueued;
+		// no device: drop the block
+		ring_->release();
 	}
 }
 
-CFUNC void closeWaveOutDevice()
+void Win32Audio::close()
 {
 	MMRESULT res;
 
-	if ( WaveDeviceInitialized )
+	if ( hWaveOut_ )
 	{
-		if ( WaveBuffersQueued == 1 )
-			MMErrorBox( waveOutRestart( hWaveOut ), "queueWaveBuffer/waveOutRestart" );
+		InterlockedExchange( &closing_, 1 );
 
-		while ( WaveBuffersQueued )
-			Sleep( 1 );
+		if ( ring_->getFill() < AUDIO_PREBUFFER )
+			MMErrorBox( waveOutRestart( hWaveOut_ ), "Win32Audio::close/waveOutRestart" );
 
-		MMErrorBox( waveOutReset( hWaveOut ), "closeWaveOutDevice/waveOutReset" );
+		ring_->drain();
 
-		cleanWaveBufferQueue();
+		MMErrorBox( waveOutReset( hWaveOut_ ), "Win32Audio::close/waveOutReset" );
 
-		while ( ( res = waveOutClose( hWaveOut ) ) == WAVERR_STILLPLAYING )
+		for ( uint i = 0; i < ring_->getBlocks(); ++i )
+			MMErrorBox( waveOutUnprepareHeader( hWaveOut_, &headers_[i], sizeof( WAVEHDR ) ), "Win32Audio::close/waveOutUnprepareHeader" );
+
+		while ( ( res = waveOutClose( hWaveOut_ ) ) == WAVERR_STILLPLAYING )
 			Sleep( 1 );
 
-		MMErrorBox( res, "closeWaveOutDevice/waveOutClose" );
+		MMErrorBox( res, "Win32Audio::close/waveOutClose" );
 
-		WaveDeviceInitialized = false;
+		hWaveOut_ = 0;
 	}
+
+	delete[] headers_;
+	headers_ = 0;
 }
 
-CFUNC void initWaveOutDevice( unsigned long WaveFreq )
+bool Win32Audio::open( AudioRing &ring, ulong freq )
 {
-	if ( !pCriticalSection )
-	{
-		pCriticalSection = new CRITICAL_SECTION;
-		InitializeCriticalSection( pCriticalSection );
-	}
+	WAVEFORMATEX waveform;
 
-	cleanWaveBufferQueue();
+	close();
 
-	closeWaveOutDevice();
+	ring_ = &ring;
+	closing_ = 0;
 
 	ZeroMemory( &waveform, sizeof( waveform ) );
 
 	waveform.wFormatTag = WAVE_FORMAT_PCM;	/* format type */
 	waveform.nChannels = 2;					/* number of channels (i.e. mono, stereo...) */
-	waveform.nSamplesPerSec = WaveFreq;		/* sample rate */
-	waveform.nAvgBytesPerSec = 2*WaveFreq;	/* for buffer estimation */
+	waveform.nSamplesPerSec = freq;			/* sample rate */
+	waveform.nAvgBytesPerSec = 2*freq;		/* for buffer estimation */
 	waveform.nBlockAlign = 2;				/* block size of data */
 	waveform.wBitsPerSample = 8;			/* number of bits per sample of mono data */
 
-#pragma warning(suppress:4311)
-	MMErrorBox( waveOutOpen( &hWaveOut, WAVE_MAPPER, &waveform, (DWORD)waveOutProc, 0, CALLBACK_FUNCTION ), "initWaveOutDevice/waveOutOpen" );
+	if ( MMErrorBox( waveOutOpen( &hWaveOut_, WAVE_MAPPER, &waveform, (DWORD_PTR)waveOutProc, (DWORD_PTR)this, CALLBACK_FUNCTION ), "Win32Audio::open/waveOutOpen" ) )
+	{
+		hWaveOut_ = 0;
+		return false;
+	}
 
-	WaveDeviceInitialized = true;
-}
+	// prepare the ring blocks once, to play them in place
+	headers_ = new WAVEHDR[ ring.getBlocks() ];
+	ZeroMemory( headers_, ring.getBlocks() * sizeof( WAVEHDR ) );
 
-CFUNC long getWaveBuffersCounter()
-{
-	return WaveBuffersCounter;
-}
+	for ( uint i = 0; i < ring.getBlocks(); ++i )
+	{
+		headers_[i].lpData = (LPSTR)ring.getBlock( i );
+		headers_[i].dwBufferLength = ring.getBlockSize();
+		MMErrorBox( waveOutPrepareHeader( hWaveOut_, &headers_[i], sizeof( WAVEHDR ) ), "Win32Audio::open/waveOutPrepareHeader" );
+	}
 
-CFUNC void setWaveBuffersCounter( long n )
-{
-	WaveBuffersCounter = n;
+	return true;
 }
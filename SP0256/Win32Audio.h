@@ -26,25 +26,43 @@
 #ifndef MFCTERMAUDIO_H
 #define MFCTERMAUDIO_H
 
-#ifdef __cplusplus
-# define CFUNC extern "C"
-#else
-# define CFUNC
-#endif
+#include "AudioConsumer_I.h"
+
+#include <windows.h>
+#include <mmsystem.h>
+
+// Win32 wave output device, playing the audio ring blocks in place:
+// one WAVEHDR per ring block, prepared once at open
+
+class Win32Audio : public AudioConsumer_I
+{
+public:
+	Win32Audio()
+		: ring_( 0 ), hWaveOut_( 0 ), headers_( 0 ), closing_( 0 )
+	{
+	}
+
+	~Win32Audio()
+	{
+		close();
+	}
 
-// Queue a wave buffer for playing
-CFUNC void queueWaveBuffer( unsigned char* Buffer, unsigned long BufSize );
+	// Init the audio wave output device
+	bool open( AudioRing &ring, ulong freq );
 
-// Init the audio wave output device
-CFUNC void initWaveOutDevice( unsigned long WaveFreq );
+	// Queue a ring block for playing
+	void push( uchar *block );
 
-// Play the remaining buffer then close the audio wave output device
-CFUNC void closeWaveOutDevice();
+	// Play the remaining blocks then close the audio wave output device
+	void close();
 
-// Get the number of currently queued wave buffers.
-CFUNC long getWaveBuffersCounter();
+private:
+	static void CALLBACK waveOutProc( HWAVEOUT waveOut, UINT uMsg, DWORD_PTR dwInstance, DWORD_PTR dwParam1, DWORD_PTR dwParam2 );
 
-// Set the number of currently queued wave buffers.
-CFUNC void setWaveBuffersCounter( long n );
+	AudioRing			*ring_;
+	HWAVEOUT			hWaveOut_;
+	WAVEHDR				*headers_;
+	volatile LONG		closing_;
+};
 
 #endif
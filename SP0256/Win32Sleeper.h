@@ -28,6 +28,7 @@
 #include "Sleeper_I.h"
 
 #include <windows.h>
+#include <mmsystem.h>
 
 class Win32Sleeper :
 	public Sleeper_I
@@ -36,10 +37,13 @@ public:
 
 	Win32Sleeper(void)
 	{
+		// 1 ms timer resolution for Sleep()
+		timeBeginPeriod( 1 );
 	}
 
 	virtual ~Win32Sleeper(void)
 	{
+		timeEndPeriod( 1 );
 	}
 
 	void sleep( ulong millis )
@@ -26,6 +26,9 @@
 #include "audio.h"
 
 #include "Win32Audio.h"
+#include "AudioRing.h"
+#include "AudioTelemetry.h"
+#include "BufferLevel_I.h"
 #include "types.h"
 
 #include "cstdio"
@@ -40,9 +43,11 @@
 #define AUDIO_BUFFER_LENGTH (2*AUDIO_FREQ/AUDIO_BUFFER_FREQ) // 2* because stereo
 ///////////////////////////////////////////////////////////////////////////////
 
-static uchar	audioBuffers_[AUDIO_NUM_BUFFERS][AUDIO_BUFFER_LENGTH]; // Audio Output Buffers
-static long		audioCurrentPos_ = 0;
-static unsigned audioCurrentBuffer_ = 0;
+static AudioRing	audioRing_( AUDIO_NUM_BUFFERS, AUDIO_BUFFER_LENGTH ); // Audio Output Buffers
+static Win32Audio	audioDevice_;
+static AudioConsumer_I *audioConsumer_ = &audioDevice_;
+static AudioTelemetry *audioTelemetry_ = 0;
+static uchar	*audioCurrentBuffer_ = 0;
 static unsigned audioCurrentBufferPos_ = 0;
 static uchar	audioCurrentLevelL_ = 0x80;
 static uchar	audioCurrentLevelR_ = 0x80;
@@ -77,27 +82,31 @@ void outWaveUpdate()
 			uchar iLevelL = uchar( audioLastLevelL + nCycles * ( audioCurrentLevelL_ - audioLastLevelL )  / incCyclesAudio );
 			uchar iLevelR = uchar( audioLastLevelR + nCycles * ( audioCurrentLevelR_ - audioLastLevelR )  / incCyclesAudio );
 
+			// wait for a free buffer if too far ahead
+			if ( !audioCurrentBuffer_ )
+				audioCurrentBuffer_ = audioRing_.acquire();
+
 #ifdef AUDIO_FILTER
 			levelL += ( ( (unsigned)( iLevelL - levelL ) * AUDIO_FILTER ) >> 8 );
 			levelR += ( ( (unsigned)( iLevelR - levelR ) * AUDIO_FILTER ) >> 8 );
-			audioBuffers_[audioCurrentBuffer_][audioCurrentBufferPos_++] = levelL;
-			audioBuffers_[audioCurrentBuffer_][audioCurrentBufferPos_++] = levelR;
+			audioCurrentBuffer_[audioCurrentBufferPos_++] = levelL;
+			audioCurrentBuffer_[audioCurrentBufferPos_++] = levelR;
 #else
-			audioBuffers_[audioCurrentBuffer_][audioCurrentBufferPos_++] = iLevelL;
-			audioBuffers_[audioCurrentBuffer_][audioCurrentBufferPos_++] = iLevelR;
+			audioCurrentBuffer_[audioCurrentBufferPos_++] = iLevelL;
+			audioCurrentBuffer_[audioCurrentBufferPos_++] = iLevelR;
 #endif
 			if ( audioCurrentBufferPos_ == AUDIO_BUFFER_LENGTH )
 			{
+				audioRing_.commit();
 #if USE_AUDIO
-				queueWaveBuffer( audioBuffers_[audioCurrentBuffer_], AUDIO_BUFFER_LENGTH );
+				audioConsumer_->push( audioCurrentBuffer_ );
+#else
+				audioRing_.release();
 #endif
-				++audioCurrentBuffer_;
+				if ( audioTelemetry_ )
+					audioTelemetry_->committed( audioRing_ );
+				audioCurrentBuffer_ = 0;
 				audioCurrentBufferPos_ = 0;
-
-				if ( audioCurrentBuffer_ == AUDIO_NUM_BUFFERS )
-				{
-					audioCurrentBuffer_ = 0;
-				}
 			}
 			--nSamples;
 		}
@@ -123,7 +132,33 @@ void outWaveReset()
 
 void outWaveInit()
 {
-	initWaveOutDevice( AUDIO_FREQ );
+	audioConsumer_->open( audioRing_, AUDIO_FREQ );
+	if ( audioTelemetry_ )
+		audioTelemetry_->start( audioRing_, AUDIO_FREQ, AUDIO_BUFFER_LENGTH / 2 );
+}
+
+void outWaveSetConsumer( AudioConsumer_I *consumer )
+{
+	audioConsumer_ = consumer ? consumer : &audioDevice_;
+}
+
+void outWaveSetTelemetry( AudioTelemetry *telemetry )
+{
+	audioTelemetry_ = telemetry;
+}
+
+void outWaveMark()
+{
+	// stereo frames produced
+	if ( audioTelemetry_ )
+		audioTelemetry_->mark( audioRing_.getCommits() * ( AUDIO_BUFFER_LENGTH / 2 ) + audioCurrentBufferPos_ / 2 );
+}
+
+void outWaveGetStats( ulong &blocks, ulong &underruns, ulong &waits )
+{
+	blocks = audioRing_.getCommits();
+	underruns = audioRing_.getUnderruns();
+	waits = audioRing_.getWaits();
 }
 
 void outWaveCycles( ulong cycles )
@@ -131,6 +166,28 @@ void outWaveCycles( ulong cycles )
 	cyclesAudio_ += cycles * AUDIO_FREQ;
 }
 
+long outWaveGetBlockTime()
+{
+	return 1000000L / AUDIO_BUFFER_FREQ;
+}
+
+// level of the committed blocks not yet played
+class AudioRingLevel : public BufferLevel_I
+{
+public:
+	long getBufferedTime()
+	{
+		return long( audioRing_.getFill() ) * outWaveGetBlockTime();
+	}
+};
+
+static AudioRingLevel audioRingLevel_;
+
+BufferLevel_I *outWaveGetBufferLevel()
+{
+	return &audioRingLevel_;
+}
+
 void outWaveSetClockSpeed( long speed )
 {
 	clockspeed_ = speed;
@@ -138,14 +195,24 @@ void outWaveSetClockSpeed( long speed )
 
 void outWaveFlush()
 {
+	if ( !audioCurrentBuffer_ )
+		audioCurrentBuffer_ = audioRing_.acquire();
+
 	while( audioCurrentBufferPos_ < AUDIO_BUFFER_LENGTH )
 	{
-		audioBuffers_[audioCurrentBuffer_][audioCurrentBufferPos_++] = audioCurrentLevelL_;
-		audioBuffers_[audioCurrentBuffer_][audioCurrentBufferPos_++] = audioCurrentLevelR_;
+		audioCurrentBuffer_[audioCurrentBufferPos_++] = audioCurrentLevelL_;
+		audioCurrentBuffer_[audioCurrentBufferPos_++] = audioCurrentLevelR_;
 	}
 
-	queueWaveBuffer( audioBuffers_[audioCurrentBuffer_], AUDIO_BUFFER_LENGTH );
+	audioRing_.commit();
+	audioConsumer_->push( audioCurrentBuffer_ );
+	audioCurrentBuffer_ = 0;
+	audioCurrentBufferPos_ = 0;
+	if ( audioTelemetry_ )
+		audioTelemetry_->committed( audioRing_ );
 
-	closeWaveOutDevice();
+	audioConsumer_->close();
+	if ( audioTelemetry_ )
+		audioTelemetry_->finish( audioRing_ );
 
 }
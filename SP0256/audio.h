@@ -27,6 +27,10 @@
 
 #include "types.h"
 
+class AudioConsumer_I;
+class AudioTelemetry;
+class BufferLevel_I;
+
 // Update wave buffers and send them to audio device
 void outWaveUpdate();
 
@@ -39,9 +43,27 @@ void outWaveReset();
 // Init audio device
 void outWaveInit();
 
+// Select the audio consumer (0: Win32 audio device), before outWaveInit()
+void outWaveSetConsumer( AudioConsumer_I *consumer );
+
+// Select the telemetry of the live output (0: none), before outWaveInit()
+void outWaveSetTelemetry( AudioTelemetry *telemetry );
+
+// Mark the next sample as the first one of a command, for the latency telemetry
+void outWaveMark();
+
+// Get the audio statistics: blocks played, underruns, waits for a free block
+void outWaveGetStats( ulong &blocks, ulong &underruns, ulong &waits );
+
 // Add cycles to the cycles counter
 void outWaveCycles( ulong cycles );
 
+// Get the duration of an audio block in us
+long outWaveGetBlockTime();
+
+// Get the level of the audio blocks queued to the consumer
+BufferLevel_I *outWaveGetBufferLevel();
+
 // Set the logical waves sampling frequency
 void outWaveSetClockSpeed( long speed );
 
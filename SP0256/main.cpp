@@ -33,26 +33,35 @@
 #include "Win32Sleeper.h"
 #include "SystemClock.h"
 #include "audio.h"
+#include "AudioTelemetry.h"
 #include "WaveWriter.h"
+#include "MappedInput.h"
+#include "NullAudio.h"
+#include "LabelTokenizer.h"
+#include "FrameStream.h"
+#include "DecleStream.h"
+#include "BatchRenderer.h"
+#include "SoundBank.h"
+#include "Benchmark.h"
+#include "MicroBenchmarks.h"
+#include "GoldenSuite.h"
+#include "Metrics.h"
+#include "MetricsServer.h"
 
 #include "sp0256.h"
 
 #include "sp0256_al2.h"	// SP0256-AL2 "Narrator"
 #include "sp0256_012.h"	// SP0256-012 "Intellivoice"
 
-#include <map>
 #include <string>
-#include <algorithm>
-#include <fstream>
+#include <vector>
 #include <sstream>
 #include <iostream>
-#include <memory>
+#include <ctime>
 
 
 using namespace sp0256_al2;
 
-typedef std::map< std::string, size_t > dict_t;
-
 enum model_t
 {
 	_012, _AL2
@@ -64,7 +73,10 @@ static void help()
 		NAME " - " VERSION "\n\n"
 		"GI/Microchip SP0256-AL2 Narrator(tm) and SP0256-012 Intellivoice(tm) Speech Processor\n\n"
 		"Usage:\n"
-		"sp0256 [-m{AL2|012}] [-e] [-v] [-xClockFreq] [ -t | -b | -a ] [ -i{inFile|-} ] [-wWavFile]\n"
+		"sp0256 [-m{AL2|012}] [-e] [-v] [-xClockFreq] [ -t | -b | -a ] [ -i{inFile|-|@Manifest} ] [ -wWavFile | -rRawFile ] [-s{8|16|F|U|A|I}]\n"
+		"       [-n[RawFile]] [-gMs] [-fFrameFile] [-p] [-l] [-cDecleFile] [-j[Threads]] [-kBankFile] [-qBankFile]\n"
+		"       [-oResults[,Baseline[,Pct]]] [-u[Filter][,Iterations[,Repetitions]]] [-y[+]GoldenDir]\n"
+		"       [-z[+]TraceFile[,Records]] [-h{Port|MetricsFile[,Ms]}]\n"
 		"-mAL2     Select Narrator(tm) speech ROM\n"
 		"-m012     Select Intellivoice speech ROM\n"
 		"-e        Echo speech elements (words or allophones)\n"
@@ -73,10 +85,37 @@ static void help()
 		"-xClkFreq Xtal Clock Frequency in Hz (range: 1000000..5000000)\n"
 		"-iInFile  Say File\n"
 		"-i-       Say from stdin: echo ... | sp0256 -i-\n"
+		"-i@Manif  Batch: render the jobs of Manifest (lines \"OutFile @InFile|Labels\")\n"
+		"-j[Thrds] Number of batch worker threads (default: number of processors)\n"
 		"-t        Text Mode (labels) (default)\n"
 		"-b        Binary Mode (addresses)\n"
 		"-a        Pronounce all words or allophones in speech ROM\n"
+		"-p        Replay Mode (LPC frame stream recorded with -f)\n"
+		"-l        LPC Mode (10-bit decles in 16-bit words, run through the SPB640 FIFO)\n"
 		"-wWavFile Create .wav file\n"
+		"-w-       Stream .wav to stdout: sp0256 -w- ... | sox -t wav - ...\n"
+		"-rRawFile Create headerless raw PCM file, -r- to stream to stdout\n"
+		"-sFormat  Sample format of -w and -r: 8 = 8-bit unsigned (default), 16 = 16-bit,\n"
+		"          F = float, U = G.711 mu-law, A = G.711 A-law, I = IMA-ADPCM\n"
+		"-n[File]  Null audio device: play in real time without sound card,\n"
+		"          optionally writing the raw PCM (8-bit stereo) to File\n"
+		"-gMs      Adaptive turbo: render ahead up to Ms of audio (default 300, 0=off)\n"
+		"-fFrmFile Record the LPC frame stream to FrmFile\n"
+		"-cDclFile Compile the input to a decle stream for -l, without synthesis\n"
+		"-kBnkFile Export all words and allophones of both ROMs to a PCM sound bank\n"
+		"-qBnkFile Say from the PCM sound bank instead of synthesizing\n"
+		"-oResults Benchmark: synthesize the input or the built-in corpus, write the results\n"
+		"          in JSON to Results (- = console), compare them with Baseline and fail on a\n"
+		"          regression beyond Pct % (default 10)\n"
+		"-u[Filt]  Micro-benchmarks of the kernels whose name contains Filt: filter, micro,\n"
+		"          getb, wave; the results go to -o\n"
+		"-yGolden  Check the samples of the reference cases against the golden outputs\n"
+		"          in the Golden directory; -y+Golden records them\n"
+		"-z+TrFile Record the events of -d (default: D) to a binary trace ring of Records\n"
+		"          (default 65536), dumped to TrFile at the end\n"
+		"-zTrFile  Decode the binary trace TrFile to the text of -d\n"
+		"-hPort    Serve the metrics in Prometheus text format on the local TCP Port\n"
+		"-hFile,Ms Write the metrics to File every Ms (default 1000) and at the exit\n"
 	);
 }
 
@@ -100,14 +139,289 @@ static int codes_al2[] = {
 // "Mattel Electronics Presents - Zero Two Five Six - And - Zero One Two"
 static int codes_012[] = { 6, 2, 7, 9, 12, 13, 2, 42, 2, 7, 8, 9, -1 };
 
+// Benchmark corpus: the allophones of the CTS256A-AL2 benchmark corpus
+static const char benchmarkCorpus[] =
+	" DH1 AX PA2 PA3 KK3 WH IH PA3 KK2 PA2 PA2 BB1 RR2 AW NN1 PA2 FF AA PA3 KK2 SS PA2 PA2 JH AX MM PA3 "
+	"PP SS PA2 OW VV ER1 PA2 DH1 AX PA2 LL EY ZZ IY PA2 PA2 DD2 AA PA2 GG3 PA5 PA5 PA2 SS SS PA3 PP IY "
+	"PA3 CH PA2 SS SS IH NN1 TH EH ZZ IH SS PA2 PA3 KK3 AX NN1 VV ER1 PA3 TT1 SS PA2 RR1 IH PA3 TT2 EH "
+	"NN1 PA2 PA3 TT2 EH PA3 KK2 SS PA3 TT2 PA2 IH NN1 PA3 TT2 UW2 PA2 SS SS PA3 PP OW PA3 KK1 EH NN1 PA2 "
+	"WW ER1 PA2 DD1 ZZ PA5 PA5 PA3 AA NN1 PA2 MM AR PA3 CH PA2 TH RR1 IY RR1 PA2 DD1 PA4 PA2 WW AX AX "
+	"NN1 NN2 AY NN1 EY PA3 TT2 TH RR1 IY PA4 PA2 DH1 AX PA2 PA3 TT2 EH MM PA3 PP ER1 AE PA3 CH ER1 PA2 "
+	"WW AX ZZ PA2 SS SS EH VV IH NN1 PA3 TT2 UW2 PA2 PA2 DD2 EH PA2 GG2 RR2 IY ZZ PA2 AE PA3 TT2 PA2 WW "
+	"AX AX NN1 ZZ YR OW PA5 FF OR FF AY VV PA2 AE MM PA4 PA2 DH1 AX PA2 WW AY NN1 PA2 DD1 PA2 PA2 BB1 LL "
+	"UW2 PA2 FF RR2 AA MM PA2 DH1 AX PA2 NN2 OR TH PA1 WW EH SS SS PA3 TT2 PA2 AE PA3 TT2 PA2 WW AX AX "
+	"NN1 FF AY VV PA2 MM FF PA5 PA5 PA3 PA3 PP LL IY ZZ PA2 PA3 KK1 AO LL PA2 FF AY VV FF AY VV FF AY VV "
+	"PA1 WW AX AX NN1 PA3 TT2 UW2 TH RR1 IY FF OR PA2 AE NN1 PA2 DD1 PA2 AE SS SS PA3 KK2 PA2 FF OR PA2 "
+	"EH PA3 KK2 SS PA3 TT2 EH NN1 SH AX NN1 PA2 FF OR PA3 TT2 UW2 PA5 PA5 PA2 IH ZZ PA2 DH1 IH SS SS PA2 "
+	"DH1 AX PA2 RR1 AY PA3 TT2 PA2 WW EY PA2 PA3 TT2 UW2 PA2 DH1 AX PA2 SS SS PA3 TT2 EY SH AX NN1 PA5 "
+	"PA5 PA2 YY2 EH SS SS PA4 PA2 IH PA3 TT2 PA2 IH ZZ PA5 PA5 PA3 SH IY PA2 SS SS EH LL ZZ PA2 SS SS IY "
+	"PA2 SH EH LL ZZ PA2 PA2 BB2 AY PA2 DH1 AX PA2 SS SS IY PA2 SH OR PA4 PA2 AE NN1 PA2 DD1 PA2 DH1 AX "
+	"PA2 SH EH LL ZZ PA2 SH IY PA2 SS SS EH LL ZZ PA2 AR PA2 SH ER1 EL IY PA2 SS SS IY PA2 SH EH LL ZZ "
+	"PA5 PA5 PA3 NN2 AX MM ER1 ZZ PA2 LL AY PA3 KK1 PA2 WW AX AX NN1 PA4 PA2 PA3 TT2 UW2 PA3 TT2 UW2 PA4 "
+	"PA2 TH RR1 IY TH RR1 IY TH RR1 IY PA4 PA2 FF OR FF OR FF OR FF OR PA2 AE NN1 PA2 DD1 PA2 FF AY VV "
+	"FF AY VV FF AY VV FF AY VV FF AY VV PA2 AR PA2 SS SS PA3 PP EH EL PA2 DD1 PA2 AW PA3 TT2 PA2 PA2 "
+	"DD2 IH PA2 JH IH PA3 TT2 PA2 PA2 BB2 AY PA2 PA2 DD2 IH PA2 JH IH PA3 TT2 PA4 PA2 OR PA2 AE ZZ PA2 "
+	"HH2 OW LL PA2 NN2 AX MM ER1 ZZ PA5 PA5 PA3 PA3 ";
 
-static std::string toUpperCase( const std::string &str )
+// Synthesize commands on an independent synthesizer: 16-bit samples
+static void synthesize( const uint8_t *mask, const std::vector< int > &commands, std::vector< int > &samples )
 {
-	std::string uStr = str;
-	std::transform( uStr.begin(), uStr.end(), uStr.begin(), ::toupper );
-	return uStr;
+	ivoice_t voice;
+	sp0256_voiceInit( &voice, mask );
+	samples.clear();
+
+	int16_t block[SP0256_RENDER_BLOCK];
+	size_t next = 0;
+	while ( next < commands.size() || !sp0256_voiceHalted( &voice ) )
+	{
+		if ( next < commands.size() && sp0256_voiceGetStatus( &voice ) )
+			sp0256_voiceSendCommand( &voice, commands[next++] );
+		// up to the next command
+		const int n = sp0256_voiceRender( &voice, block, SP0256_RENDER_BLOCK );
+		samples.insert( samples.end(), block, block + n );
+	}
+}
+
+// Synthesize the commands and write them to a .wav file, keeping the best of the runs
+static int benchmark( Benchmark &bench, const std::vector< int > &commands, const uint8_t *mask, int freq,
+	const char *waveFileName, int waveFreq, unsigned waveBits, unsigned waveTag, FILE *con )
+{
+	std::vector< int > samples;
+	double best = 0;
+	for ( unsigned run=0; run<bench.getRuns(); ++run )
+	{
+		const double start = Benchmark::now();
+		synthesize( mask, commands, samples );
+		const double elapsed = Benchmark::now() - start;
+
+		if ( !run || elapsed < best )
+			best = elapsed;
+	}
+
+	// .wav file: the -w file, or a temporary file
+	char tempName[MAX_PATH];
+	if ( !waveFileName || !strcmp( waveFileName, "-" ) )
+	{
+		char tempPath[MAX_PATH];
+		if ( !GetTempPathA( MAX_PATH, tempPath ) || !GetTempFileNameA( tempPath, "spb", 0, tempName ) )
+		{
+			fprintf( con, "Failed to create a temporary file\n" );
+			return 1;
+		}
+		waveFileName = tempName;
+	}
+	else
+	{
+		tempName[0] = 0;
+	}
+
+	const bool shift = waveTag == WAVE_TAG_PCM && waveBits == 8;
+	double bestWave = 0;
+	long waveSize = 0;
+	int err = 0;
+	for ( unsigned run=0; !err && run<bench.getRuns(); ++run )
+	{
+		const double start = Benchmark::now();
+		WaveWriter waveWriter;
+		err = waveWriter.create( waveFileName, waveFreq < freq ? freq : waveFreq, freq, 1, waveBits, waveTag );
+		for ( size_t i=0; !err && i<samples.size(); ++i )
+			waveWriter.write( shift ? ( ( samples[i] >> 8 ) + 0x80 ) & 0xFF : samples[i] );
+		waveWriter.close();
+		if ( !err )
+			err = waveWriter.getErrno();
+		const double elapsed = Benchmark::now() - start;
+
+		if ( !run || elapsed < bestWave )
+			bestWave = elapsed;
+	}
+
+	if ( !err )
+	{
+		FILE *file;
+		err = fopen_s( &file, waveFileName, "rb" );
+		if ( !err )
+		{
+			fseek( file, 0, SEEK_END );
+			waveSize = ftell( file );
+			fclose( file );
+		}
+	}
+	if ( tempName[0] )
+		DeleteFileA( tempName );
+	if ( err )
+	{
+		char buf[80];
+		strerror_s( buf, err );
+		fprintf( con, "%s error: %s\n", waveFileName, buf );
+		return 1;
+	}
+
+	const double audio = samples.size() * 1. / freq;
+	bench.add( "sp_commands", double( commands.size() ), BENCHMARK_EXACT );
+	bench.add( "sp_samples", double( samples.size() ), BENCHMARK_EXACT );
+	bench.add( "sp_samples_per_s", best > 0 ? samples.size() / best : 0 );
+	bench.add( "sp_rtf", audio > 0 ? best / audio : 0, BENCHMARK_LOWER );
+	bench.add( "wav_mb_per_s", bestWave > 0 ? waveSize / bestWave / 1048576. : 0 );
+	bench.add( "peak_rss_mb", Benchmark::getPeakRss(), BENCHMARK_LOWER );
+
+	return bench.finish( con );
 }
 
+// Commands of a list ended by a negative value
+static void getCommands( const int *codes, std::vector< int > &commands )
+{
+	commands.clear();
+	while ( *codes >= 0 )
+		commands.push_back( *codes++ );
+}
+
+// All the commands of a speech ROM
+static void getAllCommands( int count, std::vector< int > &commands )
+{
+	commands.clear();
+	for ( int i=0; i<count; ++i )
+		commands.push_back( i );
+}
+
+// Check the reference cases against the golden outputs: 16-bit samples
+static int golden( const char *dir, bool record, FILE *con )
+{
+	GoldenSuite suite( dir, record );
+	int err = suite.open();
+	if ( err )
+	{
+		char buf[80];
+		strerror_s( buf, err );
+		fprintf( con, "%s error: %s\n", dir, buf );
+		return 1;
+	}
+
+	std::vector< int > commands, samples;
+
+	getCommands( codes_al2, commands );
+	synthesize( sp0256_al2::mask, commands, samples );
+	suite.check( "al2_demo", samples, 2, 0, 0, con );
+
+	getAllCommands( sp0256_al2::nlabels, commands );
+	synthesize( sp0256_al2::mask, commands, samples );
+	suite.check( "al2_all", samples, 2, 0, 0, con );
+
+	LabelTokenizer tokenizer( sp0256_al2::labels, sp0256_al2::nlabels );
+	std::stringbuf corpus( benchmarkCorpus );
+	commands.clear();
+	for ( int code; ( code = tokenizer.next( corpus ) ) >= 0; )
+		commands.push_back( code );
+	synthesize( sp0256_al2::mask, commands, samples );
+	suite.check( "al2_corpus", samples, 2, 0, 0, con );
+
+	getCommands( codes_012, commands );
+	synthesize( sp0256_012::mask, commands, samples );
+	suite.check( "012_demo", samples, 2, 0, 0, con );
+
+	getAllCommands( sp0256_012::nlabels, commands );
+	synthesize( sp0256_012::mask, commands, samples );
+	suite.check( "012_all", samples, 2, 0, 0, con );
+
+	return suite.finish( con );
+}
+
+// Live metrics of the main loop, updated at each command
+class LoopMetrics
+{
+public:
+	LoopMetrics( Metrics &metrics )
+		: utterances_( metrics.counter( "sp0256_utterances_total", "Utterances rendered (batch jobs or inputs)." ) )
+		, commands_( metrics.counter( "sp0256_commands_total", "Commands sent to the synthesizers." ) )
+		, samples_( metrics.counter( "sp0256_samples_total", "Samples rendered." ) )
+		, underruns_( metrics.counter( "sp0256_audio_underruns_total", "Audio output underruns." ) )
+		, buffered_( metrics.gauge( "sp0256_audio_buffered_seconds", "Audio output queued, not yet played." ) )
+		, samplesSeen_( 0 ), underrunsSeen_( 0 )
+	{
+	}
+
+	// a command sent after samples; audio: playing on the audio output
+	void command( unsigned samples, bool audio )
+	{
+		commands_.add();
+		update( samples, audio );
+	}
+
+	// end of the input
+	void end( unsigned samples, bool audio )
+	{
+		utterances_.add();
+		update( samples, audio );
+	}
+
+private:
+	void update( unsigned samples, bool audio )
+	{
+		samples_.add( samples - samplesSeen_ );
+		samplesSeen_ = samples;
+		if ( audio )
+		{
+			ulong blocks, underruns, waits;
+			outWaveGetStats( blocks, underruns, waits );
+			underruns_.add( underruns - underrunsSeen_ );
+			underrunsSeen_ = underruns;
+			buffered_.set( outWaveGetBufferLevel()->getBufferedTime() / 1e6 );
+		}
+	}
+
+	Metrics::Counter	&utterances_;
+	Metrics::Counter	&commands_;
+	Metrics::Counter	&samples_;
+	Metrics::Counter	&underruns_;
+	Metrics::Gauge		&buffered_;
+	unsigned			samplesSeen_;
+	ulong				underrunsSeen_;
+};
+
+// Micro-sequencer and filter counters, aggregated and by command
+static void printCounters( FILE *con, const sp0256_counters_t *table, const char* *labels, int codemax )
+{
+	sp0256_counters_t total;
+	sp0256_getCounters( &total );
+
+	unsigned long instructions = 0;
+	for ( int op=0; op<16; ++op )
+		instructions += total.opcodes[op];
+	const unsigned long samples = total.voiced + total.noise + total.pause + total.halted;
+
+	fprintf( con, "instructions=%lu - repeatBlocks=%lu - interpolations=%lu - romFetches=%lu - fifoFetches=%lu\n",
+		instructions, total.repeats, total.interps, total.rom_fetches, total.fifo_fetches );
+	fputs( "opcodes:", con );
+	for ( int op=0; op<16; ++op )
+	{
+		if ( total.opcodes[op] )
+		{
+			// mnemonic only
+			const char *name = sp0256_getOpcodeName( op );
+			fprintf( con, " %.*s=%lu", int( strcspn( name, " " ) ), name, total.opcodes[op] );
+		}
+	}
+	fputs( "\n", con );
+	fprintf( con, "samples: voiced=%lu (%.1f%%) - noise=%lu (%.1f%%) - pause=%lu (%.1f%%) - halted=%lu (%.1f%%)\n",
+		total.voiced, samples ? 100. * total.voiced / samples : 0.,
+		total.noise, samples ? 100. * total.noise / samples : 0.,
+		total.pause, samples ? 100. * total.pause / samples : 0.,
+		total.halted, samples ? 100. * total.halted / samples : 0. );
+
+	fprintf( con, "%-6s %8s %8s %8s %8s %8s %8s %8s %8s\n",
+		"cmd", "instr", "repeats", "interps", "voiced", "noise", "pause", "halted", "fetches" );
+	for ( int cmd=0; cmd<SP0256_NCOUNTERS; ++cmd )
+	{
+		const sp0256_counters_t &c = table[cmd];
+		unsigned long instr = 0;
+		for ( int op=0; op<16; ++op )
+			instr += c.opcodes[op];
+		if ( !instr && !c.halted )
+			continue;
+		fprintf( con, "%-6s %8lu %8lu %8lu %8lu %8lu %8lu %8lu %8lu\n",
+			cmd == SP0256_COUNTERS_FIFO ? "FIFO" : cmd == SP0256_COUNTERS_HALT ? "(halt)" : cmd <= codemax ? labels[cmd] : "?",
+			instr, c.repeats, c.interps, c.voiced, c.noise, c.pause, c.halted, c.rom_fetches + c.fifo_fetches );
+	}
+}
 
 int _tmain(int argc, _TCHAR* argv[])
 {
@@ -117,23 +431,41 @@ int _tmain(int argc, _TCHAR* argv[])
 	char echo = 0;
 	char eos = 0;
 	int debug = 0;
-	dict_t dict;
 	int xtal = 3120000;
 	int waveFreq = 0;
 
 	const char* waveFileName = 0;
+	bool rawOutput = false;
+	unsigned waveBits = 8;
+	unsigned waveTag = WAVE_TAG_PCM;
+	const char* rawFileName = 0;
+	bool nullAudio = false;
+	int headStart = 300;
+	const char* frameFileName = 0;
+	const char* decleFileName = 0;
+	const char* batchFileName = 0;
+	const char* bankExportName = 0;
+	const char* bankFileName = 0;
+	uint threads = 0;
+	bool benchmarkMode = false;
+	bool microBenchmarks = false;
+	const char* goldenDir = 0;
+	bool goldenRecord = false;
+	const char* traceFileName = 0;
+	bool traceRecord = false;
+	uint traceRecords = 0x10000;
+	const char* metricsOption = 0;
+	Benchmark bench( "sp0256" );
 
 	int errno_ = 0;
 	const char *fileName = 0;
+	const char *inputName = "stdin";
 
-	std::istream *pistr = &std::cin;
+	std::istream *pistr = 0;
 	std::stringstream sstr;
 
-#if __cplusplus >= 201103L
-	std::unique_ptr< std::fstream > pfstr;
-#else
-	std::auto_ptr< std::fstream > pfstr;
-#endif
+	MappedInput input;
+	std::istream istr( &input );
 
 	for ( int i=1; i<argc; ++i )
 	{
@@ -173,22 +505,21 @@ int _tmain(int argc, _TCHAR* argv[])
 				++s;
 				if ( *s == ':' )
 					++s;
-				if ( !_strcmpi( s, "-" ) )
-					pistr = &std::cin;
+				if ( *s == '@' )
+					batchFileName = s + 1;
 				else
 				{
-					pfstr.reset( new std::fstream( fileName = s, std::fstream::in ) );
-					pistr = pfstr.get();
-					if ( !pfstr->is_open() )
-					{
+					errno_ = input.open( _strcmpi( s, "-" ) ? fileName = inputName = s : 0 );
+					if ( errno_ )
 						printf( "Failed to open %s\n", s );
-						errno_ = errno;
-					}
 				}
+				pistr = &istr;
 				if ( !mode )
 					mode = 'T';
 				break;
 			case 'W': // Output to .WAV file
+			case 'R': // Output to raw PCM file
+				rawOutput = toupper( *s ) == 'R';
 				++s;
 				if ( isdigit( *s ) )
 					sscanf_s( s, "%d", &waveFreq );
@@ -198,6 +529,132 @@ int _tmain(int argc, _TCHAR* argv[])
 					++s;
 				waveFileName = s;
 				break;
+			case 'S': // Sample format
+				++s;
+				if ( *s == ':' )
+					++s;
+				if ( !strcmp( s, "8" ) )
+				{
+					waveBits = 8;
+					waveTag = WAVE_TAG_PCM;
+				}
+				else if ( !strcmp( s, "16" ) )
+				{
+					waveBits = 16;
+					waveTag = WAVE_TAG_PCM;
+				}
+				else if ( toupper( *s ) == 'F' && !s[1] )
+				{
+					waveBits = 32;
+					waveTag = WAVE_TAG_FLOAT;
+				}
+				else if ( toupper( *s ) == 'U' && !s[1] )
+				{
+					waveBits = 8;
+					waveTag = WAVE_TAG_ULAW;
+				}
+				else if ( toupper( *s ) == 'A' && !s[1] )
+				{
+					waveBits = 8;
+					waveTag = WAVE_TAG_ALAW;
+				}
+				else if ( toupper( *s ) == 'I' && !s[1] )
+				{
+					waveBits = 4;
+					waveTag = WAVE_TAG_IMA_ADPCM;
+				}
+				else
+				{
+					puts( NAME " - " VERSION );
+					printf( "Unknown sample format: %s\n", s );
+					return 1;
+				}
+				break;
+			case 'P': // Replay LPC frame stream
+				mode = 'P';
+				break;
+			case 'J': // Batch worker threads
+				++s;
+				if ( *s == ':' )
+					++s;
+				threads = atoi( s );
+				break;
+			case 'L': // LPC decle stream
+				mode = 'L';
+				break;
+			case 'C': // Compile to decle stream
+				++s;
+				if ( *s == ':' )
+					++s;
+				decleFileName = s;
+				break;
+			case 'K': // Export PCM sound bank
+				++s;
+				if ( *s == ':' )
+					++s;
+				bankExportName = s;
+				break;
+			case 'Q': // Say from PCM sound bank
+				++s;
+				if ( *s == ':' )
+					++s;
+				bankFileName = s;
+				break;
+			case 'O': // Benchmark
+				++s;
+				if ( *s == ':' )
+					++s;
+				if ( !bench.setOption( s ) )
+				{
+					puts( NAME " - " VERSION );
+					printf( "Invalid benchmark option: %s\n", s );
+					return 1;
+				}
+				benchmarkMode = true;
+				break;
+			case 'Y': // Golden outputs
+				++s;
+				goldenRecord = *s == '+';
+				if ( goldenRecord )
+					++s;
+				goldenDir = s;
+				break;
+			case 'H': // Metrics endpoint
+				++s;
+				if ( *s == ':' )
+					++s;
+				metricsOption = s;
+				break;
+			case 'Z': // Binary trace
+				++s;
+				traceRecord = *s == '+';
+				if ( traceRecord )
+					++s;
+				if ( char *comma = strchr( s, ',' ) )
+				{
+					*comma = 0;
+					sscanf_s( comma + 1, "%u", &traceRecords );
+				}
+				traceFileName = s;
+				break;
+			case 'U': // Micro-benchmarks
+				++s;
+				if ( *s == ':' )
+					++s;
+				if ( !bench.setMicroOption( s ) )
+				{
+					puts( NAME " - " VERSION );
+					printf( "Invalid micro-benchmark option: %s\n", s );
+					return 1;
+				}
+				microBenchmarks = true;
+				break;
+			case 'F': // Record LPC frame stream
+				++s;
+				if ( *s == ':' )
+					++s;
+				frameFileName = s;
+				break;
 			case 'A': // All Sounds/Allophones
 				mode = 'A';
 				break;
@@ -226,6 +683,19 @@ int _tmain(int argc, _TCHAR* argv[])
 			case 'V': // Verbose
 				verbose = 1;
 				break;
+			case 'N': // Null audio device
+				++s;
+				if ( *s == ':' )
+					++s;
+				nullAudio = true;
+				rawFileName = *s ? s : 0;
+				break;
+			case 'G': // Adaptive turbo target
+				++s;
+				if ( *s == ':' )
+					++s;
+				sscanf_s( s, "%d", &headStart );
+				break;
 			case 'X': // Xtal
 				++s;
 				if ( *s == ':' )
@@ -265,10 +735,76 @@ int _tmain(int argc, _TCHAR* argv[])
 			break;
 	}
 
-	if ( !mode )
+	if ( goldenDir )
+		return golden( goldenDir, goldenRecord, stdout );
+
+	if ( microBenchmarks )
+	{
+		errno_ = MicroBenchmarks::run( bench, stdout );
+		if ( errno_ )
+		{
+			char buf[80];
+			strerror_s( buf, errno_ );
+			printf( "Micro-benchmarks error: %s\n", buf );
+			return 1;
+		}
+		return bench.finish( stdout );
+	}
+
+	if ( traceFileName && !traceRecord )
 	{
-		puts( NAME " - " VERSION );
-		printf( "sp0256 -? for help.\n" );
+		errno_ = model == _AL2
+			? sp0256_traceDecode( traceFileName, stdout, sp0256_al2::nlabels, sp0256_al2::labels )
+			: sp0256_traceDecode( traceFileName, stdout, sp0256_012::nlabels, sp0256_012::labels );
+		if ( errno_ )
+		{
+			char buf[80];
+			strerror_s( buf, errno_ );
+			printf( "%s error: %s\n", traceFileName, buf );
+			return 1;
+		}
+		return 0;
+	}
+
+	// metrics registry, exposed until the exit
+	Metrics metrics;
+	MetricsServer metricsServer( metrics );
+	if ( metricsOption )
+	{
+		errno_ = metricsServer.start( metricsOption );
+		if ( errno_ )
+		{
+			puts( NAME " - " VERSION );
+			printf( "Metrics endpoint %s error: %d\n", metricsOption, errno_ );
+			return 1;
+		}
+	}
+
+	// built-in corpus, unless an input is given
+	if ( !pistr && benchmarkMode )
+	{
+		sstr << benchmarkCorpus;
+		pistr = &sstr;
+		mode = 'T';
+	}
+
+	if ( !pistr )
+	{
+		// stdin: mapped if redirected from a file, else read by blocks
+		input.open( 0 );
+		pistr = &istr;
+	}
+
+	// read through the stream buffer cursor, without the istream overhead
+	std::streambuf &inbuf = *pistr->rdbuf();
+
+	// messages go to stderr when stdout carries the audio stream
+	FILE *con = waveFileName && !strcmp( waveFileName, "-" ) ? stderr : stdout;
+
+	if ( !mode && !bankExportName && !benchmarkMode )
+	{
+		fputs( NAME " - " VERSION "\n", con );
+		fprintf( con, "sp0256 -? for help.\n" );
 	}
 
 	int nAl2 = 0;
@@ -282,20 +818,77 @@ int _tmain(int argc, _TCHAR* argv[])
 	SystemClock systemClock;
 	Win32Sleeper sleeper;
 
-	if ( mode == 'T' )
+	// Labels tokenizer, for the text mode
+	LabelTokenizer tokenizer(
+		  model==_AL2 ? sp0256_al2::labels : sp0256_012::labels,
+		  model==_AL2 ? sp0256_al2::nlabels : sp0256_012::nlabels );
+
+	if ( !errno_ && benchmarkMode )
 	{
-		// Load "Narrator" dictionary
-		for ( size_t i=0; 
-			i < ( model==_AL2 ? sp0256_al2::nlabels 
-				: model==_012 ? sp0256_012::nlabels 
-				: 0 ); 
-			++i )
+		std::vector< int > commands;
+		for (;;)
 		{
-			dict[ toUpperCase(
-				  model==_AL2 ? sp0256_al2::labels[i] 
-				: model==_012 ? sp0256_012::labels[i] 
-				: "" ) ] = i;
+			const int code = mode == 'B' ? inbuf.sbumpc() : tokenizer.next( inbuf );
+			if ( code < 0 )
+				break;
+			commands.push_back( mode == 'B' ? code & 0x3F : code );
 		}
+		return benchmark( bench, commands, model==_AL2 ? sp0256_al2::mask : sp0256_012::mask, freq,
+			waveFileName, waveFreq, waveBits, waveTag, con );
+	}
+
+	if ( !threads )
+	{
+		SYSTEM_INFO info;
+		GetSystemInfo( &info );
+		threads = info.dwNumberOfProcessors;
+	}
+
+	if ( !errno_ && batchFileName )
+	{
+		BatchRenderer batch( tokenizer, model==_AL2 ? sp0256_al2::mask : sp0256_012::mask, mode, threads );
+		batch.setOutput( waveFreq < freq ? freq : waveFreq, freq, waveBits, waveTag );
+		batch.setMetrics( metrics );
+
+		MappedInput manifest;
+		errno_ = manifest.open( fileName = batchFileName );
+		if ( !errno_ )
+		{
+			const uint line = batch.load( manifest );
+			if ( line )
+			{
+				fprintf( con, "%s(%u): OutFile and Source expected\n", batchFileName, line );
+				return 1;
+			}
+			return batch.run( con ) ? 1 : 0;
+		}
+	}
+
+	if ( !errno_ && bankExportName )
+	{
+		const clock_t exportClock = clock();
+		SoundBankWriter bankWriter( threads, freq );
+		bankWriter.add( SOUND_BANK_ROM_AL2, sp0256_al2::mask, sp0256_al2::labels, sp0256_al2::nlabels );
+		bankWriter.add( SOUND_BANK_ROM_012, sp0256_012::mask, sp0256_012::labels, sp0256_012::nlabels );
+		errno_ = bankWriter.write( fileName = bankExportName );
+		if ( !errno_ )
+		{
+			const double seconds = double( clock() - exportClock ) / CLOCKS_PER_SEC;
+			fprintf( con, "%s: entries=%u samples=%lu audio=%.3f s elapsed=%.3f s threads=%u\n", bankExportName,
+				bankWriter.getEntries(), bankWriter.getSamples(), bankWriter.getSamples() * 1. / freq, seconds, threads );
+			return 0;
+		}
+	}
+
+	// PCM sound bank, replacing the synthesizer
+	SoundBank bank;
+	SoundBankPlayer bankPlayer( bank, model==_AL2 ? SOUND_BANK_ROM_AL2 : SOUND_BANK_ROM_012 );
+	bankPlayer.setMetrics( metrics );
+	if ( !errno_ && bankFileName )
+	{
+		errno_ = bank.open( fileName = bankFileName );
+		if ( !errno_ && bank.getEntries() )
+			freq = bank.getEntry( 0 ).sampleRate;
 	}
 
 	WaveWriter waveWriter;
@@ -303,15 +896,62 @@ int _tmain(int argc, _TCHAR* argv[])
 	{
 		if ( waveFreq < freq )
 			waveFreq = freq;
-		errno_ = waveWriter.create( fileName = waveFileName, waveFreq, freq, 1, 8 );
+		errno_ = waveWriter.create( fileName = waveFileName, waveFreq, freq, 1, waveBits, waveTag, rawOutput );
 	}
 
 	if ( errno_ )
 	{
-		puts( NAME " - " VERSION );
+		fputs( NAME " - " VERSION "\n", con );
 		char buf[80];
 		strerror_s( buf, errno_ );
-		printf( "%s error: %s\n", fileName, buf );
+		fprintf( con, "%s error: %s\n", fileName, buf );
+		return 1;
+	}
+
+	// before the frame recorder hook, cleared by the init
+	if ( model == _AL2 )
+		ivoice_init( sp0256_al2::mask );
+	else if ( model == _012 )
+		ivoice_init( sp0256_012::mask );
+
+	// counters by command of the verbose summary
+	static sp0256_counters_t commandCounters[SP0256_NCOUNTERS];
+	if ( verbose )
+		sp0256_setCommandCounters( commandCounters );
+
+	// binary trace of the classes selected by -d (default: micro-sequencer)
+	sp0256_trace_t trace;
+	if ( !errno_ && traceRecord )
+	{
+		errno_ = sp0256_traceInit( &trace, traceRecords, debug & 3 ? debug & 3 : SP0256_TRACE_MICRO );
+		fileName = traceFileName;
+		if ( !errno_ )
+			sp0256_setTrace( &trace );
+	}
+
+	FrameRecorder frameRecorder;
+	if ( !errno_ && frameFileName )
+		errno_ = frameRecorder.create( fileName = frameFileName );
+
+	DecleWriter decleWriter;
+	if ( !errno_ && decleFileName )
+		errno_ = decleWriter.create( fileName = decleFileName );
+
+	FrameReplay frameReplay( inbuf );
+	if ( !errno_ && mode == 'P' )
+	{
+		errno_ = frameReplay.open();
+		fileName = inputName;
+		// no commands, the frames drive the filter
+		eos = 1;
+	}
+
+	if ( errno_ )
+	{
+		fputs( NAME " - " VERSION "\n", con );
+		char buf[80];
+		strerror_s( buf, errno_ );
+		fprintf( con, "%s error: %s\n", fileName, buf );
 		return 1;
 	}
 
@@ -338,67 +978,89 @@ int _tmain(int argc, _TCHAR* argv[])
 
 	//out = fopen( "spo256.out", "w" );
 
-	if ( !waveFileName )
+	NullAudio nullAudioConsumer( rawFileName );
+	AudioTelemetry audioTelemetry;
+
+	if ( !waveFileName && !decleFileName )
 	{
 		systemClock.setClockSpeed( freq );
+		// wake up once per audio block
+		systemClock.setPeriod( outWaveGetBlockTime() );
+		// run unthrottled until the audio queue holds the head start
+		if ( headStart > 0 )
+			systemClock.setBufferLevel( outWaveGetBufferLevel(), headStart * 1000L );
 		systemClock.setSleeper( &sleeper );
 		systemClock.setAutoTurbo( false );
+		if ( nullAudio )
+			outWaveSetConsumer( &nullAudioConsumer );
+		audioTelemetry.setPacer( &systemClock.getPacer() );
+		outWaveSetTelemetry( &audioTelemetry );
 		outWaveInit();
+		if ( nullAudioConsumer.getErrno() )
+		{
+			char buf[80];
+			strerror_s( buf, nullAudioConsumer.getErrno() );
+			printf( "%s error: %s\n", rawFileName, buf );
+			return 1;
+		}
 		outWaveSetClockSpeed( freq );
 		//outWaveSetClockSpeed( 3000 );
 		outWaveReset();
 	}
 
-	if ( model == _AL2 )
-		ivoice_init( sp0256_al2::mask );
-	else if ( model == _012 )
-		ivoice_init( sp0256_012::mask );
+	// decles streamed through the FIFO
+	DecleStream decleStream( inbuf );
+	if ( mode == 'L' )
+		sp0256_setFifoEnabled( 1 );
 
-	while( !eos || !sp0256_halted() )
+	const clock_t startClock = clock();
+	LoopMetrics loopMetrics( metrics );
+
+	// samples rendered up to the next command, consumed one by one;
+	// one at a time in LPC mode to keep the FIFO fed
+	int16_t renderBlock[SP0256_RENDER_BLOCK];
+	int renderPos = 0, renderEnd = 0;
+	const int renderSize = mode == 'L' ? 1 : SP0256_RENDER_BLOCK;
+
+	while( mode == 'P' ? !frameReplay.isDone()
+		: !eos || renderPos < renderEnd || ( bankFileName ? !bankPlayer.isIdle() : !sp0256_halted() ) )
 	{
-		if ( !eos && sp0256_getStatus() ) 
+		// keep the FIFO full
+		if ( mode == 'L' )
+			decleStream.feed();
+
+		if ( !eos && renderPos == renderEnd && ( bankFileName ? bankPlayer.isIdle() : sp0256_getStatus() ) )
 		{
-			std::string sym;
 			switch ( mode )
 			{
 			case 'T':	// Text file mode
-				for(;;)
 				{
-					int c = pistr->get();
-					if ( pistr->eof() )
-					{
+					const int code = tokenizer.next( inbuf );
+					if ( code < 0 )
 						eos = 1;
-						break;
-					}
-					
-					if ( isalnum( c ) )
-					{
-						sym += char( toupper( c ) );
-						const dict_t::const_iterator it = dict.find( sym );
-						if ( it != dict.end() )
-						{
-							al2 = int( it->second );
-							break;
-						}
-					}
 					else
-					{
-						sym = "";
-					}
+						al2 = code;
 				}
 				break;
 			case 'B':	// Binary file mode
-				al2 = pistr->get() & 0x3F;
-				if ( pistr->eof() )
+				al2 = inbuf.sbumpc();
+				if ( al2 == EOF )
 				{
 					eos = 1;
 				}
+				al2 &= 0x3F;
 				break;
 			case 'A':	// Play all sounds/allophones
 				al2 = nAl2++;
 				if ( al2 > codemax )
 					eos = 1;
 				break;
+			case 'L':	// LPC decle stream: run the FIFO until drained
+				if ( decleStream.isDrained() )
+					eos = 1;
+				else
+					al2 = SP0256_FIFO_COMMAND;
+				break;
 			case 'D':	// Demo mode, play sample speech
 			default:
 				al2 = codes[nAl2++];
@@ -408,24 +1070,53 @@ int _tmain(int argc, _TCHAR* argv[])
 			}
 
 			if ( verbose ) {
-				printf( "\t%8d %5d %2d", cnt, cnt-last, al2 );
-				printf( "\t%2d = %5.1f ms - %s\n", preval2, (cnt-last)*1000./freq, sp0256_labels[preval2] );
+				fprintf( con, "\t%8d %5d %2d", cnt, cnt-last, al2 );
+				fprintf( con, "\t%2d = %5.1f ms - %s\n", preval2, (cnt-last)*1000./freq,
+					preval2 <= codemax ? sp0256_labels[preval2] : "FIFO" );
 			}
 
 			if ( !eos )
 			{
 				if ( echo )
-					printf( "%s ", sp0256_labels[al2] );
+					fprintf( con, "%s ", al2 <= codemax ? sp0256_labels[al2] : "FIFO" );
 
 				last = cnt;
 				preval2 = lastal2;
 				lastal2 = al2;
 
-				sp0256_sendCommand( uint32_t( al2 ) );
+				if ( decleFileName )
+					decleWriter.call( al2 );
+				else if ( bankFileName )
+					bankPlayer.play( al2 );
+				else
+					sp0256_sendCommand( uint32_t( al2 ) );
+
+				outWaveMark();
+				loopMetrics.command( cnt, !waveFileName && !decleFileName );
 			}
 		}
 
-		sample = sp0256_getNextSample();
+		// compiling only
+		if ( decleFileName )
+			continue;
+
+		if ( mode == 'P' )
+		{
+			sample = frameReplay.getNextSample();
+		}
+		else if ( bankFileName )
+		{
+			sample = bankPlayer.getNextSample();
+		}
+		else
+		{
+			if ( renderPos == renderEnd )
+			{
+				renderEnd = sp0256_render( renderBlock, renderSize );
+				renderPos = 0;
+			}
+			sample = renderBlock[renderPos++];
+		}
 		bitsSample |= abs( sample );
 		if ( sample < minSample )
 			minSample = sample;
@@ -433,9 +1124,12 @@ int _tmain(int argc, _TCHAR* argv[])
 			maxSample = sample;
 
 		//fprintf( out, "%d\n", sample );
-		sample >>= 8;
-		sample += 0x80;
-		sample &= 0xFF;
+		if ( ( waveTag == WAVE_TAG_PCM && waveBits == 8 ) || !waveFileName )
+		{
+			sample >>= 8;
+			sample += 0x80;
+			sample &= 0xFF;
+		}
 
 		//sample = abs( ( cnt & 0x7F ) - 0x40 ) + 0x60;
 		//sample = abs( ( (cnt<<3) & 0xFF ) - 0x80 ) + 0x40;
@@ -457,19 +1151,96 @@ int _tmain(int argc, _TCHAR* argv[])
 	if ( waveFileName )
 	{
 		waveWriter.close();
+		if ( waveWriter.getErrno() )
+		{
+			char buf[80];
+			strerror_s( buf, waveWriter.getErrno() );
+			fprintf( con, "%s error: %s\n", waveFileName, buf );
+			return 1;
+		}
 	}
-	else
+	else if ( !decleFileName )
 	{
 		outWaveFlush();
 	}
 
+	const double elapsed = double( clock() - startClock ) / CLOCKS_PER_SEC;
+	loopMetrics.end( cnt, !waveFileName && !decleFileName );
+
+	if ( decleFileName )
+	{
+		decleWriter.close();
+		if ( decleWriter.getErrno() )
+		{
+			char buf[80];
+			strerror_s( buf, decleWriter.getErrno() );
+			fprintf( con, "%s error: %s\n", decleFileName, buf );
+			return 1;
+		}
+	}
+
+	if ( frameFileName )
+	{
+		frameRecorder.close();
+		if ( frameRecorder.getErrno() )
+		{
+			char buf[80];
+			strerror_s( buf, frameRecorder.getErrno() );
+			fprintf( con, "%s error: %s\n", frameFileName, buf );
+			return 1;
+		}
+	}
+
+	if ( traceRecord )
+	{
+		sp0256_setTrace( 0 );
+		errno_ = sp0256_traceDump( &trace, traceFileName );
+		if ( errno_ )
+		{
+			char buf[80];
+			strerror_s( buf, errno_ );
+			fprintf( con, "%s error: %s\n", traceFileName, buf );
+			return 1;
+		}
+	}
+
+	// live output summary: tells the synthesis from the output path when the playback glitches
+	if ( !waveFileName && !decleFileName )
+		audioTelemetry.report( con );
+
 	if ( verbose )
 	{
-		printf( "xtal=%d - freq=%d\n", xtal, freq );
-		printf( "numSamples=%d - time=%8.4f s - minSample=%d - maxSample=%d - samplesMask=0x%X\n", cnt, cnt*1./freq, minSample, maxSample, bitsSample );
-		puts( "Finished." );
+		fprintf( con, "xtal=%d - freq=%d\n", xtal, freq );
+		if ( traceRecord )
+			fprintf( con, "traceRecords=%lu - lost=%lu\n", (ulong)trace.head,
+				(ulong)( trace.head > trace.mask + 1 ? trace.head - trace.mask - 1 : 0 ) );
+		if ( frameFileName )
+			fprintf( con, "lpcFrames=%lu - lpcBytes=%lu\n", frameRecorder.getFrames(), frameRecorder.getBytes() );
+		if ( mode == 'P' )
+			fprintf( con, "lpcFrames=%lu\n", frameReplay.getFrames() );
+		if ( decleFileName )
+			fprintf( con, "decles=%lu\n", decleWriter.getDecles() );
+		if ( mode == 'L' )
+			fprintf( con, "decles=%lu - fifoFullWaits=%lu - fifoStalls=%lu - %.3f s - %.0f decles/s\n",
+				decleStream.getDecles(), decleStream.getFullWaits(), sp0256_getFifoStalls(),
+				elapsed, elapsed > 0 ? decleStream.getDecles() / elapsed : 0. );
+		fprintf( con, "numSamples=%d - time=%8.4f s - minSample=%d - maxSample=%d - samplesMask=0x%X\n", cnt, cnt*1./freq, minSample, maxSample, bitsSample );
+		if ( !decleFileName && !bankFileName && mode != 'P' )
+			printCounters( con, commandCounters, sp0256_labels, codemax );
+		if ( !waveFileName && !decleFileName )
+		{
+			ulong blocks, underruns, waits;
+			outWaveGetStats( blocks, underruns, waits );
+			printf( "audioBlocks=%lu - underruns=%lu - producerWaits=%lu\n", blocks, underruns, waits );
+			const DeadlinePacer &pacer = systemClock.getPacer();
+			printf( "pacerPeriods=%lu - jitter mean=%.3f max=%.3f sd=%.3f ms - drift=%.3f max=%.3f ms - resyncs=%lu\n",
+				pacer.getPeriods(), pacer.getJitterMean() / 1e6, pacer.getJitterMax() / 1e6, pacer.getJitterStdDev() / 1e6,
+				pacer.getDrift() / 1e6, pacer.getMaxDrift() / 1e6, pacer.getResyncs() );
+			printf( "headStart=%d ms - turboPeriods=%lu\n", headStart, systemClock.getTurboPeriods() );
+		}
+		fputs( "Finished.\n", con );
 #if _DEBUG
-		printf( "[__cplusplus=%ldL]\n", __cplusplus );
+		fprintf( con, "[__cplusplus=%ldL]\n", __cplusplus );
 #endif
 	}
 
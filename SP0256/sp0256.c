@@ -45,40 +45,13 @@
 #define dfprintf(x)
 #endif
 
-static int s_debugSample = 0;
-
-#if 1
-#define dsprintf(x) if( s_debugSample ) { jzp_printf x ; jzp_flush(); }
-#else
-#undef DEBUG_SAMPLE
-//#define DEBUG_SAMPLE
-#ifdef DEBUG_SAMPLE
-#define dsprintf(x) jzp_printf x ; jzp_flush()
-#else
-#define dsprintf(x)
-#endif
-#endif
-
-static int s_debug = 0;
-
-#if 1
-#define jzdprintf(x) if( s_debug ) { jzp_printf x ; jzp_flush(); }
-#else
-#undef DEBUG
-#define DEBUG
-#ifdef DEBUG
-#define jzdprintf(x) jzp_printf x ; jzp_flush()
-#else
-#define jzdprintf(x)
-#endif
-#endif
-
 static int s_debugSingleStep = 0;
 
 #define PER_PAUSE    (64)               /* Equiv timing period for pauses.  */
 #define PER_NOISE    (64)               /* Equiv timing period for noise.   */
 
 #define FIFO_ADDR    (0x1800 << 3)      /* SP0256 address of speech FIFO.   */
+#define FIFO_STALL   (16)               /* Decles needed for an instruction.*/
 
 #include <assert.h>
 #include <stdio.h>
@@ -92,8 +65,11 @@ static int s_debugSingleStep = 0;
 
 ivoice_t intellivoice;
 
-static int fifoEnabled = 0;
-static long nSample = 0;
+/* Live ring of the debug modes (-d), see sp0256_setDebug()               */
+#define DEBUG_RECORDS	16
+static sp0256_traceRecord_t s_debugRecords[DEBUG_RECORDS];
+static sp0256_trace_t s_debugTrace;
+
 static int s_nLabels = 0;
 static const char* *s_labels = 0;
 
@@ -124,7 +100,7 @@ static INLINE uint32_t bitrev(uint32_t val);
 static int             lpc12_update(lpc12_t *f, int, int16_t *, uint32_t *);
 static void            lpc12_regdec(lpc12_t *f);
 static uint32_t        sp0256_getb(ivoice_t *ivoice, int len);
-static void            sp0256_micro(ivoice_t *iv);
+static void            sp0256_countCommand(ivoice_t *iv, int cmd);
 
 /* ======================================================================== */
 /*  IVOICE_QTBL  -- Coefficient Quantization Table.  This comes from a      */
@@ -702,6 +678,8 @@ static uint32_t sp0256_getb(ivoice_t *ivoice, int len)
     /* -------------------------------------------------------------------- */
     if (ivoice->fifo_sel)
     {
+        ++ivoice->counters.fifo_fetches;
+
         d0 = ivoice->fifo[(ivoice->fifo_tail    ) & 63];
         d1 = ivoice->fifo[(ivoice->fifo_tail + 1) & 63];
 
@@ -733,6 +711,8 @@ static uint32_t sp0256_getb(ivoice_t *ivoice, int len)
         int idx0 = (ivoice->pc    ) >> 3, page0 = idx0 >> 12;
         int idx1 = (ivoice->pc + 8) >> 3, page1 = idx1 >> 12;
 
+        ++ivoice->counters.rom_fetches;
+
         idx0 &= 0xFFF;
         idx1 &= 0xFFF;
 
@@ -755,395 +735,33 @@ static uint32_t sp0256_getb(ivoice_t *ivoice, int len)
 }
 
 /* ======================================================================== */
-/*  SP0256_MICRO -- Emulate the microsequencer in the SP0256.  Executes     */
-/*                  instructions either until the repeat count != 0 or      */
-/*                  the sequencer gets halted by a RTS to 0.                */
+/*  Micro-sequencer and sample loop, without and with the trace sites.      */
 /* ======================================================================== */
-static void sp0256_micro(ivoice_t *iv)
-{
-    uint8_t  immed4;
-    uint8_t  opcode;
-    uint16_t cr;
-    int      ctrl_xfer = 0;
-    int      repeat    = 0;
-    int      i, idx0, idx1;
-
-    /* -------------------------------------------------------------------- */
-    /*  Only execute instructions while the filter is not busy.             */
-    /* -------------------------------------------------------------------- */
-    while (iv->filt.rpt <= 0 && iv->filt.cnt <= 0)
-    {
-        /* ---------------------------------------------------------------- */
-        /*  If the CPU is halted, see if we have a new command pending      */
-        /*  in the Address LoaD buffer.                                     */
-        /* ---------------------------------------------------------------- */
-        if (iv->halted && !iv->lrq)
-        {
-			int data = iv->ald >> 4;
-			jzdprintf(( "\nfetch => %02X: %s\n", data, data < s_nLabels ? s_labels[data] : "---" ));
-            iv->pc       = iv->ald | (0x1000 << 3);
-            iv->fifo_sel = 0;
-            iv->halted   = 0;
-            iv->lrq      = 0x8000;
-            iv->ald      = 0;
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  If we're still halted, do nothing.                              */
-        /* ---------------------------------------------------------------- */
-        if (iv->halted)
-        {
-			jzdprintf(( "\nfetch => HALT\n" ));
-            iv->filt.rpt = 1;
-            iv->filt.cnt = 0;
-            iv->lrq      = 0x8000;
-            iv->ald      = 0;
-            return;
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  Fetch the first 8 bits of the opcode, which are always in the   */
-        /*  same approximate format -- immed4 followed by opcode.           */
-        /* ---------------------------------------------------------------- */
-        immed4 = (uint8_t)sp0256_getb(iv, 4);
-        opcode = (uint8_t)sp0256_getb(iv, 4);
-        repeat = 0;
-        ctrl_xfer = 0;
-
-        jzdprintf(("$%.4X.%.1X: OPCODE %d%d%d%d.%d%d - %s\n",
-                (iv->pc >> 3) - 1, iv->pc & 7,
-                !!(opcode & 1), !!(opcode & 2),
-                !!(opcode & 4), !!(opcode & 8),
-                !!(iv->mode&4), !!(iv->mode&2),
-				opcodes[opcode&15]
-				));
-
-        /* ---------------------------------------------------------------- */
-        /*  Handle the special cases for specific opcodes.                  */
-        /* ---------------------------------------------------------------- */
-        switch (opcode)
-        {
-            /* ------------------------------------------------------------ */
-            /*  OPCODE 0000:  RTS / SETPAGE                                 */
-            /* ------------------------------------------------------------ */
-            case 0x0:
-            {
-                /* -------------------------------------------------------- */
-                /*  If immed4 != 0, then this is a SETPAGE instruction.     */
-                /* -------------------------------------------------------- */
-                if (immed4)     /* SETPAGE */
-                {
-                    iv->page = bitrev(immed4) >> 13;
-                } else
-                /* -------------------------------------------------------- */
-                /*  Otherwise, this is an RTS / HLT.                        */
-                /* -------------------------------------------------------- */
-                {
-                    uint32_t btrg;
-
-                    /* ---------------------------------------------------- */
-                    /*  Figure out our branch target.                       */
-                    /* ---------------------------------------------------- */
-                    btrg = iv->stack;
-
-                    iv->stack = 0;
-
-                    /* ---------------------------------------------------- */
-                    /*  If the branch target is zero, this is a HLT.        */
-                    /*  Otherwise, it's an RTS, so set the PC.              */
-                    /* ---------------------------------------------------- */
-                    if (!btrg)
-                    {
-                        iv->halted = 1;
-                        iv->pc     = 0;
-                        ctrl_xfer  = 1;
-                    } else
-                    {
-                        iv->pc    = btrg;
-                        ctrl_xfer = 1;
-                    }
-                }
-
-                break;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  OPCODE 0111:  JMP          Jump to 12-bit/16-bit Abs Addr   */
-            /*  OPCODE 1011:  JSR          Jump to Subroutine               */
-            /* ------------------------------------------------------------ */
-            case 0xE:
-            case 0xD:
-            {
-                int btrg;
-
-                /* -------------------------------------------------------- */
-                /*  Figure out our branch target.                           */
-                /* -------------------------------------------------------- */
-                btrg = iv->page                           |
-                       (bitrev(immed4)             >> 17) |
-                       (bitrev(sp0256_getb(iv, 8)) >> 21);
-                ctrl_xfer = 1;
-
-                /* -------------------------------------------------------- */
-                /*  If this is a JSR, push our return address on the        */
-                /*  stack.  Make sure it's byte aligned.                    */
-                /* -------------------------------------------------------- */
-                if (opcode == 0xD)
-                    iv->stack = (iv->pc + 7) & ~7;
-
-                /* -------------------------------------------------------- */
-                /*  Jump to the new location!                               */
-                /* -------------------------------------------------------- */
-                iv->pc = btrg;
-                break;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  OPCODE 1000:  SETMODE      Set the Mode and Repeat MSBs     */
-            /* ------------------------------------------------------------ */
-            case 0x1:
-            {
-                iv->mode = ((immed4 & 8) >> 2) | (immed4 & 4) |
-                           ((immed4 & 3) << 4);
-                break;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  OPCODE 0001:  LOADALL      Load All Parameters              */
-            /*  OPCODE 0010:  LOAD_2       Load Per, Ampl, Coefs, Interp.   */
-            /*  OPCODE 0011:  SETMSB_3     Load Pitch, Ampl, MSBs, & Intrp  */
-            /*  OPCODE 0100:  LOAD_4       Load Pitch, Ampl, Coeffs         */
-            /*  OPCODE 0101:  SETMSB_5     Load Pitch, Ampl, and Coeff MSBs */
-            /*  OPCODE 0110:  SETMSB_6     Load Ampl, and Coeff MSBs.       */
-            /*  OPCODE 1001:  DELTA_9      Delta update Ampl, Pitch, Coeffs */
-            /*  OPCODE 1010:  SETMSB_A     Load Ampl and MSBs of 3 Coeffs   */
-            /*  OPCODE 1100:  LOAD_C       Load Pitch, Ampl, Coeffs         */
-            /*  OPCODE 1101:  DELTA_D      Delta update Ampl, Pitch, Coeffs */
-            /*  OPCODE 1110:  LOAD_E       Load Pitch, Amplitude            */
-            /*  OPCODE 1111:  PAUSE        Silent pause                     */
-            /* ------------------------------------------------------------ */
-            default:
-            {
-                repeat    = immed4 | (iv->mode & 0x30);
-                break;
-            }
-        }
-        if (opcode != 1) // SETMODE
-			iv->mode &= 0xF;
-
-        /* ---------------------------------------------------------------- */
-        /*  If this was a control transfer, handle setting "fifo_sel"       */
-        /*  and all that ugliness.                                          */
-        /* ---------------------------------------------------------------- */
-        if (ctrl_xfer)
-        {
-            jzdprintf(("jumping to $%.4X.%.1X: ", iv->pc >> 3, iv->pc & 7));
-
-            /* ------------------------------------------------------------ */
-            /*  Set our "FIFO Selected" flag based on whether we're going   */
-            /*  to the FIFO's address.                                      */
-            /* ------------------------------------------------------------ */
-            iv->fifo_sel = fifoEnabled && ( iv->pc == FIFO_ADDR );
-
-            jzdprintf(("%s ", iv->fifo_sel ? "FIFO" : "ROM"));
-
-            /* ------------------------------------------------------------ */
-            /*  Control transfers to the FIFO cause it to discard the       */
-            /*  partial decle that's at the front of the FIFO.              */
-            /* ------------------------------------------------------------ */
-            if (iv->fifo_sel && iv->fifo_bitp)
-            {
-                jzdprintf(("bitp = %d -> Flush", iv->fifo_bitp));
-
-                /* Discard partially-read decle. */
-                if (iv->fifo_tail < iv->fifo_head) iv->fifo_tail++;
-                iv->fifo_bitp = 0;
-            }
-
-            jzdprintf(("\n"));
-
-            continue;
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  Otherwise, if we have a repeat count, then go grab the data     */
-        /*  block and feed it to the filter.                                */
-        /* ---------------------------------------------------------------- */
-        if (!repeat)
-			continue;
-
-
-		if ( s_debugSingleStep )
-		{
-			jzp_printf("NEXT:"); jzp_flush();
-        {
-        char buf[1024];
-				fgets(buf,sizeof(buf),stdin); // if (opcode != 0xF) repeat <<= 3;
-				if ( toupper(*buf) == 'C' ) // (C)ontinue
-					s_debugSingleStep = 0;
-			}
-        }
-
-        iv->filt.rpt = repeat;
-        jzdprintf(("repeat = %d\n", repeat));
-
-        /* clear delay line on new opcode */
-        for (i = 0; i < 6; i++)
-             iv->filt.z_data[i][0] = iv->filt.z_data[i][1] = 0;
-
-        i = (opcode << 3) | (iv->mode & 6);
-        idx0 = sp0256_df_idx[i++];
-        idx1 = sp0256_df_idx[i  ];
-
-        assert(idx0 >= 0 && idx1 >= 0 && idx1 >= idx0);
-
-        /* ---------------------------------------------------------------- */
-        /*  If we're in one of the 10-pole modes (x0), clear F5/B5.         */
-        /* ---------------------------------------------------------------- */
-        if ((iv->mode & 2) == 0)
-            iv->filt.r[F5] = iv->filt.r[B5] = 0;
-
-
-        /* ---------------------------------------------------------------- */
-        /*  Step through control words in the description for data block.   */
-        /* ---------------------------------------------------------------- */
-        for (i = idx0; i <= idx1; i++)
-        {
-            int len, shf, delta, field, prm, clrL;
-            int8_t value;
-
-            /* ------------------------------------------------------------ */
-            /*  Get the control word and pull out some important fields.    */
-            /* ------------------------------------------------------------ */
-            cr = sp0256_datafmt[i];
-
-            len   = CR_LEN(cr);
-            shf   = CR_SHF(cr);
-            prm   = CR_PRM(cr);
-            clrL  = cr & CR_CLRL;
-            delta = cr & CR_DELTA;
-            field = cr & CR_FIELD;
-            value = 0;
-
-            jzdprintf(("$%.4X.%.1X: len=%2d shf=%2d prm=%2d d=%d f=%d ",
-                     iv->pc >> 3, iv->pc & 7, len, shf, prm, !!delta, !!field));
-            /* ------------------------------------------------------------ */
-            /*  Clear any registers that were requested to be cleared.      */
-            /* ------------------------------------------------------------ */
-            if (clrL)
-            {
-                iv->filt.r[F0] = iv->filt.r[B0] = 0;
-                iv->filt.r[F1] = iv->filt.r[B1] = 0;
-                iv->filt.r[F2] = iv->filt.r[B2] = 0;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  If this entry has a bitfield with it, grab the bitfield.    */
-            /* ------------------------------------------------------------ */
-            if (len)
-            {
-                value = (int8_t)sp0256_getb(iv, len);
-            }
-            else
-            {
-                jzdprintf((" (no update)\n"));
-                continue;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  Sign extend if this is a delta update.                      */
-            /* ------------------------------------------------------------ */
-            if (delta)  /* Sign extend */
-            {
-                if (value & (1u << (len - 1))) value |= -(int)(1u << len);
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  Shift the value to the appropriate precision.               */
-            /* ------------------------------------------------------------ */
-            if (shf)
-                value = value < 0 ? -(-value << shf) : (value << shf);
-
-            jzdprintf(("v=%.2X (%c%.2X)  ", value & 0xFF,
-                     value & 0x80 ? '-' : '+',
-                     0xFF & (value & 0x80 ? -value : value)));
-
-            iv->silent = 0;
-
-            /* ------------------------------------------------------------ */
-            /*  If this is a field-replace, insert the field.               */
-            /* ------------------------------------------------------------ */
-            if (field)
-            {
-                jzdprintf(("--field-> r[%2d] = %.2X -> ", prm, iv->filt.r[prm]));
-
-                iv->filt.r[prm] &= ~(~0u << shf); /* Clear the old bits.    */
-                iv->filt.r[prm] |= value;         /* Merge in the new bits. */
-
-                jzdprintf(("%.2X\n", iv->filt.r[prm]));
-
-                continue;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  If this is a delta update, add to the appropriate field.    */
-            /* ------------------------------------------------------------ */
-            if (delta)
-            {
-                jzdprintf(("--delta-> r[%2d] = %.2X -> ", prm, iv->filt.r[prm]));
-
-                iv->filt.r[prm] += value;
-
-                jzdprintf(("%.2X\n", iv->filt.r[prm]));
-
-                continue;
-            }
-
-            /* ------------------------------------------------------------ */
-            /*  Otherwise, just write the new value.                        */
-            /* ------------------------------------------------------------ */
-            iv->filt.r[prm] = value;
-            jzdprintf(("--value-> r[%2d] = %.2X\n", prm, iv->filt.r[prm]));
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  Most opcodes clear IA, IP.                                      */
-        /* ---------------------------------------------------------------- */
-        if (opcode != 0x1 && opcode != 0x2 && opcode != 0x3)
-        {
-            iv->filt.r[IA] = 0;
-            iv->filt.r[IP] = 0;
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  Special case:  Set PAUSE's equivalent period.                   */
-        /* ---------------------------------------------------------------- */
-        if (opcode == 0xF)
-        {
-            iv->silent     = 1;
-            iv->filt.r[AM] = 0;
-            iv->filt.r[PR] = PER_PAUSE;
-        }
-
-        /* ---------------------------------------------------------------- */
-        /*  Now that we've updated the registers, go decode them.           */
-        /* ---------------------------------------------------------------- */
-        lpc12_regdec(&iv->filt);
-
-        /* ---------------------------------------------------------------- */
-        /*  Break out since we now have a repeat count.                     */
-        /* ---------------------------------------------------------------- */
-        break;
-    }
-}
+#define SP0256_TRACED       0
+#define SP0256_MICRO        sp0256_micro
+#define SP0256_NEXT_SAMPLE  sp0256_nextSample
+#define SP0256_RENDER       sp0256_renderBlock
+#include "sp0256_micro.h"
+#undef SP0256_TRACED
+#undef SP0256_MICRO
+#undef SP0256_NEXT_SAMPLE
+#undef SP0256_RENDER
+
+#define SP0256_TRACED       1
+#define SP0256_MICRO        sp0256_microTraced
+#define SP0256_NEXT_SAMPLE  sp0256_nextSampleTraced
+#define SP0256_RENDER       sp0256_renderBlockTraced
+#include "sp0256_micro.h"
+#undef SP0256_TRACED
+#undef SP0256_MICRO
+#undef SP0256_NEXT_SAMPLE
+#undef SP0256_RENDER
 
 /* ======================================================================== */
 /*  IVOICE_RD    -- Handle reads from the Intellivoice.                     */
 /* ======================================================================== */
-uint32_t ivoice_rd(uint32_t addr)
+static uint32_t ivoice_read(ivoice_t *ivoice, uint32_t addr)
 {
-    ivoice_t *ivoice = &intellivoice;
-
     /* -------------------------------------------------------------------- */
     /*  Address 0x80 returns the SP0256 LRQ status on bit 15.               */
     /* -------------------------------------------------------------------- */
@@ -1169,10 +787,8 @@ uint32_t ivoice_rd(uint32_t addr)
 /* ======================================================================== */
 /*  IVOICE_WR    -- Handle writes to the Intellivoice.                      */
 /* ======================================================================== */
-void ivoice_wr(uint32_t addr, uint32_t data)
+static void ivoice_write(ivoice_t *ivoice, uint32_t addr, uint32_t data)
 {
-    ivoice_t *ivoice = &intellivoice;
-
     /* -------------------------------------------------------------------- */
     /*  Ignore writes outside 0x80, 0x81.                                   */
     /* -------------------------------------------------------------------- */
@@ -1234,7 +850,8 @@ void ivoice_wr(uint32_t addr, uint32_t data)
         /* ---------------------------------------------------------------- */
         if ((ivoice->fifo_head - ivoice->fifo_tail) >= 64)
         {
-            jzdprintf(("IV: Dropped FIFO write\n"));
+            if (ivoice->trace && (ivoice->trace->flags & SP0256_TRACE_MICRO))
+                sp0256_traceWrite(ivoice->trace, SP0256_EV_DROP, 0, 0, 0);
             return;
         }
 
@@ -1251,6 +868,16 @@ void ivoice_wr(uint32_t addr, uint32_t data)
     }
 }
 
+uint32_t ivoice_rd(uint32_t addr)
+{
+    return ivoice_read(&intellivoice, addr);
+}
+
+void ivoice_wr(uint32_t addr, uint32_t data)
+{
+    ivoice_write(&intellivoice, addr, data);
+}
+
 /* ======================================================================== */
 /*  IVOICE_RESET -- Resets the Intellivoice                                 */
 /* ======================================================================== */
@@ -1271,8 +898,20 @@ int ivoice_init
 	const uint8_t			*mask
 )
 {
-    ivoice_t *ivoice = &intellivoice;
+    int ret = sp0256_voiceInit(&intellivoice, mask);
 
+    /* The debug modes may be set before the init */
+    if ( s_debugTrace.flags )
+        intellivoice.trace = &s_debugTrace;
+    return ret;
+}
+
+int sp0256_voiceInit
+(
+	ivoice_t				*ivoice,
+	const uint8_t			*mask
+)
+{
     /* -------------------------------------------------------------------- */
     /*  First, lets zero out the structure to be safe.                      */
     /* -------------------------------------------------------------------- */
@@ -1292,6 +931,7 @@ int ivoice_init
     ivoice->lrq      = 0x8000;
     ivoice->page     = 0x1000 << 3;
     ivoice->silent   = 1;
+    ivoice->cmd      = SP0256_COUNTERS_HALT;
 
     return 0;
 }
@@ -1300,21 +940,71 @@ int ivoice_init
 
 void sp0256_setFifoEnabled( int enabled )
 {
+	intellivoice.fifo_enabled = enabled;
+}
+
+int sp0256_isFifoFull()
+{
+	return ( ivoice_rd( 1 ) & 0x8000 ) != 0;
+}
+
+int sp0256_getFifoLevel()
+{
+	return intellivoice.fifo_head - intellivoice.fifo_tail;
+}
+
+void sp0256_pushDecle( uint32_t decle )
+{
+	ivoice_wr( 1, decle & 0x3FF );
+}
+
+void sp0256_setFifoEnd( int end )
+{
+	intellivoice.fifo_end = end;
+}
+
+unsigned long sp0256_getFifoStalls()
+{
+	return intellivoice.fifo_stalls;
 }
 
 uint32_t sp0256_getStatus()
 {
-    return ivoice_rd( 0 );
+    return sp0256_voiceGetStatus( &intellivoice );
 }
 
 int sp0256_halted()
 {
-	return intellivoice.halted;
+	return sp0256_voiceHalted( &intellivoice );
 }
 
 void sp0256_sendCommand( uint32_t cmd )
 {
-	ivoice_wr( 0, cmd );
+	sp0256_voiceSendCommand( &intellivoice, cmd );
+}
+
+uint32_t sp0256_voiceGetStatus( ivoice_t *ivoice )
+{
+    return ivoice_read( ivoice, 0 );
+}
+
+int sp0256_voiceHalted( ivoice_t *ivoice )
+{
+	return ivoice->halted;
+}
+
+void sp0256_voiceSendCommand( ivoice_t *ivoice, uint32_t cmd )
+{
+	if ( cmd != SP0256_FIFO_COMMAND )
+	{
+		ivoice_write( ivoice, 0, cmd );
+	}
+	else if ( ivoice->lrq )
+	{
+		/* Address LoaD of the FIFO */
+		ivoice->lrq = 0;
+		ivoice->ald = FIFO_ADDR - ( 0x1000 << 3 );
+	}
 }
 
 
@@ -1328,28 +1018,28 @@ int sp0256_isNextSample()
 
 int sp0256_getNextSample()
 {
-    ivoice_t *ivoice = &intellivoice;
-	uint32_t optr = 0;
-	int16_t out = 0;
-
-	if (ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0)
-        sp0256_micro(ivoice);
+	return sp0256_voiceGetNextSample( &intellivoice );
+}
 
-	if  (	ivoice->halted
-		||	( ivoice->silent && ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0 )
-		)
-	{
-		out = 0;
-    }
-	else
-	{
-		lpc12_update(&ivoice->filt, 1, &out, &optr);
-    }
+int sp0256_voiceGetNextSample( ivoice_t *ivoice )
+{
+	/* the traced variant only while tracing or single-stepping */
+	if ( ivoice->trace || s_debugSingleStep )
+		return sp0256_nextSampleTraced( ivoice );
+	return sp0256_nextSample( ivoice );
+}
 
-	//dsprintf(( "%d\t%d\n", nSample++, (int8_t)(out >> 8) ));
-	dsprintf(( "%ld\t%4d\t%*c\n", nSample++, (int8_t)(out >> 8), (int8_t)(out >> 9)+64, '+' ));
+int sp0256_render( int16_t *out, int n )
+{
+	return sp0256_voiceRender( &intellivoice, out, n );
+}
 
-	return out;
+int sp0256_voiceRender( ivoice_t *ivoice, int16_t *out, int n )
+{
+	/* the variant is selected once per block */
+	if ( ivoice->trace || s_debugSingleStep )
+		return sp0256_renderBlockTraced( ivoice, out, n );
+	return sp0256_renderBlock( ivoice, out, n );
 }
 
 int sp0256_exec()
@@ -1360,7 +1050,12 @@ int sp0256_exec()
     /*  If our repeat count expired, emulate the microsequencer.    */
     /* ------------------------------------------------------------ */
     if (ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0)
-        sp0256_micro(ivoice);
+    {
+        if (ivoice->trace || s_debugSingleStep)
+            sp0256_microTraced(ivoice);
+        else
+            sp0256_micro(ivoice);
+    }
 
 	return 0;
 }
@@ -1371,13 +1066,144 @@ void sp0256_setLabels( int nLabels, const char *labels[] )
 	s_labels = labels;
 }
 
+/* Live ring of the debug modes: prints each record                     */
+static void sp0256_debugSink( void *param, const sp0256_traceRecord_t *record )
+{
+	char text[SP0256_TRACE_TEXT];
+
+	sp0256_traceFormat( record, s_nLabels, s_labels, text );
+	jzp_printf( "%s", text );
+	jzp_flush();
+}
+
 void sp0256_setDebug( int debug )
 {
-	s_debug = debug & 1;
-	s_debugSample = debug & 2;
+	s_debugTrace.records = s_debugRecords;
+	s_debugTrace.mask = DEBUG_RECORDS - 1;
+	s_debugTrace.flags = debug & ( SP0256_TRACE_MICRO | SP0256_TRACE_SAMPLES );
+	s_debugTrace.sink = sp0256_debugSink;
+	intellivoice.trace = s_debugTrace.flags ? &s_debugTrace : 0;
 	s_debugSingleStep = debug & 4;
 }
 
+void sp0256_setTrace( sp0256_trace_t *trace )
+{
+	intellivoice.trace = trace;
+}
+
+void sp0256_voiceSetTrace( ivoice_t *ivoice, sp0256_trace_t *trace )
+{
+	ivoice->trace = trace;
+}
+
+void sp0256_setFrameRecorder( sp0256_frameRecorder_t recorder, void *param )
+{
+	intellivoice.recorder = recorder;
+	intellivoice.recorder_param = param;
+}
+
+void sp0256_replayInit( lpc12_t *filt )
+{
+	memset( filt, 0, sizeof( lpc12_t ) );
+	filt->rng = 1;
+	filt->rpt = -1;
+}
+
+void sp0256_replayFrame( lpc12_t *filt, const uint8_t *r, int rpt )
+{
+	int i;
+
+	/* same as sp0256_micro: new repeat count, clear delay line, decode */
+	memcpy( filt->r, r, sizeof( filt->r ) );
+	filt->rpt = rpt;
+	for ( i = 0; i < 6; i++ )
+		filt->z_data[i][0] = filt->z_data[i][1] = 0;
+	lpc12_regdec( filt );
+}
+
+int sp0256_replaySample( lpc12_t *filt, int silent )
+{
+	uint32_t optr = 0;
+	int16_t out = 0;
+
+	if ( !silent || filt->rpt > 0 || filt->cnt > 0 )
+		lpc12_update( filt, 1, &out, &optr );
+
+	return out;
+}
+
+int sp0256_filterUpdate( lpc12_t *filt, int num_samp, int16_t *out )
+{
+	uint32_t optr = 0;
+
+	return lpc12_update( filt, num_samp, out, &optr );
+}
+
+uint32_t sp0256_voiceGetBits( ivoice_t *ivoice, int len )
+{
+	return sp0256_getb( ivoice, len );
+}
+
+void sp0256_voiceMicro( ivoice_t *ivoice )
+{
+	sp0256_micro( ivoice );
+}
+
+/* Close the counters of the current command, and open the next one */
+static void sp0256_countCommand( ivoice_t *iv, int cmd )
+{
+	if ( iv->cmd_counters )
+	{
+		const unsigned long *now = (const unsigned long *)&iv->counters;
+		const unsigned long *start = (const unsigned long *)&iv->cmd_start;
+		unsigned long *slot = (unsigned long *)&iv->cmd_counters[iv->cmd];
+		size_t i;
+
+		for ( i = 0; i < sizeof( sp0256_counters_t ) / sizeof( unsigned long ); ++i )
+			slot[i] += now[i] - start[i];
+	}
+	iv->cmd_start = iv->counters;
+	iv->cmd = cmd;
+}
+
+void sp0256_getCounters( sp0256_counters_t *counters )
+{
+	sp0256_voiceGetCounters( &intellivoice, counters );
+}
+
+void sp0256_setCommandCounters( sp0256_counters_t *table )
+{
+	sp0256_voiceSetCommandCounters( &intellivoice, table );
+}
+
+void sp0256_resetCounters()
+{
+	sp0256_voiceResetCounters( &intellivoice );
+}
+
+void sp0256_voiceGetCounters( ivoice_t *ivoice, sp0256_counters_t *counters )
+{
+	sp0256_countCommand( ivoice, ivoice->cmd );
+	*counters = ivoice->counters;
+}
+
+void sp0256_voiceSetCommandCounters( ivoice_t *ivoice, sp0256_counters_t *table )
+{
+	sp0256_countCommand( ivoice, ivoice->cmd );
+	ivoice->cmd_counters = table;
+}
+
+void sp0256_voiceResetCounters( ivoice_t *ivoice )
+{
+	memset( &ivoice->counters, 0, sizeof( sp0256_counters_t ) );
+	memset( &ivoice->cmd_start, 0, sizeof( sp0256_counters_t ) );
+}
+
+const char *sp0256_getOpcodeName( int opcode )
+{
+	return opcodes[opcode & 15];
+}
+
 // END   GmEsoft additions
 
 /* ======================================================================== */
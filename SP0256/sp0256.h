@@ -20,6 +20,7 @@ extern "C" {
 #define INTV	0
 
 #include "types.h"
+#include "sp0256_trace.h"
 //#define AUDIO_FREQUENCY     22000
 #define INLINE __inline
 
@@ -42,6 +43,23 @@ typedef struct lpc12_t
 } lpc12_t;
 
 
+/* LPC frame recorder hook, see sp0256_setFrameRecorder()                */
+typedef void (*sp0256_frameRecorder_t)( void *param, const lpc12_t *filt, int flags );
+
+/* Instrumentation counters, see sp0256_voiceGetCounters()              */
+typedef struct sp0256_counters_t
+{
+    unsigned long opcodes[16];  /* Instructions executed, by opcode         */
+    unsigned long repeats;      /* Repeat blocks fed to the filter          */
+    unsigned long interps;      /* Interpolation updates                    */
+    unsigned long voiced;       /* Samples rendered: voiced                 */
+    unsigned long noise;        /* Samples rendered: noise                  */
+    unsigned long pause;        /* Samples rendered: pause                  */
+    unsigned long halted;       /* Samples rendered: halted                 */
+    unsigned long rom_fetches;  /* Bit fields fetched from the ROM          */
+    unsigned long fifo_fetches; /* Bit fields fetched from the FIFO         */
+} sp0256_counters_t;
+
 typedef struct ivoice_t
 {
     uint64_t    now;
@@ -71,6 +89,20 @@ typedef struct ivoice_t
     int16_t    *cur_buf;    /* Current sound buffer.                        */
 #endif
 	const uint8_t *rom[16]; /* 4K ROM pages.                                */
+
+    int         fifo_enabled; /* SPB640 FIFO enabled.                       */
+    int         fifo_end;   /* No more decles: drain the FIFO.              */
+    unsigned long fifo_stalls; /* Instruction fetches waiting for decles.   */
+
+    sp0256_frameRecorder_t recorder;    /* LPC frame recorder hook.         */
+    void       *recorder_param;
+
+    sp0256_counters_t counters;         /* Instrumentation counters.        */
+    sp0256_counters_t cmd_start;        /* Counters at the command start.   */
+    sp0256_counters_t *cmd_counters;    /* Counters by command, or 0.       */
+    int         cmd;        /* Command being executed (counters slot).      */
+
+    sp0256_trace_t *trace;  /* Binary trace ring, or 0.                     */
 } ivoice_t;
 
 
@@ -96,14 +128,80 @@ void sp0256_setFifoEnabled( int enabled );
 uint32_t sp0256_getStatus();
 int sp0256_halted();
 void sp0256_sendCommand( uint32_t cmd );
+
+/* SPB640 FIFO: with the FIFO enabled, this command runs the decles pushed */
+/* in the FIFO, until a HLT, or until the FIFO is empty at the end.        */
+#define SP0256_FIFO_COMMAND	0x100
+
+int sp0256_isFifoFull();
+int sp0256_getFifoLevel();
+void sp0256_pushDecle( uint32_t decle );
+void sp0256_setFifoEnd( int end );
+unsigned long sp0256_getFifoStalls();
 /*
 int sp0256_isNextSample();
 */
 int sp0256_getNextSample();
+
+/* Render up to n samples, until the sample that raises the LRQ or halts   */
+/* the voice, i.e. until the next command can be sent; returns the number  */
+/* of samples rendered. The traced variant is selected once per block.     */
+int sp0256_render( int16_t *out, int n );
+
+/* Block size of the callers of sp0256_render()                           */
+#define SP0256_RENDER_BLOCK	256
+
+/* Independent instances, for concurrent synthesizers. The functions      */
+/* above operate on the default instance.                                 */
+int sp0256_voiceInit( ivoice_t *ivoice, const uint8_t *mask );
+uint32_t sp0256_voiceGetStatus( ivoice_t *ivoice );
+int sp0256_voiceHalted( ivoice_t *ivoice );
+void sp0256_voiceSendCommand( ivoice_t *ivoice, uint32_t cmd );
+int sp0256_voiceGetNextSample( ivoice_t *ivoice );
+int sp0256_voiceRender( ivoice_t *ivoice, int16_t *out, int n );
 int sp0256_exec();
 void sp0256_setLabels( int nLabels, const char *labels[] );
 void sp0256_setDebug( int debug );
 
+/* LPC frame stream: each micro-sequencer exit, i.e. a decoded register   */
+/* set with its repeat count, or the halt at the end of the speech.       */
+#define SP0256_FRAME_SILENT	0x40	/* Pause: no filter output            */
+#define SP0256_FRAME_START	0x80	/* First frame of a new command       */
+#define SP0256_FRAME_HALT	0x100	/* Halted: no register set            */
+
+void sp0256_setFrameRecorder( sp0256_frameRecorder_t recorder, void *param );
+
+/* Frame replay, on a filter independent of the micro-sequencer           */
+void sp0256_replayInit( lpc12_t *filt );
+void sp0256_replayFrame( lpc12_t *filt, const uint8_t *r, int rpt );
+int sp0256_replaySample( lpc12_t *filt, int silent );
+
+/* Instrumentation counters: aggregated, and by command if a table of    */
+/* SP0256_NCOUNTERS entries is set: the ROM commands, then the FIFO and   */
+/* the halted time. Getting the counters brings the table up to date.     */
+#define SP0256_COUNTERS_FIFO	0x100
+#define SP0256_COUNTERS_HALT	0x101
+#define SP0256_NCOUNTERS		0x102
+
+void sp0256_getCounters( sp0256_counters_t *counters );
+void sp0256_setCommandCounters( sp0256_counters_t *table );
+void sp0256_resetCounters();
+void sp0256_voiceGetCounters( ivoice_t *ivoice, sp0256_counters_t *counters );
+void sp0256_voiceSetCommandCounters( ivoice_t *ivoice, sp0256_counters_t *table );
+void sp0256_voiceResetCounters( ivoice_t *ivoice );
+const char *sp0256_getOpcodeName( int opcode );
+
+/* Binary trace of the events (0 to disable), see sp0256_trace.h. The     */
+/* debug modes print the text of a live ring of the default instance.     */
+void sp0256_setTrace( sp0256_trace_t *trace );
+void sp0256_voiceSetTrace( ivoice_t *ivoice, sp0256_trace_t *trace );
+
+/* Kernels, for the micro-benchmarks: filter update into a circular       */
+/* buffer of SCBUF_SIZE samples, bit fetch and micro-sequencer step       */
+int sp0256_filterUpdate( lpc12_t *filt, int num_samp, int16_t *out );
+uint32_t sp0256_voiceGetBits( ivoice_t *ivoice, int len );
+void sp0256_voiceMicro( ivoice_t *ivoice );
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,514 @@
+/*
+ * ============================================================================
+ *  Title:    Intellivoice Emulation - Micro-sequencer and sample loop
+ *  Author:   J. Zbiciak
+ *  Mods:     Michel BERNARD (GmEsoft)
+ * ============================================================================
+ *  Included twice by sp0256.c, once without the trace sites (SP0256_TRACED
+ *  0) and once with them (SP0256_TRACED 1), under the names SP0256_MICRO,
+ *  SP0256_NEXT_SAMPLE and SP0256_RENDER: the variant is selected once per
+ *  block, so the release path has no trace test, and no single-step prompt.
+ * ============================================================================
+ */
+
+/* Trace the micro-sequencer events to the binary ring of the voice       */
+#if SP0256_TRACED
+#define jztrace(iv, ev, a, b, c) \
+    do { if( (iv)->trace && ( (iv)->trace->flags & SP0256_TRACE_MICRO ) ) { sp0256_traceWrite( (iv)->trace, ev, a, b, c ); } } while (0)
+#else
+#define jztrace(iv, ev, a, b, c) do { } while (0)
+#endif
+
+/* ======================================================================== */
+/*  SP0256_MICRO -- Emulate the microsequencer in the SP0256.  Executes     */
+/*                  instructions either until the repeat count != 0 or      */
+/*                  the sequencer gets halted by a RTS to 0.                */
+/* ======================================================================== */
+static void SP0256_MICRO(ivoice_t *iv)
+{
+    uint8_t  immed4;
+    uint8_t  opcode;
+    uint16_t cr;
+    int      ctrl_xfer = 0;
+    int      repeat    = 0;
+    int      i, idx0, idx1;
+    int      start     = 0;
+
+    /* -------------------------------------------------------------------- */
+    /*  Only execute instructions while the filter is not busy.             */
+    /* -------------------------------------------------------------------- */
+    while (iv->filt.rpt <= 0 && iv->filt.cnt <= 0)
+    {
+        /* ---------------------------------------------------------------- */
+        /*  If the CPU is halted, see if we have a new command pending      */
+        /*  in the Address LoaD buffer.                                     */
+        /* ---------------------------------------------------------------- */
+        if (iv->halted && !iv->lrq)
+        {
+			int data = iv->ald >> 4;
+			jztrace(iv, SP0256_EV_FETCH, (uint16_t)data, 0, 0);
+            iv->pc       = iv->ald | (0x1000 << 3);
+            iv->fifo_sel = iv->fifo_enabled && ( iv->pc == FIFO_ADDR );
+            iv->halted   = 0;
+            iv->lrq      = 0x8000;
+            iv->ald      = 0;
+            start        = SP0256_FRAME_START;
+            sp0256_countCommand(iv, iv->fifo_sel ? SP0256_COUNTERS_FIFO : data & 0xFF);
+
+            /* Discard the partial decle left by the previous program. */
+            if (iv->fifo_sel && iv->fifo_bitp)
+            {
+                if (iv->fifo_tail < iv->fifo_head) iv->fifo_tail++;
+                iv->fifo_bitp = 0;
+            }
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  If we're still halted, do nothing.                              */
+        /* ---------------------------------------------------------------- */
+        if (iv->halted)
+        {
+			jztrace(iv, SP0256_EV_HALT, 0, 0, 0);
+            iv->filt.rpt = 1;
+            iv->filt.cnt = 0;
+            iv->lrq      = 0x8000;
+            iv->ald      = 0;
+			if ( iv->recorder )
+				iv->recorder( iv->recorder_param, &iv->filt, SP0256_FRAME_HALT );
+            return;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  When executing from the FIFO, wait until it holds a complete    */
+        /*  instruction; halt if it is empty at the end of the stream.      */
+        /* ---------------------------------------------------------------- */
+        if (iv->fifo_sel && iv->fifo_head - iv->fifo_tail < FIFO_STALL)
+        {
+            if (!iv->fifo_end)
+            {
+                jztrace(iv, SP0256_EV_STALL, 0, 0, 0);
+                ++iv->fifo_stalls;
+                return;
+            }
+            if (iv->fifo_head == iv->fifo_tail)
+            {
+                jztrace(iv, SP0256_EV_FIFO_END, 0, 0, 0);
+                sp0256_countCommand(iv, SP0256_COUNTERS_HALT);
+                iv->halted   = 1;
+                iv->pc       = 0;
+                iv->stack    = 0;
+                iv->fifo_sel = 0;
+                continue;
+            }
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Fetch the first 8 bits of the opcode, which are always in the   */
+        /*  same approximate format -- immed4 followed by opcode.           */
+        /* ---------------------------------------------------------------- */
+        immed4 = (uint8_t)sp0256_getb(iv, 4);
+        opcode = (uint8_t)sp0256_getb(iv, 4);
+        repeat = 0;
+        ctrl_xfer = 0;
+        ++iv->counters.opcodes[opcode & 15];
+
+        jztrace(iv, SP0256_EV_OPCODE, (uint16_t)(opcode | (iv->mode << 8)), iv->pc, 0);
+
+        /* ---------------------------------------------------------------- */
+        /*  Handle the special cases for specific opcodes.                  */
+        /* ---------------------------------------------------------------- */
+        switch (opcode)
+        {
+            /* ------------------------------------------------------------ */
+            /*  OPCODE 0000:  RTS / SETPAGE                                 */
+            /* ------------------------------------------------------------ */
+            case 0x0:
+            {
+                /* -------------------------------------------------------- */
+                /*  If immed4 != 0, then this is a SETPAGE instruction.     */
+                /* -------------------------------------------------------- */
+                if (immed4)     /* SETPAGE */
+                {
+                    iv->page = bitrev(immed4) >> 13;
+                } else
+                /* -------------------------------------------------------- */
+                /*  Otherwise, this is an RTS / HLT.                        */
+                /* -------------------------------------------------------- */
+                {
+                    uint32_t btrg;
+
+                    /* ---------------------------------------------------- */
+                    /*  Figure out our branch target.                       */
+                    /* ---------------------------------------------------- */
+                    btrg = iv->stack;
+
+                    iv->stack = 0;
+
+                    /* ---------------------------------------------------- */
+                    /*  If the branch target is zero, this is a HLT.        */
+                    /*  Otherwise, it's an RTS, so set the PC.              */
+                    /* ---------------------------------------------------- */
+                    if (!btrg)
+                    {
+                        sp0256_countCommand(iv, SP0256_COUNTERS_HALT);
+                        iv->halted = 1;
+                        iv->pc     = 0;
+                        ctrl_xfer  = 1;
+                    } else
+                    {
+                        iv->pc    = btrg;
+                        ctrl_xfer = 1;
+                    }
+                }
+
+                break;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  OPCODE 0111:  JMP          Jump to 12-bit/16-bit Abs Addr   */
+            /*  OPCODE 1011:  JSR          Jump to Subroutine               */
+            /* ------------------------------------------------------------ */
+            case 0xE:
+            case 0xD:
+            {
+                int btrg;
+
+                /* -------------------------------------------------------- */
+                /*  Figure out our branch target.                           */
+                /* -------------------------------------------------------- */
+                btrg = iv->page                           |
+                       (bitrev(immed4)             >> 17) |
+                       (bitrev(sp0256_getb(iv, 8)) >> 21);
+                ctrl_xfer = 1;
+
+                /* -------------------------------------------------------- */
+                /*  If this is a JSR, push our return address on the        */
+                /*  stack.  Make sure it's byte aligned.                    */
+                /* -------------------------------------------------------- */
+                if (opcode == 0xD)
+                    iv->stack = (iv->pc + 7) & ~7;
+
+                /* -------------------------------------------------------- */
+                /*  Jump to the new location!                               */
+                /* -------------------------------------------------------- */
+                iv->pc = btrg;
+                break;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  OPCODE 1000:  SETMODE      Set the Mode and Repeat MSBs     */
+            /* ------------------------------------------------------------ */
+            case 0x1:
+            {
+                iv->mode = ((immed4 & 8) >> 2) | (immed4 & 4) |
+                           ((immed4 & 3) << 4);
+                break;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  OPCODE 0001:  LOADALL      Load All Parameters              */
+            /*  OPCODE 0010:  LOAD_2       Load Per, Ampl, Coefs, Interp.   */
+            /*  OPCODE 0011:  SETMSB_3     Load Pitch, Ampl, MSBs, & Intrp  */
+            /*  OPCODE 0100:  LOAD_4       Load Pitch, Ampl, Coeffs         */
+            /*  OPCODE 0101:  SETMSB_5     Load Pitch, Ampl, and Coeff MSBs */
+            /*  OPCODE 0110:  SETMSB_6     Load Ampl, and Coeff MSBs.       */
+            /*  OPCODE 1001:  DELTA_9      Delta update Ampl, Pitch, Coeffs */
+            /*  OPCODE 1010:  SETMSB_A     Load Ampl and MSBs of 3 Coeffs   */
+            /*  OPCODE 1100:  LOAD_C       Load Pitch, Ampl, Coeffs         */
+            /*  OPCODE 1101:  DELTA_D      Delta update Ampl, Pitch, Coeffs */
+            /*  OPCODE 1110:  LOAD_E       Load Pitch, Amplitude            */
+            /*  OPCODE 1111:  PAUSE        Silent pause                     */
+            /* ------------------------------------------------------------ */
+            default:
+            {
+                repeat    = immed4 | (iv->mode & 0x30);
+                break;
+            }
+        }
+        if (opcode != 1) // SETMODE
+			iv->mode &= 0xF;
+
+        /* ---------------------------------------------------------------- */
+        /*  If this was a control transfer, handle setting "fifo_sel"       */
+        /*  and all that ugliness.                                          */
+        /* ---------------------------------------------------------------- */
+        if (ctrl_xfer)
+        {
+#if SP0256_TRACED
+            uint32_t bitp = 0;
+#endif
+
+            /* ------------------------------------------------------------ */
+            /*  Set our "FIFO Selected" flag based on whether we're going   */
+            /*  to the FIFO's address.                                      */
+            /* ------------------------------------------------------------ */
+            iv->fifo_sel = iv->fifo_enabled && ( iv->pc == FIFO_ADDR );
+
+            /* ------------------------------------------------------------ */
+            /*  Control transfers to the FIFO cause it to discard the       */
+            /*  partial decle that's at the front of the FIFO.              */
+            /* ------------------------------------------------------------ */
+            if (iv->fifo_sel && iv->fifo_bitp)
+            {
+#if SP0256_TRACED
+                bitp = iv->fifo_bitp;
+#endif
+
+                /* Discard partially-read decle. */
+                if (iv->fifo_tail < iv->fifo_head) iv->fifo_tail++;
+                iv->fifo_bitp = 0;
+            }
+
+            jztrace(iv, SP0256_EV_JUMP, (uint16_t)(iv->fifo_sel | (bitp << 8)), iv->pc, 0);
+
+            continue;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Otherwise, if we have a repeat count, then go grab the data     */
+        /*  block and feed it to the filter.                                */
+        /* ---------------------------------------------------------------- */
+        if (!repeat)
+			continue;
+
+
+#if SP0256_TRACED
+		if ( s_debugSingleStep )
+		{
+			jzp_printf("NEXT:"); jzp_flush();
+        {
+        char buf[1024];
+				fgets(buf,sizeof(buf),stdin); // if (opcode != 0xF) repeat <<= 3;
+				if ( toupper(*buf) == 'C' ) // (C)ontinue
+					s_debugSingleStep = 0;
+			}
+        }
+#endif
+
+        iv->filt.rpt = repeat;
+        ++iv->counters.repeats;
+        jztrace(iv, SP0256_EV_REPEAT, 0, repeat, 0);
+
+        /* clear delay line on new opcode */
+        for (i = 0; i < 6; i++)
+             iv->filt.z_data[i][0] = iv->filt.z_data[i][1] = 0;
+
+        i = (opcode << 3) | (iv->mode & 6);
+        idx0 = sp0256_df_idx[i++];
+        idx1 = sp0256_df_idx[i  ];
+
+        assert(idx0 >= 0 && idx1 >= 0 && idx1 >= idx0);
+
+        /* ---------------------------------------------------------------- */
+        /*  If we're in one of the 10-pole modes (x0), clear F5/B5.         */
+        /* ---------------------------------------------------------------- */
+        if ((iv->mode & 2) == 0)
+            iv->filt.r[F5] = iv->filt.r[B5] = 0;
+
+
+        /* ---------------------------------------------------------------- */
+        /*  Step through control words in the description for data block.   */
+        /* ---------------------------------------------------------------- */
+        for (i = idx0; i <= idx1; i++)
+        {
+            int len, shf, delta, field, prm, clrL;
+            int8_t value;
+#if SP0256_TRACED
+            uint32_t pc = iv->pc;
+            uint8_t old;
+#endif
+
+            /* ------------------------------------------------------------ */
+            /*  Get the control word and pull out some important fields.    */
+            /* ------------------------------------------------------------ */
+            cr = sp0256_datafmt[i];
+
+            len   = CR_LEN(cr);
+            shf   = CR_SHF(cr);
+            prm   = CR_PRM(cr);
+            clrL  = cr & CR_CLRL;
+            delta = cr & CR_DELTA;
+            field = cr & CR_FIELD;
+            value = 0;
+
+            /* ------------------------------------------------------------ */
+            /*  Clear any registers that were requested to be cleared.      */
+            /* ------------------------------------------------------------ */
+            if (clrL)
+            {
+                iv->filt.r[F0] = iv->filt.r[B0] = 0;
+                iv->filt.r[F1] = iv->filt.r[B1] = 0;
+                iv->filt.r[F2] = iv->filt.r[B2] = 0;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  If this entry has a bitfield with it, grab the bitfield.    */
+            /* ------------------------------------------------------------ */
+            if (len)
+            {
+                value = (int8_t)sp0256_getb(iv, len);
+            }
+            else
+            {
+                jztrace(iv, SP0256_EV_FIELD,
+                        (uint16_t)((shf << 4) | (prm << 8) | (delta ? SP0256_FIELD_DELTA : 0) | (field ? SP0256_FIELD_FIELD : 0)),
+                        pc, 0);
+                continue;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  Sign extend if this is a delta update.                      */
+            /* ------------------------------------------------------------ */
+            if (delta)  /* Sign extend */
+            {
+                if (value & (1u << (len - 1))) value |= -(int)(1u << len);
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  Shift the value to the appropriate precision.               */
+            /* ------------------------------------------------------------ */
+            if (shf)
+                value = value < 0 ? -(-value << shf) : (value << shf);
+
+            iv->silent = 0;
+#if SP0256_TRACED
+            old = iv->filt.r[prm];
+#endif
+
+            /* ------------------------------------------------------------ */
+            /*  If this is a field-replace, insert the field.               */
+            /* ------------------------------------------------------------ */
+            if (field)
+            {
+                iv->filt.r[prm] &= ~(~0u << shf); /* Clear the old bits.    */
+                iv->filt.r[prm] |= value;         /* Merge in the new bits. */
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  If this is a delta update, add to the appropriate field.    */
+            /* ------------------------------------------------------------ */
+            else if (delta)
+            {
+                iv->filt.r[prm] += value;
+            }
+
+            /* ------------------------------------------------------------ */
+            /*  Otherwise, just write the new value.                        */
+            /* ------------------------------------------------------------ */
+            else
+            {
+                iv->filt.r[prm] = value;
+            }
+
+            jztrace(iv, SP0256_EV_FIELD,
+                    (uint16_t)(len | (shf << 4) | (prm << 8) | (delta ? SP0256_FIELD_DELTA : 0) | (field ? SP0256_FIELD_FIELD : 0)),
+                    pc, (uint8_t)value | ((uint32_t)old << 8) | ((uint32_t)iv->filt.r[prm] << 16));
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Most opcodes clear IA, IP.                                      */
+        /* ---------------------------------------------------------------- */
+        if (opcode != 0x1 && opcode != 0x2 && opcode != 0x3)
+        {
+            iv->filt.r[IA] = 0;
+            iv->filt.r[IP] = 0;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Special case:  Set PAUSE's equivalent period.                   */
+        /* ---------------------------------------------------------------- */
+        if (opcode == 0xF)
+        {
+            iv->silent     = 1;
+            iv->filt.r[AM] = 0;
+            iv->filt.r[PR] = PER_PAUSE;
+        }
+
+        /* ---------------------------------------------------------------- */
+        /*  Now that we've updated the registers, go decode them.           */
+        /* ---------------------------------------------------------------- */
+        lpc12_regdec(&iv->filt);
+
+		if ( iv->recorder )
+			iv->recorder( iv->recorder_param, &iv->filt, start | ( iv->silent ? SP0256_FRAME_SILENT : 0 ) );
+
+        /* ---------------------------------------------------------------- */
+        /*  Break out since we now have a repeat count.                     */
+        /* ---------------------------------------------------------------- */
+        break;
+    }
+}
+
+/* ======================================================================== */
+/*  SP0256_NEXT_SAMPLE -- Runs the micro-sequencer when the filter is not   */
+/*                        busy, then the filter, for the next sample.       */
+/* ======================================================================== */
+static INLINE int SP0256_NEXT_SAMPLE( ivoice_t *ivoice )
+{
+	uint32_t optr = 0;
+	int16_t out = 0;
+
+	if (ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0)
+        SP0256_MICRO(ivoice);
+
+	if  (	ivoice->halted
+		||	( ivoice->silent && ivoice->filt.rpt <= 0 && ivoice->filt.cnt <= 0 )
+		)
+	{
+		out = 0;
+		if ( ivoice->halted )
+			++ivoice->counters.halted;
+		else
+			++ivoice->counters.pause;
+    }
+	else
+	{
+		/* same condition as the interpolation in lpc12_update */
+		if ( ivoice->filt.cnt <= 0 && ivoice->filt.rpt > 0 && ivoice->filt.interp )
+			++ivoice->counters.interps;
+		if ( ivoice->silent )
+			++ivoice->counters.pause;
+		else if ( ivoice->filt.per )
+			++ivoice->counters.voiced;
+		else
+			++ivoice->counters.noise;
+
+		lpc12_update(&ivoice->filt, 1, &out, &optr);
+    }
+
+#if SP0256_TRACED
+	if ( ivoice->trace )
+	{
+		if ( ivoice->trace->flags & SP0256_TRACE_SAMPLES )
+			sp0256_traceWrite( ivoice->trace, SP0256_EV_SAMPLE, (uint16_t)out, ivoice->trace->samples, 0 );
+		++ivoice->trace->samples;
+	}
+#endif
+
+	return out;
+}
+
+/* ======================================================================== */
+/*  SP0256_RENDER -- Renders up to n samples, until the sample that raises  */
+/*                   the LRQ or halts the voice, so that the caller can     */
+/*                   send the next command. Returns the number rendered.    */
+/* ======================================================================== */
+static int SP0256_RENDER( ivoice_t *ivoice, int16_t *out, int n )
+{
+	int i = 0;
+
+	while ( i < n )
+	{
+		const uint32_t lrq = ivoice->lrq;
+		const int halted = ivoice->halted;
+
+		out[i++] = (int16_t)SP0256_NEXT_SAMPLE( ivoice );
+
+		if ( ( ivoice->lrq && !lrq ) || ( ivoice->halted && !halted ) )
+			break;
+	}
+
+	return i;
+}
+
+#undef jztrace
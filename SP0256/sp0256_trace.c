@@ -0,0 +1,265 @@
+/*
+    SP0256A - Binary Trace Ring.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "sp0256_trace.h"
+
+#include "sp0256.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Dump file header */
+typedef struct sp0256_traceHeader_t
+{
+	char		magic[4];	/* "SPTR"                   */
+	uint32_t	version;	/* 1                        */
+	uint32_t	size;		/* Record size              */
+	uint32_t	count;		/* Records in the file      */
+	uint32_t	lost;		/* Records lost by the wrap */
+	uint32_t	flags;		/* Traced classes           */
+	uint32_t	reserved[2];
+} sp0256_traceHeader_t;
+
+static const char s_magic[4] = { 'S', 'P', 'T', 'R' };
+
+int sp0256_traceInit( sp0256_trace_t *trace, uint32_t n, uint32_t flags )
+{
+	uint32_t size = 16;
+
+	memset( trace, 0, sizeof( sp0256_trace_t ) );
+	while ( size < n && size < 0x80000000 )
+		size <<= 1;
+	trace->records = (sp0256_traceRecord_t *)calloc( size, sizeof( sp0256_traceRecord_t ) );
+	if ( !trace->records )
+		return ENOMEM;
+	trace->mask = size - 1;
+	trace->flags = flags;
+	return 0;
+}
+
+void sp0256_traceFree( sp0256_trace_t *trace )
+{
+	free( trace->records );
+	trace->records = 0;
+}
+
+void sp0256_traceWrite( sp0256_trace_t *trace, uint16_t event, uint16_t a, uint32_t b, uint32_t c )
+{
+	uint32_t head = trace->head;
+	sp0256_traceRecord_t *record = &trace->records[head & trace->mask];
+
+	record->event = event;
+	record->a = a;
+	record->b = b;
+	record->c = c;
+	record->d = trace->samples;
+
+	/* publish the record (volatile store: release on x86/x64) */
+	trace->head = head + 1;
+
+	if ( trace->sink )
+		trace->sink( trace->sink_param, record );
+}
+
+uint32_t sp0256_traceSnapshot( const sp0256_trace_t *trace, sp0256_traceRecord_t *records, uint32_t *lost )
+{
+	uint32_t size = trace->mask + 1;
+	uint32_t head = trace->head;
+	uint32_t first = head > size ? head - size : 0;
+	uint32_t i, last;
+
+	for ( i = first; i != head; ++i )
+		records[i - first] = trace->records[i & trace->mask];
+
+	/* drop the records overwritten by the writer during the copy */
+	last = trace->head;
+	if ( last - first > size )
+	{
+		uint32_t overwritten = last - size - first;
+		if ( overwritten > head - first )
+			overwritten = head - first;
+		memmove( records, records + overwritten, ( head - first - overwritten ) * sizeof( sp0256_traceRecord_t ) );
+		first += overwritten;
+	}
+
+	*lost = first;
+	return head - first;
+}
+
+int sp0256_traceDump( const sp0256_trace_t *trace, const char *name )
+{
+	sp0256_traceHeader_t header;
+	sp0256_traceRecord_t *records;
+	FILE *file;
+	int err = 0;
+
+	records = (sp0256_traceRecord_t *)malloc( ( trace->mask + 1 ) * sizeof( sp0256_traceRecord_t ) );
+	if ( !records )
+		return ENOMEM;
+
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, s_magic, 4 );
+	header.version = 1;
+	header.size = sizeof( sp0256_traceRecord_t );
+	header.count = sp0256_traceSnapshot( trace, records, &header.lost );
+	header.flags = trace->flags;
+
+	file = fopen( name, "wb" );
+	if ( !file )
+		err = errno;
+	else
+	{
+		if ( fwrite( &header, sizeof( header ), 1, file ) != 1
+			|| fwrite( records, sizeof( sp0256_traceRecord_t ), header.count, file ) != header.count )
+			err = errno ? errno : EIO;
+		if ( fclose( file ) && !err )
+			err = errno;
+	}
+
+	free( records );
+	return err;
+}
+
+int sp0256_traceDecode( const char *name, FILE *out, int nLabels, const char *labels[] )
+{
+	sp0256_traceHeader_t header;
+	sp0256_traceRecord_t record;
+	char text[SP0256_TRACE_TEXT];
+	FILE *file;
+	uint32_t i;
+	int err = 0;
+
+	file = fopen( name, "rb" );
+	if ( !file )
+		return errno;
+
+	if ( fread( &header, sizeof( header ), 1, file ) != 1
+		|| memcmp( header.magic, s_magic, 4 ) || header.version != 1
+		|| header.size != sizeof( sp0256_traceRecord_t ) )
+	{
+		fclose( file );
+		return EINVAL;
+	}
+
+	if ( header.lost )
+		fprintf( out, "[%lu records lost]\n", (unsigned long)header.lost );
+
+	for ( i = 0; i < header.count; ++i )
+	{
+		if ( fread( &record, sizeof( record ), 1, file ) != 1 )
+		{
+			err = EINVAL;
+			break;
+		}
+		sp0256_traceFormat( &record, nLabels, labels, text );
+		fputs( text, out );
+	}
+
+	fclose( file );
+	return err;
+}
+
+void sp0256_traceFormat( const sp0256_traceRecord_t *record, int nLabels, const char *labels[], char *text )
+{
+	const uint32_t pc = record->b;
+	char *p = text;
+
+	*p = 0;
+
+	switch ( record->event )
+	{
+	case SP0256_EV_FETCH:
+		sprintf( p, "\nfetch => %02X: %s\n", record->a, record->a < nLabels ? labels[record->a] : "---" );
+		break;
+	case SP0256_EV_HALT:
+		strcpy( p, "\nfetch => HALT\n" );
+		break;
+	case SP0256_EV_STALL:
+		strcpy( p, "FIFO stall\n" );
+		break;
+	case SP0256_EV_FIFO_END:
+		strcpy( p, "FIFO end => HALT\n" );
+		break;
+	case SP0256_EV_OPCODE:
+		{
+			int opcode = record->a & 0x0F, mode = record->a >> 8;
+			sprintf( p, "$%.4X.%.1X: OPCODE %d%d%d%d.%d%d - %s\n",
+				( pc >> 3 ) - 1, pc & 7,
+				!!( opcode & 1 ), !!( opcode & 2 ),
+				!!( opcode & 4 ), !!( opcode & 8 ),
+				!!( mode & 4 ), !!( mode & 2 ),
+				sp0256_getOpcodeName( opcode ) );
+		}
+		break;
+	case SP0256_EV_JUMP:
+		p += sprintf( p, "jumping to $%.4X.%.1X: ", pc >> 3, pc & 7 );
+		p += sprintf( p, "%s ", record->a & 1 ? "FIFO" : "ROM" );
+		if ( record->a >> 8 )
+			p += sprintf( p, "bitp = %d -> Flush", record->a >> 8 );
+		strcpy( p, "\n" );
+		break;
+	case SP0256_EV_REPEAT:
+		sprintf( p, "repeat = %d\n", (int)record->b );
+		break;
+	case SP0256_EV_FIELD:
+		{
+			int len = SP0256_FIELD_LEN( record->a ), prm = SP0256_FIELD_PRM( record->a );
+			int8_t value = (int8_t)( record->c & 0xFF );
+			uint8_t old = (uint8_t)( record->c >> 8 ), now = (uint8_t)( record->c >> 16 );
+
+			p += sprintf( p, "$%.4X.%.1X: len=%2d shf=%2d prm=%2d d=%d f=%d ",
+				pc >> 3, pc & 7, len, SP0256_FIELD_SHF( record->a ), prm,
+				!!( record->a & SP0256_FIELD_DELTA ), !!( record->a & SP0256_FIELD_FIELD ) );
+			if ( !len )
+			{
+				strcpy( p, " (no update)\n" );
+				break;
+			}
+			p += sprintf( p, "v=%.2X (%c%.2X)  ", value & 0xFF,
+				value & 0x80 ? '-' : '+',
+				0xFF & ( value & 0x80 ? -value : value ) );
+			if ( record->a & SP0256_FIELD_FIELD )
+				sprintf( p, "--field-> r[%2d] = %.2X -> %.2X\n", prm, old, now );
+			else if ( record->a & SP0256_FIELD_DELTA )
+				sprintf( p, "--delta-> r[%2d] = %.2X -> %.2X\n", prm, old, now );
+			else
+				sprintf( p, "--value-> r[%2d] = %.2X\n", prm, now );
+		}
+		break;
+	case SP0256_EV_DROP:
+		strcpy( p, "IV: Dropped FIFO write\n" );
+		break;
+	case SP0256_EV_SAMPLE:
+		{
+			int16_t out = (int16_t)record->a;
+			sprintf( p, "%ld\t%4d\t%*c\n", (long)record->b, (int8_t)( out >> 8 ), (int8_t)( out >> 9 ) + 64, '+' );
+		}
+		break;
+	default:
+		sprintf( p, "[event %d]\n", record->event );
+		break;
+	}
+}
@@ -0,0 +1,116 @@
+/*
+    SP0256A - Binary Trace Ring.
+
+    Created by Michel Bernard (michel_bernard@hotmail.com)
+    - <http://www.github.com/GmEsoft/SP0256_CTS256A-AL2>
+    Copyright (c) 2023 Michel Bernard.
+    All rights reserved.
+
+
+    This file is part of SP0256_CTS256A-AL2.
+
+    SP0256_CTS256A-AL2 is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    SP0256_CTS256A-AL2 is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with SP0256_CTS256A-AL2.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "types.h"
+
+#include <stdio.h>
+
+/* Binary trace of the synthesizer events: fixed-size records in a ring    */
+/* per instance, written by the synthesizer thread without lock, dumped    */
+/* to a file, and decoded offline into the text of the debug modes. The    */
+/* records are stamped (d) with the sample number.                        */
+
+/* Trace classes                                                           */
+#define SP0256_TRACE_MICRO		0x01	/* Micro-sequencer events (-dD)   */
+#define SP0256_TRACE_SAMPLES	0x02	/* Output samples (-dS)           */
+
+/* Events                                                                  */
+enum
+{
+	SP0256_EV_FETCH = 1,	/* Command fetch: a=command                       */
+	SP0256_EV_HALT,			/* Halted                                         */
+	SP0256_EV_STALL,		/* FIFO stall                                     */
+	SP0256_EV_FIFO_END,		/* FIFO end => halt                               */
+	SP0256_EV_OPCODE,		/* Instruction: a=opcode|mode<<8, b=pc            */
+	SP0256_EV_JUMP,			/* Control transfer: a=fifo_sel|bitp<<8, b=pc     */
+	SP0256_EV_REPEAT,		/* Repeat count: b=repeat                         */
+	SP0256_EV_FIELD,		/* Data field: a=see below, b=pc, c=value|old<<8|new<<16 */
+	SP0256_EV_DROP,			/* Dropped FIFO write                             */
+	SP0256_EV_SAMPLE		/* Output sample: a=sample, b=sample number       */
+};
+
+/* SP0256_EV_FIELD: fields of a                                            */
+#define SP0256_FIELD_LEN( a )	( (a) & 0x0F )
+#define SP0256_FIELD_SHF( a )	( ( (a) >> 4 ) & 0x0F )
+#define SP0256_FIELD_PRM( a )	( ( (a) >> 8 ) & 0x0F )
+#define SP0256_FIELD_DELTA		0x1000
+#define SP0256_FIELD_FIELD		0x2000
+
+typedef struct sp0256_traceRecord_t
+{
+	uint16_t	event;
+	uint16_t	a;
+	uint32_t	b;
+	uint32_t	c;
+	uint32_t	d;
+} sp0256_traceRecord_t;
+
+/* Live sink: called after each record, e.g. to print the debug text       */
+typedef void (*sp0256_traceSink_t)( void *param, const sp0256_traceRecord_t *record );
+
+typedef struct sp0256_trace_t
+{
+	sp0256_traceRecord_t	*records;
+	uint32_t				mask;		/* Number of records - 1 (power of 2) */
+	volatile uint32_t		head;		/* Records written (wraps at 2^32)    */
+	uint32_t				flags;		/* Traced classes                     */
+	uint32_t				samples;	/* Sample number                      */
+	sp0256_traceSink_t		sink;
+	void					*sink_param;
+} sp0256_trace_t;
+
+/* Ring of at least n records; returns 0 or errno                          */
+int sp0256_traceInit( sp0256_trace_t *trace, uint32_t n, uint32_t flags );
+void sp0256_traceFree( sp0256_trace_t *trace );
+
+/* Write a record: single writer per ring                                  */
+void sp0256_traceWrite( sp0256_trace_t *trace, uint16_t event, uint16_t a, uint32_t b, uint32_t c );
+
+/* Copy the records still in the ring, oldest first, to records[] of the   */
+/* ring size; may run while the writer goes on. Returns the number copied, */
+/* and the number of records lost by the wrap-around in *lost             */
+uint32_t sp0256_traceSnapshot( const sp0256_trace_t *trace, sp0256_traceRecord_t *records, uint32_t *lost );
+
+/* Dump the ring to a file; returns 0 or errno                             */
+int sp0256_traceDump( const sp0256_trace_t *trace, const char *name );
+
+/* Decode a dumped trace to text; returns 0 or errno                       */
+int sp0256_traceDecode( const char *name, FILE *out, int nLabels, const char *labels[] );
+
+/* Text of a record, as printed by the debug modes                         */
+void sp0256_traceFormat( const sp0256_traceRecord_t *record, int nLabels, const char *labels[], char *text );
+
+/* Size of the text buffer of sp0256_traceFormat()                         */
+#define SP0256_TRACE_TEXT	256
+
+#ifdef __cplusplus
+}
+#endif